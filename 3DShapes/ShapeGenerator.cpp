@@ -0,0 +1,296 @@
+///////////////////////////////////////////////////////////////////////////////
+// shapegenerator.cpp
+// ============
+// generate the curved 3D primitives from segment and ring counts
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShapeGenerator.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	const float TWO_PI = 6.28318530717958647692f;
+	const float PI = 3.14159265358979323846f;
+
+	// number of torus tube segments indexed before moving on to
+	// the next main segment, small enough that the vertices of
+	// the previous row are still in the post-transform cache
+	const int TORUS_TUBE_BAND = 10;
+
+	/***********************************************************
+	 *  AddVertex()
+	 *
+	 *  Appends one interleaved vertex to the mesh data.
+	 ***********************************************************/
+	inline void AddVertex(
+		std::vector<GLfloat>& vertices,
+		const glm::vec3& position,
+		const glm::vec3& normal,
+		float u,
+		float v)
+	{
+		vertices.push_back(position.x);
+		vertices.push_back(position.y);
+		vertices.push_back(position.z);
+		vertices.push_back(normal.x);
+		vertices.push_back(normal.y);
+		vertices.push_back(normal.z);
+		vertices.push_back(u);
+		vertices.push_back(v);
+	}
+
+	/***********************************************************
+	 *  AddTriangle()
+	 *
+	 *  Appends the indices of one triangle to the mesh data.
+	 ***********************************************************/
+	inline void AddTriangle(std::vector<GLuint>& indices, GLuint a, GLuint b, GLuint c)
+	{
+		indices.push_back(a);
+		indices.push_back(b);
+		indices.push_back(c);
+	}
+
+	/***********************************************************
+	 *  AddCap()
+	 *
+	 *  Appends a flat disc at the passed in height, with the
+	 *  texture coordinates projected from above.  The triangles
+	 *  of the top cap face up and the ones of the bottom cap
+	 *  face down.
+	 ***********************************************************/
+	void AddCap(ShapeGenerator::MESH_DATA& mesh, int segments, float radius, float height, bool bTop)
+	{
+		const GLuint center = (GLuint)(mesh.vertices.size() / ShapeGenerator::FLOATS_PER_VERTEX);
+		const glm::vec3 normal(0.0f, bTop ? 1.0f : -1.0f, 0.0f);
+
+		AddVertex(mesh.vertices, glm::vec3(0.0f, height, 0.0f), normal, 0.5f, 0.5f);
+		for (int i = 0; i < segments; i++)
+		{
+			float angle = TWO_PI * i / segments;
+			float x = cos(angle);
+			float z = -sin(angle);
+
+			AddVertex(mesh.vertices, glm::vec3(x * radius, height, z * radius), normal, 0.5f + 0.5f * z, 0.5f + 0.5f * x);
+		}
+
+		for (int i = 0; i < segments; i++)
+		{
+			GLuint current = center + 1 + i;
+			GLuint next = center + 1 + ((i + 1) % segments);
+
+			if (bTop == true)
+			{
+				AddTriangle(mesh.indices, center, current, next);
+			}
+			else
+			{
+				AddTriangle(mesh.indices, center, next, current);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  GenerateSphere()
+ *
+ *  This function is used for generating a sphere out of
+ *  rings of vertices.  Every ring has a duplicate vertex
+ *  at the texture seam, the single triangle that touches
+ *  each pole is kept and the degenerate one is skipped.
+ ***********************************************************/
+void ShapeGenerator::GenerateSphere(MESH_DATA& mesh, int segments, int rings)
+{
+	const int ringVertices = segments + 1;
+
+	mesh.vertices.clear();
+	mesh.indices.clear();
+	mesh.vertices.reserve((size_t)(rings + 1) * ringVertices * FLOATS_PER_VERTEX);
+	mesh.indices.reserve((size_t)segments * (rings - 1) * 6);
+	mesh.nBottomIndices = 0;
+	mesh.nTopIndices = 0;
+
+	for (int ring = 0; ring <= rings; ring++)
+	{
+		float polar = PI * ring / rings;
+		float ringRadius = sin(polar);
+		float y = cos(polar);
+
+		for (int i = 0; i <= segments; i++)
+		{
+			float angle = TWO_PI * i / segments;
+			glm::vec3 position(ringRadius * sin(angle), y, ringRadius * cos(angle));
+
+			// the position on a unit sphere is also its normal
+			AddVertex(mesh.vertices, position, position, float(i) / segments, 1.0f - float(ring) / rings);
+		}
+	}
+
+	for (int ring = 0; ring < rings; ring++)
+	{
+		for (int i = 0; i < segments; i++)
+		{
+			GLuint corner = ring * ringVertices + i;
+			GLuint below = corner + ringVertices;
+
+			if (ring != 0)
+			{
+				AddTriangle(mesh.indices, corner, below + 1, corner + 1);
+			}
+			if (ring != (rings - 1))
+			{
+				AddTriangle(mesh.indices, corner, below, below + 1);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  GenerateCylinder()
+ *
+ *  This function is used for generating a cylinder with a
+ *  different radius at the bottom and at the top.  The
+ *  sides have their own ring of vertices at both ends so
+ *  that the normals follow the slope of the sides.
+ ***********************************************************/
+void ShapeGenerator::GenerateCylinder(MESH_DATA& mesh, int segments, float bottomRadius, float topRadius)
+{
+	const bool bHasTop = (topRadius > 0.0f);
+
+	mesh.vertices.clear();
+	mesh.indices.clear();
+	mesh.vertices.reserve((size_t)(segments + 1) * 4 * FLOATS_PER_VERTEX);
+	mesh.indices.reserve((size_t)segments * 12);
+
+	AddCap(mesh, segments, bottomRadius, 0.0f, false);
+	mesh.nBottomIndices = (GLuint)mesh.indices.size();
+
+	if (bHasTop == true)
+	{
+		AddCap(mesh, segments, topRadius, 1.0f, true);
+	}
+	mesh.nTopIndices = (GLuint)mesh.indices.size() - mesh.nBottomIndices;
+
+	// the sides lean in by the difference of the radii over
+	// a height of 1, which tilts the normals up by as much
+	const GLuint first = (GLuint)(mesh.vertices.size() / FLOATS_PER_VERTEX);
+	const float slope = bottomRadius - topRadius;
+
+	for (int i = 0; i <= segments; i++)
+	{
+		float angle = TWO_PI * i / segments;
+		float x = cos(angle);
+		float z = -sin(angle);
+		glm::vec3 normal = glm::normalize(glm::vec3(x, slope, z));
+		float u = float(i) / segments;
+
+		if (bHasTop == true)
+		{
+			AddVertex(mesh.vertices, glm::vec3(x * bottomRadius, 0.0f, z * bottomRadius), normal, u, 0.0f);
+			AddVertex(mesh.vertices, glm::vec3(x * topRadius, 1.0f, z * topRadius), normal, u, 1.0f);
+		}
+		else
+		{
+			// the sides of a cone are textured from above, with the
+			// tip in the center of the texture
+			AddVertex(mesh.vertices, glm::vec3(x * bottomRadius, 0.0f, z * bottomRadius), normal, 0.5f + 0.5f * x, 0.5f - 0.5f * z);
+			AddVertex(mesh.vertices, glm::vec3(0.0f, 1.0f, 0.0f), normal, 0.5f, 0.5f);
+		}
+	}
+
+	for (int i = 0; i < segments; i++)
+	{
+		GLuint bottom = first + i * 2;
+		GLuint top = bottom + 1;
+
+		AddTriangle(mesh.indices, bottom, bottom + 2, top + 2);
+		// the second triangle of a cone would only touch the tip
+		if (bHasTop == true)
+		{
+			AddTriangle(mesh.indices, bottom, top + 2, top);
+		}
+	}
+}
+
+/***********************************************************
+ *  GenerateTorus()
+ *
+ *  This function is used for generating a welded torus,
+ *  every grid point is shared by the four quads around it
+ *  and only the seams where the texture coordinates wrap
+ *  are duplicated.
+ ***********************************************************/
+void ShapeGenerator::GenerateTorus(MESH_DATA& mesh, int mainSegments, int tubeSegments, float tubeRadius)
+{
+	const float mainRadius = 1.0f;
+	// one extra row and column of vertices for the texture seams
+	const int rowVertices = tubeSegments + 1;
+
+	mesh.vertices.clear();
+	mesh.indices.clear();
+	mesh.vertices.reserve((size_t)(mainSegments + 1) * rowVertices * FLOATS_PER_VERTEX);
+	mesh.indices.reserve((size_t)mainSegments * tubeSegments * 6);
+	mesh.nBottomIndices = 0;
+	mesh.nTopIndices = 0;
+
+	// generate the torus vertices with the normals calculated
+	// from the angles around the main ring and the tube
+	for (int i = 0; i <= mainSegments; i++)
+	{
+		float mainAngle = TWO_PI * i / mainSegments;
+		float sinMainSegment = sin(mainAngle);
+		float cosMainSegment = cos(mainAngle);
+
+		for (int j = 0; j <= tubeSegments; j++)
+		{
+			float tubeAngle = TWO_PI * j / tubeSegments;
+			float sinTubeSegment = sin(tubeAngle);
+			float cosTubeSegment = cos(tubeAngle);
+
+			AddVertex(
+				mesh.vertices,
+				glm::vec3(
+					(mainRadius + tubeRadius * cosTubeSegment) * cosMainSegment,
+					(mainRadius + tubeRadius * cosTubeSegment) * sinMainSegment,
+					tubeRadius * sinTubeSegment),
+				glm::vec3(
+					cosTubeSegment * cosMainSegment,
+					cosTubeSegment * sinMainSegment,
+					sinTubeSegment),
+				float(i) / mainSegments,
+				float(j) / tubeSegments);
+		}
+	}
+
+	// connect the vertices into triangles - each half of the
+	// main ring is finished before the other one is started,
+	// and the quads are visited in bands of tube segments
+	const int halfSegments = mainSegments / 2;
+	for (int half = 0; half < 2; half++)
+	{
+		int firstSegment = (half == 0) ? 0 : halfSegments;
+		int lastSegment = (half == 0) ? halfSegments : mainSegments;
+
+		for (int band = 0; band < tubeSegments; band += TORUS_TUBE_BAND)
+		{
+			int lastTube = std::min(band + TORUS_TUBE_BAND, tubeSegments);
+
+			for (int i = firstSegment; i < lastSegment; i++)
+			{
+				for (int j = band; j < lastTube; j++)
+				{
+					GLuint corner = i * rowVertices + j;
+					GLuint nextMain = corner + rowVertices;
+
+					AddTriangle(mesh.indices, corner, nextMain, nextMain + 1);
+					AddTriangle(mesh.indices, corner, nextMain + 1, corner + 1);
+				}
+			}
+		}
+	}
+}
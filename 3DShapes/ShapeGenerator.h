@@ -0,0 +1,42 @@
+///////////////////////////////////////////////////////////////////////////////
+// shapegenerator.h
+// ============
+// generate the curved 3D primitives from segment and ring counts
+//
+// The generated vertices are interleaved as position, normal and texture
+// coordinates, the same layout that ShapeMeshes sets up for the shaders,
+// and every mesh is indexed as a list of triangles.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+
+namespace ShapeGenerator
+{
+	// number of floats in one interleaved vertex
+	const int FLOATS_PER_VERTEX = 8;
+
+	// the generated data of one mesh - the indices of the
+	// bottom cap come first, followed by the top cap and
+	// then the rest of the mesh
+	struct MESH_DATA
+	{
+		std::vector<GLfloat> vertices;
+		std::vector<GLuint> indices;
+		GLuint nBottomIndices;
+		GLuint nTopIndices;
+	};
+
+	// sphere with a radius of 1 around the origin, the rings go
+	// from the top to the bottom so that the first half of the
+	// indices is the top half of the sphere
+	void GenerateSphere(MESH_DATA& mesh, int segments, int rings);
+	// cylinder from y=0 to y=1, a top radius of 0 makes a cone
+	void GenerateCylinder(MESH_DATA& mesh, int segments, float bottomRadius, float topRadius);
+	// torus around the z axis with a main radius of 1, each half
+	// of the main ring is indexed before the other one
+	void GenerateTorus(MESH_DATA& mesh, int mainSegments, int tubeSegments, float tubeRadius);
+}
@@ -12,8 +12,13 @@
 
 #include <GL/glew.h>
 
+#include "ShapeGenerator.h"
+#include "VertexFormat.h"
+
 #include <glm/glm.hpp>
 
+#include <vector>
+
 /***********************************************************
  *  ShapeMeshes
  *
@@ -26,15 +31,76 @@ public:
 	// constructor
 	ShapeMeshes();
 
+	// the available 3D shapes, used to refer to a mesh
+	// without calling its draw method directly
+	enum MESH_TYPE
+	{
+		BOX_MESH = 0,
+		CONE_MESH,
+		CYLINDER_MESH,
+		PLANE_MESH,
+		PRISM_MESH,
+		PYRAMID3_MESH,
+		PYRAMID4_MESH,
+		SPHERE_MESH,
+		TAPERED_CYLINDER_MESH,
+		TORUS_MESH,
+		MESH_TYPE_COUNT
+	};
+
+	// the parts of a mesh that can be drawn separately -
+	// meshes without separate parts ignore the part flags
+	enum MESH_PART
+	{
+		MESH_PART_BOTTOM = 1,
+		MESH_PART_TOP = 2,
+		MESH_PART_SIDES = 4,
+		MESH_PART_ALL = 7,
+		MESH_PART_HALF = 8
+	};
+
+	// one command of an indirect multi-draw, laid out like
+	// DrawElementsIndirectCommand
+	struct DRAW_COMMAND
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// local bounds of a mesh, computed when it is loaded -
+	// the sphere is centered on the middle of the box
+	struct MESH_BOUNDS
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+		float radius;
+	};
+
 private:
 
-	// stores the GL data relative to a given mesh
+	// a range of the indices of a mesh
+	struct INDEX_RANGE
+	{
+		GLuint first;	// First index of the range, relative to the mesh
+		GLuint count;	// Number of indices in the range
+	};
+
+	// stores where a given mesh is in the shared buffers
 	struct GLMesh
 	{
-		GLuint vao;         // Handle for the vertex array object
-		GLuint vbos[2];     // Handles for the vertex buffer objects
+		GLint baseVertex;	// First vertex of the mesh in the vertex buffer of its layout
+		GLuint sourceVertex;	// First vertex of the mesh in the loaded vertex data
+		VertexFormat::VERTEX_FORMAT format;	// Layout of the mesh on the GPU
+		GLuint firstIndex;	// First index of the mesh in the index buffer
 		GLuint nVertices;	// Number of vertices for the mesh
 		GLuint nIndices;    // Number of indices for the mesh
+		GLuint nBottomIndices;	// Number of indices of the bottom cap, if any
+		GLuint nTopIndices;	// Number of indices of the top cap, if any
+		INDEX_RANGE partRanges[MESH_PART_ALL + 1];	// Indices of every combination of parts
+		MESH_BOUNDS bounds;	// Box and sphere around all of the vertices
 	};
 
 	// the available 3D shapes
@@ -49,21 +115,41 @@ private:
 	GLMesh m_TaperedCylinderMesh;
 	GLMesh m_TorusMesh;
 
+	// a vertex array and vertex buffer for every layout,
+	// the index buffer is shared by all of them
+	GLuint m_vaos[VertexFormat::VERTEX_FORMAT_COUNT];
+	GLuint m_vertexBuffers[VertexFormat::VERTEX_FORMAT_COUNT];
+	GLuint m_indexBuffer;
+	// loaded mesh data, uploaded into the shared buffers
+	// the next time they are bound
+	std::vector<GLfloat> m_vertexData;
+	std::vector<GLuint> m_indexData;
+	bool m_bBuffersDirty;
+
 	bool m_bMemoryLayoutDone;
 
+	// buffer of the instance index attribute and the number
+	// of instances that it covers
+	GLuint m_instanceIndexBuffer;
+	GLuint m_instanceIndexCapacity;
+
+	// number of draw calls issued since the last reset
+	unsigned int m_drawCalls;
+
 public:
 	// methods for loading the shape mesh data 
-	// into memory
+	// into memory - the curved shapes are generated
+	// out of the passed in number of segments
 	void LoadBoxMesh();
-	void LoadConeMesh();
-	void LoadCylinderMesh();
+	void LoadConeMesh(int segments = 36);
+	void LoadCylinderMesh(int segments = 36);
 	void LoadPlaneMesh();
 	void LoadPrismMesh();
 	void LoadPyramid3Mesh();
 	void LoadPyramid4Mesh();
-	void LoadSphereMesh();
-	void LoadTaperedCylinderMesh();
-	void LoadTorusMesh(float thickness = 0.2);
+	void LoadSphereMesh(int segments = 32, int rings = 16);
+	void LoadTaperedCylinderMesh(int segments = 36);
+	void LoadTorusMesh(float thickness = 0.2, int mainSegments = 30, int tubeSegments = 30);
 
 	// methods for drawing the shape mesh in the
 	// display window
@@ -87,6 +173,88 @@ public:
 	void DrawTorusMesh();
 	void DrawHalfTorusMesh();
 
+	// methods for drawing a shape mesh once for every
+	// InstanceData entry of the passed in buffer with a
+	// single draw call - the firstInstance uniform of the
+	// shaders must be set to the entry of the first instance
+	void DrawBoxMeshInstanced(GLsizei count, GLuint instanceBuffer);
+	void DrawConeMeshInstanced(
+		GLsizei count,
+		GLuint instanceBuffer,
+		bool bDrawBottom = true);
+	void DrawCylinderMeshInstanced(
+		GLsizei count,
+		GLuint instanceBuffer,
+		bool bDrawTop = true,
+		bool bDrawBottom = true,
+		bool bDrawSides = true);
+	void DrawPlaneMeshInstanced(GLsizei count, GLuint instanceBuffer);
+	void DrawPrismMeshInstanced(GLsizei count, GLuint instanceBuffer);
+	void DrawPyramid3MeshInstanced(GLsizei count, GLuint instanceBuffer);
+	void DrawPyramid4MeshInstanced(GLsizei count, GLuint instanceBuffer);
+	void DrawSphereMeshInstanced(GLsizei count, GLuint instanceBuffer);
+	void DrawHalfSphereMeshInstanced(GLsizei count, GLuint instanceBuffer);
+	void DrawTaperedCylinderMeshInstanced(
+		GLsizei count,
+		GLuint instanceBuffer,
+		bool bDrawTop = true,
+		bool bDrawBottom = true,
+		bool bDrawSides = true);
+	void DrawTorusMeshInstanced(GLsizei count, GLuint instanceBuffer);
+	void DrawHalfTorusMeshInstanced(GLsizei count, GLuint instanceBuffer);
+
+	// methods for binding the shared mesh buffers once
+	// and then drawing any number of mesh parts
+	void BindMeshBuffers();
+	void DrawMeshParts(MESH_TYPE mesh, unsigned int parts);
+	// bind a buffer of InstanceData entries to the shaders
+	// and draw mesh parts once for every instance
+	void BindInstanceBuffer(GLuint instanceBuffer, GLuint instanceCount);
+	void DrawMeshPartsInstanced(MESH_TYPE mesh, unsigned int parts, GLsizei instanceCount);
+
+	// build the indirect command of mesh parts, and draw a
+	// block of commands from the bound indirect buffer - every
+	// command of the block must use the same vertex layout, and
+	// the commands are only valid once BindMeshBuffers() has
+	// uploaded the meshes that were loaded
+	bool GetDrawCommand(
+		MESH_TYPE mesh,
+		unsigned int parts,
+		GLuint instanceCount,
+		GLuint baseInstance,
+		DRAW_COMMAND& command) const;
+	void MultiDrawMeshes(
+		VertexFormat::VERTEX_FORMAT format,
+		GLintptr commandOffset,
+		GLsizei commandCount);
+	// the same with the number of commands read from the bound
+	// parameter buffer - requires ARB_indirect_parameters
+	void MultiDrawMeshesCount(
+		VertexFormat::VERTEX_FORMAT format,
+		GLintptr commandOffset,
+		GLintptr countOffset,
+		GLsizei maxCommandCount);
+
+	// select the layout that a mesh is stored in on the GPU,
+	// meshes use the float layout until they are changed
+	void SetMeshVertexFormat(MESH_TYPE mesh, VertexFormat::VERTEX_FORMAT format);
+	// get the loaded float vertices of a mesh
+	const GLfloat* GetVertexData(MESH_TYPE mesh, GLuint& nVertices) const;
+	// get the local bounds of a loaded mesh
+	const MESH_BOUNDS& GetMeshBounds(MESH_TYPE mesh) const;
+	// get the layout that a mesh is stored in on the GPU
+	VertexFormat::VERTEX_FORMAT GetMeshVertexFormat(MESH_TYPE mesh) const;
+
+	// count of the draw calls sent to OpenGL
+	inline void ResetDrawCallCount()
+	{
+		m_drawCalls = 0;
+	}
+	inline unsigned int GetDrawCallCount() const
+	{
+		return(m_drawCalls);
+	}
+
 
 private:
 
@@ -97,5 +265,37 @@ private:
 
 	// called to set the memory layout 
 	// template for shader data
-	void SetShaderMemoryLayout();
+	void SetShaderMemoryLayout(VertexFormat::VERTEX_FORMAT format);
+
+	// get the GL data of a mesh type
+	const GLMesh& GetMesh(MESH_TYPE mesh) const;
+	GLMesh& GetMesh(MESH_TYPE mesh);
+
+	// called to append mesh data to the shared buffers
+	void AddMesh(
+		GLMesh& mesh,
+		const GLfloat* vertexData,
+		size_t floatCount,
+		const GLuint* indexData,
+		size_t indexCount);
+	void AddMesh(
+		GLMesh& mesh,
+		const ShapeGenerator::MESH_DATA& meshData);
+	// called to send the loaded mesh data to the GPU
+	void UploadMeshBuffers();
+	// called to draw a range of the indices of a mesh
+	void DrawMeshRange(
+		const GLMesh& mesh,
+		GLenum mode,
+		GLuint firstIndex,
+		GLuint indexCount,
+		GLsizei instanceCount);
+	// called to get the indices of the parts of a mesh
+	INDEX_RANGE GetPartsRange(
+		const GLMesh& glMesh,
+		MESH_TYPE mesh,
+		unsigned int parts) const;
+	// called to grow and attach the instance index attribute
+	void ReserveInstanceIndices(GLuint instanceCount);
+	void SetInstanceIndexLayout();
 };
\ No newline at end of file
@@ -0,0 +1,146 @@
+///////////////////////////////////////////////////////////////////////////////
+// vertexformat.cpp
+// ============
+// the layouts that mesh vertices can be stored in on the GPU
+///////////////////////////////////////////////////////////////////////////////
+
+#include "VertexFormat.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// number of floats in one vertex of the float layout
+	const int FLOATS_PER_POSITION = 3;
+	const int FLOATS_PER_NORMAL = 3;
+	const int FLOATS_PER_UV = 2;
+	const int FLOATS_PER_VERTEX = FLOATS_PER_POSITION + FLOATS_PER_NORMAL + FLOATS_PER_UV;
+
+	// the vertex fetch reads the compact layout with these types
+	static_assert(sizeof(VertexFormat::COMPACT_VERTEX) == 16, "compact vertices must be 16 bytes");
+	static_assert(offsetof(VertexFormat::COMPACT_VERTEX, normal) == 8, "normal must follow the position");
+	static_assert(offsetof(VertexFormat::COMPACT_VERTEX, UV) == 12, "UV must follow the normal");
+
+	const float RADIANS_TO_DEGREES = 57.2957795130823208768f;
+}
+
+/***********************************************************
+ *  GetVertexSize()
+ *
+ *  This function is used for getting the number of bytes
+ *  of one vertex in the passed in layout.
+ ***********************************************************/
+size_t VertexFormat::GetVertexSize(VERTEX_FORMAT format)
+{
+	if (format == VERTEX_FORMAT_COMPACT)
+	{
+		return(sizeof(COMPACT_VERTEX));
+	}
+
+	return(sizeof(GLfloat) * FLOATS_PER_VERTEX);
+}
+
+/***********************************************************
+ *  PackVertex()
+ *
+ *  This function is used for packing one vertex of the
+ *  float layout into the compact layout.  The normal is
+ *  normalized first and the texture coordinates are
+ *  clamped to the range of the unsigned shorts.
+ ***********************************************************/
+void VertexFormat::PackVertex(const GLfloat* vertex, COMPACT_VERTEX& packed)
+{
+	glm::vec3 normal(vertex[3], vertex[4], vertex[5]);
+	float length = glm::length(normal);
+
+	if (length > 0.0f)
+	{
+		normal /= length;
+	}
+
+	packed.position[0] = glm::packHalf1x16(vertex[0]);
+	packed.position[1] = glm::packHalf1x16(vertex[1]);
+	packed.position[2] = glm::packHalf1x16(vertex[2]);
+	packed.position[3] = glm::packHalf1x16(1.0f);
+	packed.normal = glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+
+	glm::uint32 UV = glm::packUnorm2x16(glm::vec2(vertex[6], vertex[7]));
+	packed.UV[0] = (uint16_t)(UV & 0xFFFF);
+	packed.UV[1] = (uint16_t)(UV >> 16);
+}
+
+/***********************************************************
+ *  UnpackVertex()
+ *
+ *  This function is used for converting a compact vertex
+ *  back into the float layout, the same way that the
+ *  vertex fetch converts it for the shaders.
+ ***********************************************************/
+void VertexFormat::UnpackVertex(const COMPACT_VERTEX& packed, GLfloat* vertex)
+{
+	glm::vec4 normal = glm::unpackSnorm3x10_1x2(packed.normal);
+	glm::vec2 UV = glm::unpackUnorm2x16((glm::uint32)packed.UV[0] | ((glm::uint32)packed.UV[1] << 16));
+
+	vertex[0] = glm::unpackHalf1x16(packed.position[0]);
+	vertex[1] = glm::unpackHalf1x16(packed.position[1]);
+	vertex[2] = glm::unpackHalf1x16(packed.position[2]);
+	vertex[3] = normal.x;
+	vertex[4] = normal.y;
+	vertex[5] = normal.z;
+	vertex[6] = UV.x;
+	vertex[7] = UV.y;
+}
+
+/***********************************************************
+ *  MeasurePrecision()
+ *
+ *  This function is used for measuring how far the packed
+ *  vertices of a mesh are from the original ones.  The
+ *  normals are compared by their angle after normalizing
+ *  both of them, which is what the lighting sees.
+ ***********************************************************/
+void VertexFormat::MeasurePrecision(const GLfloat* vertices, size_t vertexCount, PRECISION_REPORT& report)
+{
+	report = {};
+
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const GLfloat* original = vertices + (i * FLOATS_PER_VERTEX);
+		COMPACT_VERTEX packed;
+		GLfloat unpacked[FLOATS_PER_VERTEX];
+
+		PackVertex(original, packed);
+		UnpackVertex(packed, unpacked);
+
+		float positionError = glm::length(
+			glm::vec3(unpacked[0], unpacked[1], unpacked[2]) - glm::vec3(original[0], original[1], original[2]));
+		report.maxPositionError = std::max(report.maxPositionError, positionError);
+
+		glm::vec3 originalNormal(original[3], original[4], original[5]);
+		glm::vec3 unpackedNormal(unpacked[3], unpacked[4], unpacked[5]);
+		if ((glm::length(originalNormal) > 0.0f) && (glm::length(unpackedNormal) > 0.0f))
+		{
+			float cosine = glm::dot(glm::normalize(originalNormal), glm::normalize(unpackedNormal));
+			float angle = std::acos(glm::clamp(cosine, -1.0f, 1.0f)) * RADIANS_TO_DEGREES;
+			report.maxNormalErrorDegrees = std::max(report.maxNormalErrorDegrees, angle);
+		}
+
+		for (int j = 0; j < FLOATS_PER_UV; j++)
+		{
+			float UV = original[6 + j];
+			if ((UV < 0.0f) || (UV > 1.0f))
+			{
+				report.clampedUVs++;
+			}
+			else
+			{
+				report.maxUVError = std::max(report.maxUVError, std::abs(unpacked[6 + j] - UV));
+			}
+		}
+	}
+}
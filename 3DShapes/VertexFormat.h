@@ -0,0 +1,59 @@
+///////////////////////////////////////////////////////////////////////////////
+// vertexformat.h
+// ============
+// the layouts that mesh vertices can be stored in on the GPU
+//
+// Meshes are always generated as 8 floats per vertex (position, normal and
+// texture coordinates).  The compact layout packs the same vertex into 16
+// bytes with types that the vertex fetch converts back to floats, so the
+// shaders read both layouts through the same inputs.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace VertexFormat
+{
+	enum VERTEX_FORMAT
+	{
+		// float3 position, float3 normal, float2 UV - 32 bytes
+		VERTEX_FORMAT_FLOAT = 0,
+		// half4 position, snorm 2_10_10_10 normal, unorm16x2 UV - 16 bytes
+		VERTEX_FORMAT_COMPACT,
+		VERTEX_FORMAT_COUNT
+	};
+
+	// one vertex in the compact layout
+	struct COMPACT_VERTEX
+	{
+		uint16_t position[4];	// half floats, the last one is padding
+		uint32_t normal;		// GL_INT_2_10_10_10_REV
+		uint16_t UV[2];			// normalized unsigned shorts
+	};
+
+	// largest difference between the original and the packed
+	// vertices of a mesh
+	struct PRECISION_REPORT
+	{
+		float maxPositionError;
+		float maxNormalErrorDegrees;
+		float maxUVError;
+		// texture coordinates outside of 0..1 that were clamped
+		unsigned int clampedUVs;
+	};
+
+	// number of bytes of one vertex in the passed in layout
+	size_t GetVertexSize(VERTEX_FORMAT format);
+
+	// convert between the float and the compact layout
+	void PackVertex(const GLfloat* vertex, COMPACT_VERTEX& packed);
+	void UnpackVertex(const COMPACT_VERTEX& packed, GLfloat* vertex);
+
+	// pack and unpack the passed in float vertices and measure
+	// the error of the compact layout
+	void MeasurePrecision(const GLfloat* vertices, size_t vertexCount, PRECISION_REPORT& report);
+}
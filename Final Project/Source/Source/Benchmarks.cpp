@@ -0,0 +1,1023 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmarks.cpp
+// ============
+// timing runs of the engine code that are started from the command line
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Benchmarks.h"
+#include "BlockCompression.h"
+#include "FrustumCulling.h"
+#include "ImageCache.h"
+#include "MipmapGenerator.h"
+#include "SceneGraph.h"
+#include "SceneManager.h"
+#include "ShaderManager.h"
+#include "ShapeGenerator.h"
+#include "ShapeMeshes.h"
+#include "VertexFormat.h"
+#include "stb_image.h"
+
+#include <GL/glew.h>
+#include "GLFW/glfw3.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/transform.hpp>
+
+// declaration of global variables
+namespace
+{
+	const char* const BENCH_ARGUMENT = "--bench";
+
+	// every case is repeated for at least this long, and the
+	// fastest run is reported
+	const double MIN_BENCH_SECONDS = 0.25;
+	const int MIN_BENCH_RUNS = 3;
+
+	typedef std::chrono::high_resolution_clock BenchClock;
+
+	// size of the hidden window that the scene benchmarks
+	// render into, the same as the window of the scene
+	const int BENCH_WINDOW_WIDTH = 1000;
+	const int BENCH_WINDOW_HEIGHT = 800;
+	// synthetic objects added to the scene for the texture
+	// binding benchmark, half of them textured
+	const int BENCH_TEXTURED_OBJECTS = 20000;
+	// scene image that the block compression benchmark encodes,
+	// and the size of the part of it that is encoded
+	const char* const BENCH_COMPRESSION_IMAGE = "./textures/wood_base.jpg";
+	const int BENCH_COMPRESSION_SIZE = 512;
+	// scene image that is tiled into the images of the mipmap
+	// benchmark
+	const char* const BENCH_MIPMAP_IMAGE = "./textures/wood_base.jpg";
+	// directory of the images that the image cache benchmark
+	// decodes and caches, and the directory of the cache
+	const char* const BENCH_IMAGE_DIRECTORY = "./textures";
+	const char* const BENCH_IMAGE_CACHE_DIRECTORY = "./texturecache/bench";
+
+	/***********************************************************
+	 *  TimeRuns()
+	 *
+	 *  Repeats the passed in function and returns the time of
+	 *  the fastest run in milliseconds.
+	 ***********************************************************/
+	template <typename RUN>
+	double TimeRuns(RUN run)
+	{
+		double bestMilliseconds = 0.0;
+		double totalSeconds = 0.0;
+		int runs = 0;
+
+		while ((runs < MIN_BENCH_RUNS) || (totalSeconds < MIN_BENCH_SECONDS))
+		{
+			BenchClock::time_point start = BenchClock::now();
+			run();
+			std::chrono::duration<double> elapsed = BenchClock::now() - start;
+
+			if ((runs == 0) || ((elapsed.count() * 1000.0) < bestMilliseconds))
+			{
+				bestMilliseconds = elapsed.count() * 1000.0;
+			}
+			totalSeconds += elapsed.count();
+			runs++;
+		}
+
+		return(bestMilliseconds);
+	}
+
+	/***********************************************************
+	 *  TimeGeneration()
+	 *
+	 *  Repeats the generation of a mesh and returns the time
+	 *  of the fastest run in milliseconds.  The mesh data is
+	 *  kept between the runs, so only the first run includes
+	 *  the allocation of the buffers.
+	 ***********************************************************/
+	template <typename GENERATE>
+	double TimeGeneration(ShapeGenerator::MESH_DATA& mesh, GENERATE generate)
+	{
+		return(TimeRuns([&mesh, &generate]()
+			{
+				generate(mesh);
+			}));
+	}
+
+	/***********************************************************
+	 *  ReportGeneration()
+	 *
+	 *  Prints the result of one tessellation case.
+	 ***********************************************************/
+	void ReportGeneration(
+		const char* shape,
+		int targetTriangles,
+		const ShapeGenerator::MESH_DATA& mesh,
+		double milliseconds)
+	{
+		size_t triangles = mesh.indices.size() / 3;
+		size_t vertices = mesh.vertices.size() / ShapeGenerator::FLOATS_PER_VERTEX;
+
+		std::cout << std::fixed << std::setprecision(3)
+			<< std::left << std::setw(10) << shape
+			<< std::right << std::setw(9) << targetTriangles
+			<< std::setw(10) << triangles
+			<< std::setw(10) << vertices
+			<< std::setw(12) << milliseconds
+			<< std::setw(12) << std::setprecision(1) << ((triangles / 1000000.0) / (milliseconds / 1000.0))
+			<< std::defaultfloat << std::endl;
+	}
+
+	/***********************************************************
+	 *  BenchTessellation()
+	 *
+	 *  Times the generation of the curved primitives from about
+	 *  a thousand up to about a million triangles.  The segment
+	 *  and ring counts are picked to get close to the target
+	 *  number of triangles.
+	 ***********************************************************/
+	int BenchTessellation()
+	{
+		const int targets[] = { 1000, 10000, 100000, 1000000 };
+		ShapeGenerator::MESH_DATA mesh;
+
+		std::cout << "INFO: Tessellation benchmark - fastest of at least " << MIN_BENCH_RUNS << " runs" << std::endl;
+		std::cout << "shape        target generated  vertices    time(ms)  Mtris/sec" << std::endl;
+
+		for (int target : targets)
+		{
+			// sphere: 2 * segments * (rings - 1) triangles, with
+			// twice as many segments as rings
+			int rings = std::max(2, (int)std::lround(std::sqrt(target / 4.0)));
+			double milliseconds = TimeGeneration(mesh, [rings](ShapeGenerator::MESH_DATA& data)
+				{
+					ShapeGenerator::GenerateSphere(data, rings * 2, rings);
+				});
+			ReportGeneration("sphere", target, mesh, milliseconds);
+
+			// cylinder: 4 * segments triangles
+			int segments = std::max(3, target / 4);
+			milliseconds = TimeGeneration(mesh, [segments](ShapeGenerator::MESH_DATA& data)
+				{
+					ShapeGenerator::GenerateCylinder(data, segments, 1.0f, 1.0f);
+				});
+			ReportGeneration("cylinder", target, mesh, milliseconds);
+
+			// cone: 2 * segments triangles
+			segments = std::max(3, target / 2);
+			milliseconds = TimeGeneration(mesh, [segments](ShapeGenerator::MESH_DATA& data)
+				{
+					ShapeGenerator::GenerateCylinder(data, segments, 1.0f, 0.0f);
+				});
+			ReportGeneration("cone", target, mesh, milliseconds);
+
+			// torus: 2 * main * tube triangles, with as many main
+			// segments as tube segments
+			segments = std::max(3, (int)std::lround(std::sqrt(target / 2.0)));
+			milliseconds = TimeGeneration(mesh, [segments](ShapeGenerator::MESH_DATA& data)
+				{
+					ShapeGenerator::GenerateTorus(data, segments, segments, 0.2f);
+				});
+			ReportGeneration("torus", target, mesh, milliseconds);
+		}
+
+		return(EXIT_SUCCESS);
+	}
+
+	/***********************************************************
+	 *  ReportVertexFormat()
+	 *
+	 *  Prints the size of a mesh in both vertex layouts and
+	 *  the precision that is lost in the compact one.
+	 ***********************************************************/
+	void ReportVertexFormat(const char* shape, const GLfloat* vertices, size_t vertexCount)
+	{
+		VertexFormat::PRECISION_REPORT report;
+		size_t floatBytes = vertexCount * VertexFormat::GetVertexSize(VertexFormat::VERTEX_FORMAT_FLOAT);
+		size_t compactBytes = vertexCount * VertexFormat::GetVertexSize(VertexFormat::VERTEX_FORMAT_COMPACT);
+
+		VertexFormat::MeasurePrecision(vertices, vertexCount, report);
+
+		std::cout << std::left << std::setw(18) << shape
+			<< std::right << std::setw(9) << vertexCount
+			<< std::setw(11) << floatBytes
+			<< std::setw(11) << compactBytes
+			<< std::fixed << std::setprecision(6)
+			<< std::setw(12) << report.maxPositionError
+			<< std::setprecision(3) << std::setw(11) << report.maxNormalErrorDegrees
+			<< std::setprecision(6) << std::setw(11) << report.maxUVError
+			<< std::setw(9) << report.clampedUVs
+			<< std::defaultfloat << std::endl;
+	}
+
+	/***********************************************************
+	 *  BenchVertexFormat()
+	 *
+	 *  Reports the bytes fetched per mesh in the float and the
+	 *  compact vertex layout and how far the compact vertices
+	 *  are from the float ones, for every primitive at its
+	 *  default tessellation and for finely tessellated meshes.
+	 ***********************************************************/
+	int BenchVertexFormat()
+	{
+		const char* const meshNames[ShapeMeshes::MESH_TYPE_COUNT] = {
+			"box", "cone", "cylinder", "plane", "prism",
+			"pyramid3", "pyramid4", "sphere", "tapered cylinder", "torus" };
+		ShapeMeshes meshes;
+		ShapeGenerator::MESH_DATA mesh;
+
+		meshes.LoadBoxMesh();
+		meshes.LoadConeMesh();
+		meshes.LoadCylinderMesh();
+		meshes.LoadPlaneMesh();
+		meshes.LoadPrismMesh();
+		meshes.LoadPyramid3Mesh();
+		meshes.LoadPyramid4Mesh();
+		meshes.LoadSphereMesh();
+		meshes.LoadTaperedCylinderMesh();
+		meshes.LoadTorusMesh();
+
+		std::cout << "INFO: Vertex format report - "
+			<< VertexFormat::GetVertexSize(VertexFormat::VERTEX_FORMAT_FLOAT) << " byte float vertices, "
+			<< VertexFormat::GetVertexSize(VertexFormat::VERTEX_FORMAT_COMPACT) << " byte compact vertices" << std::endl;
+		std::cout << "shape              vertices float(B) compact(B)   max pos err max nrm deg max UV err  clamped" << std::endl;
+
+		for (int type = 0; type < ShapeMeshes::MESH_TYPE_COUNT; type++)
+		{
+			GLuint vertexCount = 0;
+			const GLfloat* vertices = meshes.GetVertexData((ShapeMeshes::MESH_TYPE)type, vertexCount);
+			ReportVertexFormat(meshNames[type], vertices, vertexCount);
+		}
+
+		ShapeGenerator::GenerateSphere(mesh, 512, 256);
+		ReportVertexFormat("sphere 512x256", mesh.vertices.data(), mesh.vertices.size() / ShapeGenerator::FLOATS_PER_VERTEX);
+		ShapeGenerator::GenerateCylinder(mesh, 4096, 1.0f, 1.0f);
+		ReportVertexFormat("cylinder 4096", mesh.vertices.data(), mesh.vertices.size() / ShapeGenerator::FLOATS_PER_VERTEX);
+		ShapeGenerator::GenerateTorus(mesh, 512, 256, 0.2f);
+		ReportVertexFormat("torus 512x256", mesh.vertices.data(), mesh.vertices.size() / ShapeGenerator::FLOATS_PER_VERTEX);
+
+		return(EXIT_SUCCESS);
+	}
+
+	/***********************************************************
+	 *  BenchCulling()
+	 *
+	 *  Times the frustum test of randomly placed, rotated and
+	 *  scaled boxes around a camera, with SSE and one object
+	 *  at a time, and checks that both agree.
+	 ***********************************************************/
+	int BenchCulling()
+	{
+		const int counts[] = { 1000, 10000, 100000, 1000000 };
+		const float sceneSize = 100.0f;
+		const glm::vec3 unitMin(-0.5f);
+		const glm::vec3 unitMax(0.5f);
+		const float unitRadius = glm::length(unitMax);
+		std::mt19937 random(330);
+		std::uniform_real_distribution<float> position(-sceneSize, sceneSize);
+		std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+		std::uniform_real_distribution<float> scale(0.1f, 5.0f);
+		FrustumCulling::FRUSTUM frustum;
+		FrustumCulling::BOUNDS_LIST bounds;
+		std::vector<uint8_t> visibleSIMD;
+		std::vector<uint8_t> visibleScalar;
+		size_t culledSIMD = 0;
+		size_t culledScalar = 0;
+
+		glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1000.0f / 800.0f, 0.1f, sceneSize);
+		glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 10.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		FrustumCulling::ExtractFrustum(projection * view, frustum);
+
+		std::cout << "INFO: Frustum culling benchmark - fastest of at least " << MIN_BENCH_RUNS << " runs" << std::endl;
+		std::cout << " objects    culled  scalar(ms)     SSE(ms)  speedup  SSE Mobj/sec  mismatches" << std::endl;
+
+		for (int count : counts)
+		{
+			bounds.Clear();
+			for (int i = 0; i < count; i++)
+			{
+				glm::mat4 model =
+					glm::translate(glm::mat4(1.0f), glm::vec3(position(random), position(random), position(random))) *
+					glm::rotate(glm::mat4(1.0f), glm::radians(angle(random)), glm::normalize(glm::vec3(1.0f, 2.0f, 3.0f))) *
+					glm::scale(glm::mat4(1.0f), glm::vec3(scale(random), scale(random), scale(random)));
+				glm::vec3 center;
+				glm::vec3 extents;
+				float radius = 0.0f;
+
+				FrustumCulling::TransformBounds(model, unitMin, unitMax, unitRadius, center, extents, radius);
+				bounds.Add(center, extents, radius);
+			}
+
+			double scalarMilliseconds = TimeRuns([&]()
+				{
+					culledScalar = FrustumCulling::CullBoundsScalar(frustum, bounds, visibleScalar);
+				});
+			double simdMilliseconds = TimeRuns([&]()
+				{
+					culledSIMD = FrustumCulling::CullBounds(frustum, bounds, visibleSIMD);
+				});
+
+			size_t mismatches = (culledSIMD > culledScalar) ? (culledSIMD - culledScalar) : (culledScalar - culledSIMD);
+			for (int i = 0; i < count; i++)
+			{
+				if (visibleSIMD[i] != visibleScalar[i])
+				{
+					mismatches++;
+				}
+			}
+
+			std::cout << std::fixed << std::setprecision(3)
+				<< std::setw(8) << count
+				<< std::setw(10) << culledSIMD
+				<< std::setw(12) << scalarMilliseconds
+				<< std::setw(12) << simdMilliseconds
+				<< std::setprecision(2) << std::setw(9) << (scalarMilliseconds / simdMilliseconds)
+				<< std::setprecision(1) << std::setw(14) << ((count / 1000000.0) / (simdMilliseconds / 1000.0))
+				<< std::setw(12) << mismatches
+				<< std::defaultfloat << std::endl;
+		}
+
+		return(EXIT_SUCCESS);
+	}
+
+	/***********************************************************
+	 *  BenchBlockCompression()
+	 *
+	 *  Times the block encoder on a part of a scene image for
+	 *  every format and quality preset - one texel at a time,
+	 *  with SSE, and with SSE on every core - and reports the
+	 *  quality of the result and whether the searches agree.
+	 ***********************************************************/
+	int BenchBlockCompression()
+	{
+		const TEXTURE_FORMAT formats[] = {
+			TEXTURE_FORMAT_BC1, TEXTURE_FORMAT_BC3, TEXTURE_FORMAT_BC4, TEXTURE_FORMAT_BC5, TEXTURE_FORMAT_BC7 };
+		const char* const presetNames[] = { "fast", "normal", "high" };
+		const int size = BENCH_COMPRESSION_SIZE;
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+
+		unsigned char* image = stbi_load(BENCH_COMPRESSION_IMAGE, &width, &height, &channels, 4);
+		if (NULL == image)
+		{
+			std::cout << "Could not load image:" << BENCH_COMPRESSION_IMAGE << std::endl;
+			return(EXIT_FAILURE);
+		}
+		if ((width < size) || (height < size))
+		{
+			std::cout << "Image is smaller than " << size << "x" << size << ":" << BENCH_COMPRESSION_IMAGE << std::endl;
+			stbi_image_free(image);
+			return(EXIT_FAILURE);
+		}
+
+		// the image has no alpha, so a ramp is added to give the
+		// alpha blocks something to encode
+		std::vector<uint8_t> pixels((size_t)size * size * 4);
+		for (int y = 0; y < size; y++)
+		{
+			std::memcpy(&pixels[(size_t)y * size * 4], &image[(size_t)y * width * 4], (size_t)size * 4);
+			for (int x = 0; x < size; x++)
+			{
+				pixels[((size_t)y * size + x) * 4 + 3] = (uint8_t)(x * 255 / (size - 1));
+			}
+		}
+		stbi_image_free(image);
+
+		std::vector<uint8_t> blocksScalar;
+		std::vector<uint8_t> blocksSIMD;
+		std::vector<uint8_t> blocksThreaded;
+		BlockCompression::ENCODE_OPTIONS options = {};
+
+		std::cout << "INFO: Block compression benchmark - " << size << "x" << size << " texels of "
+			<< BENCH_COMPRESSION_IMAGE << ", " << std::max((int)std::thread::hardware_concurrency(), 1)
+			<< " threads, fastest of at least " << MIN_BENCH_RUNS << " runs" << std::endl;
+		std::cout << " format  preset  scalar(ms)     SSE(ms)  speedup  threaded(ms)  Mtexel/sec  PSNR(dB)  mismatches" << std::endl;
+
+		for (TEXTURE_FORMAT format : formats)
+		{
+			for (int preset = 0; preset < 3; preset++)
+			{
+				options.quality = (BlockCompression::QUALITY)preset;
+				options.threadCount = 1;
+				options.bUseSIMD = false;
+				double scalarMilliseconds = TimeRuns([&]()
+					{
+						BlockCompression::CompressImage(format, pixels.data(), size, size, options, blocksScalar);
+					});
+				options.bUseSIMD = true;
+				double simdMilliseconds = TimeRuns([&]()
+					{
+						BlockCompression::CompressImage(format, pixels.data(), size, size, options, blocksSIMD);
+					});
+				options.threadCount = 0;
+				double threadedMilliseconds = TimeRuns([&]()
+					{
+						BlockCompression::CompressImage(format, pixels.data(), size, size, options, blocksThreaded);
+					});
+
+				size_t mismatches = 0;
+				for (size_t i = 0; i < blocksSIMD.size(); i++)
+				{
+					if ((blocksSIMD[i] != blocksScalar[i]) || (blocksSIMD[i] != blocksThreaded[i]))
+					{
+						mismatches++;
+					}
+				}
+
+				std::cout << std::fixed << std::setprecision(3)
+					<< std::setw(7) << TextureContainer::GetFormatName(format)
+					<< std::setw(8) << presetNames[preset]
+					<< std::setw(12) << scalarMilliseconds
+					<< std::setw(12) << simdMilliseconds
+					<< std::setprecision(2) << std::setw(9) << (scalarMilliseconds / simdMilliseconds)
+					<< std::setprecision(3) << std::setw(14) << threadedMilliseconds
+					<< std::setprecision(1) << std::setw(12) << (((double)size * size / 1000000.0) / (threadedMilliseconds / 1000.0))
+					<< std::setprecision(2) << std::setw(10)
+					<< BlockCompression::MeasurePSNR(format, pixels.data(), size, size, blocksSIMD)
+					<< std::setw(12) << mismatches
+					<< std::defaultfloat << std::endl;
+			}
+		}
+
+		return(EXIT_SUCCESS);
+	}
+
+	/***********************************************************
+	 *  ComposeWithMatrices()
+	 *
+	 *  Builds a transform matrix the way SetTransformations()
+	 *  used to, out of five full matrices, as the reference
+	 *  for the direct composition.
+	 ***********************************************************/
+	glm::mat4 ComposeWithMatrices(const SceneGraph::TRANSFORM& transform)
+	{
+		glm::mat4 scale = glm::scale(transform.scale);
+		glm::mat4 rotationX = glm::rotate(glm::radians(transform.rotationDegrees.x), glm::vec3(1.0f, 0.0f, 0.0f));
+		glm::mat4 rotationY = glm::rotate(glm::radians(transform.rotationDegrees.y), glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 rotationZ = glm::rotate(glm::radians(transform.rotationDegrees.z), glm::vec3(0.0f, 0.0f, 1.0f));
+		glm::mat4 translation = glm::translate(transform.position);
+
+		return(translation * rotationX * rotationY * rotationZ * scale);
+	}
+
+	/***********************************************************
+	 *  MaxMatrixError()
+	 *
+	 *  Returns the largest difference between the elements of
+	 *  two arrays of matrices.
+	 ***********************************************************/
+	float MaxMatrixError(const std::vector<glm::mat4>& reference, const std::vector<glm::mat4>& matrices)
+	{
+		float maxError = 0.0f;
+
+		for (size_t i = 0; i < reference.size(); i++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				for (int row = 0; row < 4; row++)
+				{
+					maxError = std::max(maxError, std::abs(reference[i][column][row] - matrices[i][column][row]));
+				}
+			}
+		}
+
+		return(maxError);
+	}
+
+	/***********************************************************
+	 *  BenchTransforms()
+	 *
+	 *  Times the composition of random scale, rotation and
+	 *  position records with five glm matrices, with the
+	 *  direct formula one at a time, and with the SSE batch,
+	 *  and reports how far the results are from the glm ones.
+	 ***********************************************************/
+	int BenchTransforms()
+	{
+		const int counts[] = { 1000, 10000, 100000, 1000000 };
+		std::mt19937 random(330);
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> angle(-360.0f, 360.0f);
+		std::uniform_real_distribution<float> scale(0.1f, 10.0f);
+		std::vector<SceneGraph::TRANSFORM> transforms;
+		std::vector<glm::mat4> reference;
+		std::vector<glm::mat4> direct;
+		std::vector<glm::mat4> batched;
+
+		std::cout << "INFO: Transform composition benchmark - fastest of at least " << MIN_BENCH_RUNS << " runs" << std::endl;
+		std::cout << "records  matrices(ms) direct(ms)    SSE(ms)  direct x    SSE x  direct err     SSE err" << std::endl;
+
+		for (int count : counts)
+		{
+			transforms.resize(count);
+			reference.resize(count);
+			direct.resize(count);
+			batched.resize(count);
+			for (SceneGraph::TRANSFORM& transform : transforms)
+			{
+				transform.scale = glm::vec3(scale(random), scale(random), scale(random));
+				transform.rotationDegrees = glm::vec3(angle(random), angle(random), angle(random));
+				transform.position = glm::vec3(position(random), position(random), position(random));
+			}
+
+			double matrixMilliseconds = TimeRuns([&]()
+				{
+					for (int i = 0; i < count; i++)
+					{
+						reference[i] = ComposeWithMatrices(transforms[i]);
+					}
+				});
+			double directMilliseconds = TimeRuns([&]()
+				{
+					for (int i = 0; i < count; i++)
+					{
+						direct[i] = SceneGraph::ComposeTransform(transforms[i]);
+					}
+				});
+			double batchedMilliseconds = TimeRuns([&]()
+				{
+					SceneGraph::ComposeTransforms(transforms.data(), transforms.size(), batched.data());
+				});
+
+			std::cout << std::fixed << std::setprecision(3)
+				<< std::setw(7) << count
+				<< std::setw(14) << matrixMilliseconds
+				<< std::setw(11) << directMilliseconds
+				<< std::setw(11) << batchedMilliseconds
+				<< std::setprecision(2) << std::setw(10) << (matrixMilliseconds / directMilliseconds)
+				<< std::setw(9) << (matrixMilliseconds / batchedMilliseconds)
+				<< std::scientific << std::setprecision(2)
+				<< std::setw(12) << MaxMatrixError(reference, direct)
+				<< std::setw(12) << MaxMatrixError(reference, batched)
+				<< std::defaultfloat << std::endl;
+		}
+
+		return(EXIT_SUCCESS);
+	}
+
+	/***********************************************************
+	 *  CreateBenchWindow()
+	 *
+	 *  Creates a hidden window with the same OpenGL context as
+	 *  the scene window, for the benchmarks that render.
+	 ***********************************************************/
+	GLFWwindow* CreateBenchWindow()
+	{
+		glfwInit();
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+		GLFWwindow* window = glfwCreateWindow(BENCH_WINDOW_WIDTH, BENCH_WINDOW_HEIGHT, "benchmark", NULL, NULL);
+		if (NULL == window)
+		{
+			std::cout << "Failed to create the benchmark window" << std::endl;
+			glfwTerminate();
+			return(NULL);
+		}
+		glfwMakeContextCurrent(window);
+
+		if (glewInit() != GLEW_OK)
+		{
+			std::cout << "Failed to initialize GLEW for the benchmark" << std::endl;
+			glfwDestroyWindow(window);
+			glfwTerminate();
+			return(NULL);
+		}
+
+		return(window);
+	}
+
+	/***********************************************************
+	 *  BenchTextureBinding()
+	 *
+	 *  Renders the scene with a field of textured synthetic
+	 *  objects once with every texture binding, and reports
+	 *  the binding that was used, the texture memory, the draw
+	 *  calls and the fastest frame.  A binding the driver does
+	 *  not support reports the units binding it fell back to.
+	 ***********************************************************/
+	int BenchTextureBinding()
+	{
+		const SceneManager::TEXTURE_BINDING bindings[] = {
+			SceneManager::TEXTURE_BINDING_UNITS,
+			SceneManager::TEXTURE_BINDING_ARRAYS,
+			SceneManager::TEXTURE_BINDING_BINDLESS };
+		const char* const bindingNames[] = { "units", "arrays", "bindless" };
+
+		GLFWwindow* window = CreateBenchWindow();
+		if (NULL == window)
+		{
+			return(EXIT_FAILURE);
+		}
+
+		{
+			ShaderManager shaderManager;
+			shaderManager.LoadShaders(
+				"../../Utilities/shaders/vertexShader.glsl",
+				"../../Utilities/shaders/fragmentShader.glsl");
+			shaderManager.use();
+
+			// look down at the field of synthetic objects
+			FrameData frameData = {};
+			frameData.view = glm::lookAt(glm::vec3(0.0f, 40.0f, 160.0f), glm::vec3(0.0f, -12.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+			frameData.projection = glm::perspective(
+				glm::radians(45.0f), (float)BENCH_WINDOW_WIDTH / (float)BENCH_WINDOW_HEIGHT, 0.1f, 400.0f);
+			frameData.viewPosition = glm::vec4(0.0f, 40.0f, 160.0f, 1.0f);
+
+			// the scenes write to the console while they load, so
+			// the results are only printed after the last run
+			std::vector<std::string> report;
+			for (SceneManager::TEXTURE_BINDING binding : bindings)
+			{
+				SceneManager* pSceneManager = new SceneManager(&shaderManager);
+				pSceneManager->EnableGPUCulling("../../Utilities/shaders/cullingShader.glsl");
+				pSceneManager->SetTextureBinding(binding);
+				pSceneManager->PrepareScene();
+				pSceneManager->AddSyntheticObjects(BENCH_TEXTURED_OBJECTS);
+				pSceneManager->FinishLoadingTextures();
+				shaderManager.UpdateFrameData(frameData);
+
+				double milliseconds = TimeRuns([pSceneManager]()
+					{
+						glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+						pSceneManager->RenderScene();
+						glFinish();
+					});
+
+				std::ostringstream line;
+				line << std::fixed << std::setprecision(3)
+					<< std::left << std::setw(10) << bindingNames[binding]
+					<< std::setw(9) << bindingNames[pSceneManager->GetTextureBinding()]
+					<< std::right << std::setw(12) << (pSceneManager->GetTextureMemory() / 1024)
+					<< std::setw(12) << pSceneManager->GetDrawCallCount()
+					<< std::setw(12) << milliseconds;
+				report.push_back(line.str());
+
+				delete pSceneManager;
+			}
+
+			std::cout << "INFO: Texture binding benchmark - " << BENCH_TEXTURED_OBJECTS
+				<< " synthetic objects, fastest of at least " << MIN_BENCH_RUNS << " frames" << std::endl;
+			std::cout << "binding   used     texture(KB)  draw calls   frame(ms)" << std::endl;
+			for (const std::string& line : report)
+			{
+				std::cout << line << std::endl;
+			}
+		}
+
+		glfwDestroyWindow(window);
+		glfwTerminate();
+
+		return(EXIT_SUCCESS);
+	}
+
+	/***********************************************************
+	 *  BenchMipmaps()
+	 *
+	 *  Times the mipmap chain of square images built by the
+	 *  driver with glGenerateMipmap, and built on the CPU - one
+	 *  channel at a time, with SSE, with AVX2 when the CPU has
+	 *  it, and on every core - along with the upload of the
+	 *  levels that the CPU built.
+	 ***********************************************************/
+	int BenchMipmaps()
+	{
+		const int sizes[] = { 1024, 2048, 4096 };
+		int imageWidth = 0;
+		int imageHeight = 0;
+		int channels = 0;
+
+		unsigned char* image = stbi_load(BENCH_MIPMAP_IMAGE, &imageWidth, &imageHeight, &channels, 3);
+		if (NULL == image)
+		{
+			std::cout << "Could not load image:" << BENCH_MIPMAP_IMAGE << std::endl;
+			return(EXIT_FAILURE);
+		}
+
+		GLFWwindow* window = CreateBenchWindow();
+		if (NULL == window)
+		{
+			stbi_image_free(image);
+			return(EXIT_FAILURE);
+		}
+
+		GLuint textureID = 0;
+		glGenTextures(1, &textureID);
+		glBindTexture(GL_TEXTURE_2D, textureID);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+		MipmapGenerator::MIPMAP_OPTIONS options = {};
+		options.bSRGB = true;
+		options.bPreserveCoverage = false;
+		std::vector<uint8_t> pixels;
+		std::vector<std::vector<uint8_t>> levels;
+
+		std::cout << "INFO: Mipmap benchmark - RGB images tiled from " << BENCH_MIPMAP_IMAGE << ", "
+			<< std::max((int)std::thread::hardware_concurrency(), 1) << " threads, AVX2 "
+			<< ((MipmapGenerator::IsAVX2Supported() == true) ? "supported" : "not supported") << ", fastest of at least "
+			<< MIN_BENCH_RUNS << " runs" << std::endl;
+		std::cout << "  size  glGenerateMipmap(ms)  box scalar(ms)  box SSE(ms)  box AVX2(ms)  box threaded(ms)"
+			<< "  Kaiser threaded(ms)  upload(ms)" << std::endl;
+
+		for (int size : sizes)
+		{
+			pixels.resize((size_t)size * size * 3);
+			for (int y = 0; y < size; y++)
+			{
+				for (int x = 0; x < size; x++)
+				{
+					std::memcpy(&pixels[((size_t)y * size + x) * 3],
+						&image[((size_t)(y % imageHeight) * imageWidth + (x % imageWidth)) * 3], 3);
+				}
+			}
+
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, size, size, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+			double driverMilliseconds = TimeRuns([]()
+				{
+					glGenerateMipmap(GL_TEXTURE_2D);
+					glFinish();
+				});
+
+			options.filter = MipmapGenerator::FILTER_BOX;
+			options.threadCount = 1;
+			options.bUseSIMD = false;
+			options.bUseAVX2 = false;
+			double scalarMilliseconds = TimeRuns([&]()
+				{
+					MipmapGenerator::GenerateMipmaps(pixels.data(), size, size, 3, options, levels);
+				});
+			options.bUseSIMD = true;
+			double simdMilliseconds = TimeRuns([&]()
+				{
+					MipmapGenerator::GenerateMipmaps(pixels.data(), size, size, 3, options, levels);
+				});
+			options.bUseAVX2 = true;
+			double avx2Milliseconds = TimeRuns([&]()
+				{
+					MipmapGenerator::GenerateMipmaps(pixels.data(), size, size, 3, options, levels);
+				});
+			options.threadCount = 0;
+			double threadedMilliseconds = TimeRuns([&]()
+				{
+					MipmapGenerator::GenerateMipmaps(pixels.data(), size, size, 3, options, levels);
+				});
+			options.filter = MipmapGenerator::FILTER_KAISER;
+			double kaiserMilliseconds = TimeRuns([&]()
+				{
+					MipmapGenerator::GenerateMipmaps(pixels.data(), size, size, 3, options, levels);
+				});
+
+			// the levels below the image, which glGenerateMipmap
+			// has already given their sizes
+			double uploadMilliseconds = TimeRuns([&]()
+				{
+					int levelSize = size;
+					for (int level = 0; level < (int)levels.size(); level++)
+					{
+						levelSize = std::max(levelSize / 2, 1);
+						glTexSubImage2D(GL_TEXTURE_2D, level + 1, 0, 0, levelSize, levelSize,
+							GL_RGB, GL_UNSIGNED_BYTE, levels[level].data());
+					}
+					glFinish();
+				});
+
+			std::cout << std::fixed << std::setprecision(3)
+				<< std::setw(6) << size
+				<< std::setw(22) << driverMilliseconds
+				<< std::setw(16) << scalarMilliseconds
+				<< std::setw(13) << simdMilliseconds
+				<< std::setw(14) << avx2Milliseconds
+				<< std::setw(18) << threadedMilliseconds
+				<< std::setw(21) << kaiserMilliseconds
+				<< std::setw(12) << uploadMilliseconds
+				<< std::defaultfloat << std::endl;
+		}
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glDeleteTextures(1, &textureID);
+		stbi_image_free(image);
+
+		glfwDestroyWindow(window);
+		glfwTerminate();
+
+		return(EXIT_SUCCESS);
+	}
+
+	/***********************************************************
+	 *  BenchImageCache()
+	 *
+	 *  Times the loading of every scene image the way the
+	 *  texture loader does it - decoding the file and building
+	 *  its mipmaps, against reading both from the image cache
+	 *  - along with hashing the file, which is only needed when
+	 *  its time changed.
+	 ***********************************************************/
+	int BenchImageCache()
+	{
+		std::vector<std::string> filenames;
+		std::error_code error;
+		for (const std::filesystem::directory_entry& entry :
+			std::filesystem::directory_iterator(BENCH_IMAGE_DIRECTORY, error))
+		{
+			std::string extension = entry.path().extension().string();
+			if ((extension == ".jpg") || (extension == ".jpeg") || (extension == ".png"))
+			{
+				filenames.push_back(entry.path().string());
+			}
+		}
+		std::sort(filenames.begin(), filenames.end());
+
+		// the same options as the texture loader
+		MipmapGenerator::MIPMAP_OPTIONS options = {};
+		options.filter = MipmapGenerator::FILTER_BOX;
+		options.bSRGB = true;
+		options.bPreserveCoverage = false;
+		options.threadCount = 0;
+		options.bUseSIMD = true;
+		options.bUseAVX2 = true;
+		stbi_set_flip_vertically_on_load(true);
+
+		ImageCache cache;
+		if (cache.Enable(BENCH_IMAGE_CACHE_DIRECTORY, true, options) == false)
+		{
+			std::cout << "Could not use the cache directory:" << BENCH_IMAGE_CACHE_DIRECTORY << std::endl;
+			return(EXIT_FAILURE);
+		}
+
+		std::cout << "INFO: Image cache benchmark - images in " << BENCH_IMAGE_DIRECTORY
+			<< ", fastest of at least " << MIN_BENCH_RUNS << " runs" << std::endl;
+		std::cout << "  image                       size  decode+mipmaps(ms)  hash(ms)  cache read(ms)  match"
+			<< std::endl;
+
+		double decodeTotal = 0.0;
+		double readTotal = 0.0;
+		for (const std::string& filename : filenames)
+		{
+			std::vector<uint8_t> contents;
+			ImageCache::SOURCE_STAMP stamp = {};
+			if ((ImageCache::GetSourceStamp(filename.c_str(), stamp) == false) ||
+				(ImageCache::ReadFile(filename.c_str(), contents) == false))
+			{
+				continue;
+			}
+
+			int width = 0;
+			int height = 0;
+			int channels = 0;
+			std::vector<std::vector<uint8_t>> mipmaps;
+			double decodeMilliseconds = TimeRuns([&]()
+				{
+					std::vector<uint8_t> file;
+					ImageCache::ReadFile(filename.c_str(), file);
+					unsigned char* pixels = stbi_load_from_memory(
+						file.data(), (int)file.size(), &width, &height, &channels, 0);
+					if (NULL != pixels)
+					{
+						MipmapGenerator::GenerateMipmaps(pixels, width, height, channels, options, mipmaps);
+						stbi_image_free(pixels);
+					}
+				});
+			double hashMilliseconds = TimeRuns([&]()
+				{
+					volatile uint64_t hash = ImageCache::HashContent(contents.data(), contents.size(), 0);
+					(void)hash;
+				});
+
+			unsigned char* pixels = stbi_load_from_memory(
+				contents.data(), (int)contents.size(), &width, &height, &channels, 0);
+			if (NULL == pixels)
+			{
+				continue;
+			}
+			MipmapGenerator::GenerateMipmaps(pixels, width, height, channels, options, mipmaps);
+			cache.Store(filename.c_str(), stamp, contents, pixels, width, height, channels, mipmaps);
+
+			int cachedWidth = 0;
+			int cachedHeight = 0;
+			int cachedChannels = 0;
+			std::vector<uint8_t> cachedPixels;
+			std::vector<std::vector<uint8_t>> cachedMipmaps;
+			bool bMatch = true;
+			double readMilliseconds = TimeRuns([&]()
+				{
+					ImageCache::SOURCE_STAMP cachedStamp = {};
+					bMatch = cache.Load(filename.c_str(), cachedStamp, cachedWidth, cachedHeight, cachedChannels,
+						cachedPixels, cachedMipmaps) && bMatch;
+				});
+			bMatch = (bMatch == true) &&
+				(std::memcmp(cachedPixels.data(), pixels, cachedPixels.size()) == 0) &&
+				(cachedMipmaps == mipmaps);
+			stbi_image_free(pixels);
+
+			decodeTotal += decodeMilliseconds;
+			readTotal += readMilliseconds;
+
+			std::ostringstream size;
+			size << width << "x" << height << "x" << channels;
+			std::cout << "  " << std::left << std::setw(26) << std::filesystem::path(filename).filename().string()
+				<< std::right << std::setw(12) << size.str()
+				<< std::fixed << std::setprecision(3)
+				<< std::setw(20) << decodeMilliseconds
+				<< std::setw(10) << hashMilliseconds
+				<< std::setw(16) << readMilliseconds
+				<< std::setw(7) << ((bMatch == true) ? "yes" : "NO")
+				<< std::defaultfloat << std::endl;
+		}
+
+		std::cout << "INFO: Image cache benchmark - " << std::fixed << std::setprecision(1) << decodeTotal
+			<< " ms decoding, " << readTotal << " ms reading from the cache" << std::defaultfloat << std::endl;
+
+		cache.Disable();
+		std::filesystem::remove_all(BENCH_IMAGE_CACHE_DIRECTORY, error);
+
+		return(EXIT_SUCCESS);
+	}
+
+	// the benchmarks that can be requested by name
+	struct BENCHMARK
+	{
+		const char* name;
+		int (*run)();
+	};
+
+	const BENCHMARK g_Benchmarks[] = {
+		{ "tessellation", BenchTessellation },
+		{ "vertexformat", BenchVertexFormat },
+		{ "culling", BenchCulling },
+		{ "transforms", BenchTransforms },
+		{ "texturebinding", BenchTextureBinding },
+		{ "blockcompression", BenchBlockCompression },
+		{ "mipmaps", BenchMipmaps },
+		{ "imagecache", BenchImageCache }
+	};
+}
+
+/***********************************************************
+ *  IsRequested()
+ *
+ *  This function is used for checking the command line for
+ *  the benchmark argument.
+ ***********************************************************/
+bool Benchmarks::IsRequested(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], BENCH_ARGUMENT) == 0)
+		{
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This function is used for running the benchmark that
+ *  is named after the benchmark argument, or for listing
+ *  the available benchmarks when no known name was given.
+ ***********************************************************/
+int Benchmarks::Run(int argc, char* argv[])
+{
+	const char* name = NULL;
+
+	for (int i = 1; i < (argc - 1); i++)
+	{
+		if (std::strcmp(argv[i], BENCH_ARGUMENT) == 0)
+		{
+			name = argv[i + 1];
+		}
+	}
+
+	for (const BENCHMARK& benchmark : g_Benchmarks)
+	{
+		if ((NULL != name) && (std::strcmp(name, benchmark.name) == 0))
+		{
+			return(benchmark.run());
+		}
+	}
+
+	std::cout << "usage: " << BENCH_ARGUMENT << " <name>, available benchmarks:" << std::endl;
+	for (const BENCHMARK& benchmark : g_Benchmarks)
+	{
+		std::cout << "    " << benchmark.name << std::endl;
+	}
+
+	return((NULL == name) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
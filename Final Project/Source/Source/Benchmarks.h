@@ -0,0 +1,18 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmarks.h
+// ============
+// timing runs of the engine code that are started from the command line
+//
+// Starting the application with "--bench <name>" runs the named benchmark
+// instead of opening the scene, "--bench" on its own lists the benchmarks.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+namespace Benchmarks
+{
+	// check if a benchmark was requested on the command line
+	bool IsRequested(int argc, char* argv[]);
+	// run the requested benchmark and return the exit code
+	int Run(int argc, char* argv[]);
+}
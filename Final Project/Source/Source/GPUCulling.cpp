@@ -0,0 +1,409 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculling.cpp
+// ============
+// test the objects against the camera frustum on the GPU
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GPUCulling.h"
+
+#include <algorithm>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// must match local_size_x in cullingShader.glsl
+	const GLuint CULL_WORKGROUP_SIZE = 64;
+
+	const char* const g_FrustumPlanesName = "frustumPlanes";
+	const char* const g_ObjectCountName = "objectCount";
+}
+
+/***********************************************************
+ *  GPUCulling()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GPUCulling::GPUCulling()
+{
+	m_pShaderManager = NULL;
+	m_program = 0;
+	m_frustumPlanesLocation = -1;
+	m_objectCountLocation = -1;
+	m_firstChanged = 0;
+	m_lastChanged = 0;
+	m_bLayoutChanged = false;
+	m_objectBuffer = 0;
+	m_instanceBuffer = 0;
+	m_commandBuffer = 0;
+	m_countBuffer = 0;
+	m_queryFrame = 0;
+	m_cullMilliseconds = 0.0;
+	m_drawMilliseconds = 0.0;
+
+	for (int i = 0; i < QUERY_FRAMES; i++)
+	{
+		m_cullQueries[i] = 0;
+		m_drawQueries[i] = 0;
+		m_bCullIssued[i] = false;
+		m_bDrawIssued[i] = false;
+	}
+}
+
+/***********************************************************
+ *  ~GPUCulling()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GPUCulling::~GPUCulling()
+{
+	if (m_program == 0)
+	{
+		return;
+	}
+
+	GLuint buffers[] = { m_objectBuffer, m_instanceBuffer, m_commandBuffer, m_countBuffer };
+	glDeleteBuffers(4, buffers);
+	glDeleteQueries(QUERY_FRAMES, m_cullQueries);
+	glDeleteQueries(QUERY_FRAMES, m_drawQueries);
+	GLStateCache::ForgetProgram(m_program);
+	glDeleteProgram(m_program);
+	m_program = 0;
+	m_pShaderManager = NULL;
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for loading the culling compute
+ *  program and for creating the timer queries.  Drawing a
+ *  count that was written on the GPU needs OpenGL 4.6 or
+ *  the ARB_indirect_parameters extension.
+ ***********************************************************/
+bool GPUCulling::Initialize(ShaderManager* pShaderManager, const char* computeShaderPath)
+{
+	if ((GLEW_ARB_compute_shader == GL_FALSE) || (GLEW_ARB_indirect_parameters == GL_FALSE))
+	{
+		std::cout << "INFO: GPU culling is not supported, the objects are culled on the CPU" << std::endl;
+		return(false);
+	}
+
+	m_pShaderManager = pShaderManager;
+	m_program = m_pShaderManager->LoadComputeShader(computeShaderPath);
+	if (m_program == 0)
+	{
+		return(false);
+	}
+
+	// the locations are only looked up once
+	m_frustumPlanesLocation = glGetUniformLocation(m_program, g_FrustumPlanesName);
+	m_objectCountLocation = glGetUniformLocation(m_program, g_ObjectCountName);
+
+	glGenQueries(QUERY_FRAMES, m_cullQueries);
+	glGenQueries(QUERY_FRAMES, m_drawQueries);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the objects and
+ *  groups.  The GPU buffers are replaced once new objects
+ *  have been added.
+ ***********************************************************/
+void GPUCulling::Clear()
+{
+	m_objects.clear();
+	m_instances.clear();
+	m_groupSizes.clear();
+	m_groupFirstCommands.clear();
+	m_firstChanged = 0;
+	m_lastChanged = 0;
+	m_bLayoutChanged = true;
+}
+
+/***********************************************************
+ *  AddGroup()
+ *
+ *  This method is used for adding an empty group and for
+ *  returning its index.
+ ***********************************************************/
+int GPUCulling::AddGroup()
+{
+	m_groupSizes.push_back(0);
+	m_groupFirstCommands.push_back(0);
+	m_bLayoutChanged = true;
+
+	return((int)m_groupSizes.size() - 1);
+}
+
+/***********************************************************
+ *  AddObject()
+ *
+ *  This method is used for adding an object to a group and
+ *  for returning its index.  The object has no bounds until
+ *  SetObject() is called for it.
+ ***********************************************************/
+int GPUCulling::AddObject(int group, const ShapeMeshes::DRAW_COMMAND& command)
+{
+	CullObjectData object = {};
+	InstanceData instance = {};
+
+	object.group = (unsigned int)group;
+	object.indexCount = command.count;
+	object.firstIndex = command.firstIndex;
+	object.baseVertex = command.baseVertex;
+
+	m_objects.push_back(object);
+	m_instances.push_back(instance);
+	m_groupSizes[group]++;
+	m_bLayoutChanged = true;
+
+	return((int)m_objects.size() - 1);
+}
+
+/***********************************************************
+ *  SetObject()
+ *
+ *  This method is used for changing the instance values and
+ *  the world bounds of an object, and for widening the range
+ *  of objects that are uploaded by the next Cull().
+ ***********************************************************/
+void GPUCulling::SetObject(
+	int object,
+	const InstanceData& instance,
+	const glm::vec3& boundsCenter,
+	const glm::vec3& boundsExtents,
+	float boundsRadius)
+{
+	m_objects[object].centerRadius = glm::vec4(boundsCenter, boundsRadius);
+	m_objects[object].extents = boundsExtents;
+	m_instances[object] = instance;
+
+	if (m_firstChanged >= m_lastChanged)
+	{
+		m_firstChanged = object;
+		m_lastChanged = object + 1;
+	}
+	else
+	{
+		m_firstChanged = std::min(m_firstChanged, (size_t)object);
+		m_lastChanged = std::max(m_lastChanged, (size_t)object + 1);
+	}
+}
+
+/***********************************************************
+ *  UploadLayout()
+ *
+ *  This method is used for giving every group its range of
+ *  command slots, one slot for each of its objects, and for
+ *  replacing the GPU buffers with ones of the new size.
+ ***********************************************************/
+void GPUCulling::UploadLayout()
+{
+	GLuint firstCommand = 0;
+	for (size_t group = 0; group < m_groupSizes.size(); group++)
+	{
+		m_groupFirstCommands[group] = firstCommand;
+		firstCommand += m_groupSizes[group];
+	}
+	for (CullObjectData& object : m_objects)
+	{
+		object.firstCommand = m_groupFirstCommands[object.group];
+	}
+
+	if (m_objectBuffer == 0)
+	{
+		glGenBuffers(1, &m_objectBuffer);
+		glGenBuffers(1, &m_instanceBuffer);
+		glGenBuffers(1, &m_commandBuffer);
+		glGenBuffers(1, &m_countBuffer);
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_objectBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_objects.size() * sizeof(CullObjectData), m_objects.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instanceBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_instances.size() * sizeof(InstanceData), m_instances.data(), GL_DYNAMIC_DRAW);
+	// the commands and counts are only written by the GPU
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_commandBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_objects.size() * sizeof(ShapeMeshes::DRAW_COMMAND), NULL, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_countBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_groupSizes.size() * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	m_bLayoutChanged = false;
+	m_firstChanged = 0;
+	m_lastChanged = 0;
+}
+
+/***********************************************************
+ *  UploadChanges()
+ *
+ *  This method is used for uploading the objects that were
+ *  changed since the last pass, as one range that covers
+ *  all of them.
+ ***********************************************************/
+void GPUCulling::UploadChanges()
+{
+	const size_t count = m_lastChanged - m_firstChanged;
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_objectBuffer);
+	glBufferSubData(
+		GL_SHADER_STORAGE_BUFFER,
+		m_firstChanged * sizeof(CullObjectData),
+		count * sizeof(CullObjectData),
+		&m_objects[m_firstChanged]);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instanceBuffer);
+	glBufferSubData(
+		GL_SHADER_STORAGE_BUFFER,
+		m_firstChanged * sizeof(InstanceData),
+		count * sizeof(InstanceData),
+		&m_instances[m_firstChanged]);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	m_firstChanged = 0;
+	m_lastChanged = 0;
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method is used for testing all of the objects
+ *  against the frustum with one compute dispatch.  The
+ *  counts are cleared first, and every visible object adds
+ *  its command to its group.  The barrier makes the
+ *  commands and counts visible to the indirect draws.
+ ***********************************************************/
+void GPUCulling::Cull(const FrustumCulling::FRUSTUM& frustum)
+{
+	if ((m_program == 0) || (m_objects.empty() == true))
+	{
+		return;
+	}
+
+	if (m_bLayoutChanged == true)
+	{
+		UploadLayout();
+	}
+	else if (m_firstChanged < m_lastChanged)
+	{
+		UploadChanges();
+	}
+
+	// the queries of this frame replace the oldest ones
+	m_queryFrame = (m_queryFrame + 1) % QUERY_FRAMES;
+	ReadQueries();
+
+	const GLuint objectCount = (GLuint)m_objects.size();
+	const GLuint zero = 0;
+
+	glProgramUniform4fv(m_program, m_frustumPlanesLocation, 6, &frustum.planes[0].x);
+	glProgramUniform1ui(m_program, m_objectCountLocation, objectCount);
+
+	glBeginQuery(GL_TIME_ELAPSED, m_cullQueries[m_queryFrame]);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_countBuffer);
+	glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_OBJECT_BLOCK_BINDING, m_objectBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_COMMAND_BLOCK_BINDING, m_commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_COUNT_BLOCK_BINDING, m_countBuffer);
+
+	GLStateCache::UseProgram(m_program);
+	glDispatchCompute((objectCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+
+	glEndQuery(GL_TIME_ELAPSED);
+	m_bCullIssued[m_queryFrame] = true;
+
+	m_pShaderManager->use();
+}
+
+/***********************************************************
+ *  BeginDraws()
+ *
+ *  This method is used for binding the commands written by
+ *  the last pass as the indirect buffer and their counts as
+ *  the parameter buffer, and for starting the draw timer.
+ ***********************************************************/
+void GPUCulling::BeginDraws()
+{
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	glBindBuffer(GL_PARAMETER_BUFFER_ARB, m_countBuffer);
+
+	glBeginQuery(GL_TIME_ELAPSED, m_drawQueries[m_queryFrame]);
+}
+
+/***********************************************************
+ *  DrawGroup()
+ *
+ *  This method is used for drawing the visible objects of
+ *  a group with one call.  The number of commands is read
+ *  by the GPU from the count of the group.
+ ***********************************************************/
+void GPUCulling::DrawGroup(ShapeMeshes* pMeshes, int group, VertexFormat::VERTEX_FORMAT format)
+{
+	if (m_groupSizes[group] == 0)
+	{
+		return;
+	}
+
+	pMeshes->MultiDrawMeshesCount(
+		format,
+		m_groupFirstCommands[group] * sizeof(ShapeMeshes::DRAW_COMMAND),
+		group * sizeof(GLuint),
+		(GLsizei)m_groupSizes[group]);
+}
+
+/***********************************************************
+ *  EndDraws()
+ *
+ *  This method is used for stopping the draw timer and for
+ *  unbinding the command and count buffers.
+ ***********************************************************/
+void GPUCulling::EndDraws()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+	m_bDrawIssued[m_queryFrame] = true;
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindBuffer(GL_PARAMETER_BUFFER_ARB, 0);
+}
+
+/***********************************************************
+ *  ReadQueries()
+ *
+ *  This method is used for reading the timer queries of
+ *  the current query frame, which were issued QUERY_FRAMES
+ *  frames ago.  A result that is not ready yet is skipped
+ *  rather than waited for.
+ ***********************************************************/
+void GPUCulling::ReadQueries()
+{
+	GLint available = 0;
+	GLuint64 elapsed = 0;
+
+	if (m_bCullIssued[m_queryFrame] == true)
+	{
+		glGetQueryObjectiv(m_cullQueries[m_queryFrame], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available != 0)
+		{
+			glGetQueryObjectui64v(m_cullQueries[m_queryFrame], GL_QUERY_RESULT, &elapsed);
+			m_cullMilliseconds = (double)elapsed / 1.0e6;
+		}
+		m_bCullIssued[m_queryFrame] = false;
+	}
+
+	if (m_bDrawIssued[m_queryFrame] == true)
+	{
+		glGetQueryObjectiv(m_drawQueries[m_queryFrame], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available != 0)
+		{
+			glGetQueryObjectui64v(m_drawQueries[m_queryFrame], GL_QUERY_RESULT, &elapsed);
+			m_drawMilliseconds = (double)elapsed / 1.0e6;
+		}
+		m_bDrawIssued[m_queryFrame] = false;
+	}
+}
@@ -0,0 +1,148 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculling.h
+// ============
+// test the objects against the camera frustum on the GPU
+//
+// The world bounds, draw records and instance values of every object stay
+// in GPU buffers and are only written again when an object changes.  Each
+// frame a compute pass tests all of the objects against the frustum and
+// appends a draw command for every visible object to the command range of
+// its group, counting the commands with an atomic counter.  The groups are
+// then drawn with glMultiDrawElementsIndirectCount, so the visible set is
+// never read back to the CPU.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrustumCulling.h"
+#include "ShaderManager.h"
+#include "ShapeMeshes.h"
+#include "UniformBlocks.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  GPUCulling
+ *
+ *  This class contains the GPU buffers of the culled
+ *  objects, the compute program that culls them and the
+ *  timer queries of the culling and drawing passes.
+ ***********************************************************/
+class GPUCulling
+{
+public:
+	// constructor
+	GPUCulling();
+	// destructor
+	~GPUCulling();
+
+	// load the culling compute program - returns false when
+	// the driver cannot cull on the GPU, and the objects must
+	// then be drawn from the CPU
+	bool Initialize(ShaderManager* pShaderManager, const char* computeShaderPath);
+	inline bool IsAvailable() const
+	{
+		return(m_program != 0);
+	}
+
+	// remove all of the objects and groups
+	void Clear();
+	// add a group of objects that are drawn with one call
+	int AddGroup();
+	// add an object that draws the passed in command range of
+	// the shared mesh buffers as a member of a group
+	int AddObject(int group, const ShapeMeshes::DRAW_COMMAND& command);
+	// change the instance values and the world bounds of an
+	// object - they are uploaded by the next Cull()
+	void SetObject(
+		int object,
+		const InstanceData& instance,
+		const glm::vec3& boundsCenter,
+		const glm::vec3& boundsExtents,
+		float boundsRadius);
+
+	// upload the changed objects and test all of them against
+	// the frustum - the program of the shader manager is in
+	// use again afterwards
+	void Cull(const FrustumCulling::FRUSTUM& frustum);
+
+	// bind the command and count buffers for DrawGroup(), and
+	// time the draws until EndDraws()
+	void BeginDraws();
+	void DrawGroup(ShapeMeshes* pMeshes, int group, VertexFormat::VERTEX_FORMAT format);
+	void EndDraws();
+
+	inline int GetObjectCount() const
+	{
+		return((int)m_objects.size());
+	}
+	inline int GetGroupCount() const
+	{
+		return((int)m_groupSizes.size());
+	}
+	// buffer of the InstanceData of every object, in object order
+	inline GLuint GetInstanceBuffer() const
+	{
+		return(m_instanceBuffer);
+	}
+	// GPU time of the last finished culling and drawing passes
+	inline double GetCullMilliseconds() const
+	{
+		return(m_cullMilliseconds);
+	}
+	inline double GetDrawMilliseconds() const
+	{
+		return(m_drawMilliseconds);
+	}
+
+private:
+	// number of frames that the timer queries are kept for
+	// before their results are read
+	static constexpr int QUERY_FRAMES = 4;
+
+	// pointer to shader manager object
+	ShaderManager* m_pShaderManager;
+	// the compute program and its uniform locations
+	GLuint m_program;
+	GLint m_frustumPlanesLocation;
+	GLint m_objectCountLocation;
+
+	// culled objects and their instance values, the number of
+	// objects and the first command slot of every group, and
+	// the range of changed objects that has to be uploaded
+	std::vector<CullObjectData> m_objects;
+	std::vector<InstanceData> m_instances;
+	std::vector<GLuint> m_groupSizes;
+	std::vector<GLuint> m_groupFirstCommands;
+	size_t m_firstChanged;
+	size_t m_lastChanged;
+	// set when objects or groups were added, which needs the
+	// command ranges of the groups to be laid out again
+	bool m_bLayoutChanged;
+
+	// GPU buffers of the objects, the instance values, the
+	// written commands and the command count of every group
+	GLuint m_objectBuffer;
+	GLuint m_instanceBuffer;
+	GLuint m_commandBuffer;
+	GLuint m_countBuffer;
+
+	// time elapsed queries of the culling and drawing passes
+	GLuint m_cullQueries[QUERY_FRAMES];
+	GLuint m_drawQueries[QUERY_FRAMES];
+	bool m_bCullIssued[QUERY_FRAMES];
+	bool m_bDrawIssued[QUERY_FRAMES];
+	int m_queryFrame;
+	double m_cullMilliseconds;
+	double m_drawMilliseconds;
+
+	// lay out the command ranges and recreate the buffers
+	void UploadLayout();
+	// upload the range of changed objects
+	void UploadChanges();
+	// read the results of the queries of the oldest frame
+	void ReadQueries();
+};
@@ -1,5 +1,8 @@
 	#include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // command line arguments
+#include <iomanip>          // statistics output
+#include <chrono>           // startup time
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -13,6 +16,9 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "AllocationCounter.h"
+#include "GLStateCache.h"
+#include "Benchmarks.h"
 
 // Namespace for declaring global variables
 namespace
@@ -29,12 +35,32 @@ namespace
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+
+	// interval in seconds between frame statistics reports
+	const double FRAME_STATS_INTERVAL = 2.0;
+	// time of the last frame statistics report
+	double g_LastStatsReport = 0.0;
+
+	// "--objects <count>" adds a field of synthetic objects to
+	// the scene, "--cpu-culling" keeps all culling on the CPU,
+	// "--textures <units|arrays|bindless>" chooses how the
+	// textures are bound, packed into texture arrays by default,
+	// "--wait-for-textures" holds the first frame until every
+	// texture has loaded instead of drawing placeholders, and
+	// "--no-image-cache" decodes every image instead of reading
+	// the decoded images of the last run
+	const char* const OBJECTS_ARGUMENT = "--objects";
+	const char* const CPU_CULLING_ARGUMENT = "--cpu-culling";
+	const char* const TEXTURES_ARGUMENT = "--textures";
+	const char* const WAIT_FOR_TEXTURES_ARGUMENT = "--wait-for-textures";
+	const char* const NO_IMAGE_CACHE_ARGUMENT = "--no-image-cache";
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
 bool InitializeGLFW();
 bool InitializeGLEW();
+void ReportFrameStatistics();
 
 
 /***********************************************************
@@ -45,6 +71,16 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	// the startup time is measured until the first frame is shown
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	bool bFirstFrame = true;
+
+	// run a benchmark instead of the scene when one was requested
+	if (Benchmarks::IsRequested(argc, argv) == true)
+	{
+		return(Benchmarks::Run(argc, argv));
+	}
+
 	// if GLFW fails initialization, then terminate the application
 	if (InitializeGLFW() == false)
 	{
@@ -72,16 +108,75 @@ int main(int argc, char* argv[])
 		"../../Utilities/shaders/fragmentShader.glsl");
 	g_ShaderManager->use();
 
+	// read the options of the scene from the command line
+	int syntheticObjects = 0;
+	bool bCPUCulling = false;
+	bool bWaitForTextures = false;
+	bool bUseImageCache = true;
+	SceneManager::TEXTURE_BINDING textureBinding = SceneManager::TEXTURE_BINDING_ARRAYS;
+	for (int i = 1; i < argc; i++)
+	{
+		if ((std::strcmp(argv[i], OBJECTS_ARGUMENT) == 0) && ((i + 1) < argc))
+		{
+			syntheticObjects = std::atoi(argv[i + 1]);
+		}
+		else if (std::strcmp(argv[i], CPU_CULLING_ARGUMENT) == 0)
+		{
+			bCPUCulling = true;
+		}
+		else if (std::strcmp(argv[i], WAIT_FOR_TEXTURES_ARGUMENT) == 0)
+		{
+			bWaitForTextures = true;
+		}
+		else if (std::strcmp(argv[i], NO_IMAGE_CACHE_ARGUMENT) == 0)
+		{
+			bUseImageCache = false;
+		}
+		else if ((std::strcmp(argv[i], TEXTURES_ARGUMENT) == 0) && ((i + 1) < argc))
+		{
+			if (std::strcmp(argv[i + 1], "units") == 0)
+			{
+				textureBinding = SceneManager::TEXTURE_BINDING_UNITS;
+			}
+			else if (std::strcmp(argv[i + 1], "bindless") == 0)
+			{
+				textureBinding = SceneManager::TEXTURE_BINDING_BINDLESS;
+			}
+		}
+	}
+
 	// try to create a new scene manager object and prepare the 3D scene
 	g_SceneManager = new SceneManager(g_ShaderManager);
+	if (bCPUCulling == false)
+	{
+		g_SceneManager->EnableGPUCulling("../../Utilities/shaders/cullingShader.glsl");
+	}
+	g_SceneManager->SetTextureBinding(textureBinding);
+	if (bUseImageCache == false)
+	{
+		g_SceneManager->DisableImageCache();
+	}
 	g_SceneManager->PrepareScene();
+	if (syntheticObjects > 0)
+	{
+		g_SceneManager->AddSyntheticObjects(syntheticObjects);
+	}
+	if (bWaitForTextures == true)
+	{
+		g_SceneManager->FinishLoadingTextures();
+	}
 
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
 	while (!glfwWindowShouldClose(g_Window))
 	{
+		// start counting the statistics for this frame
+		g_ShaderManager->ResetFrameCounters();
+		AllocationCounter::ResetFrameCount();
+		GLStateCache::ResetFrameCounters();
+
 		// Enable z-depth
-		glEnable(GL_DEPTH_TEST);
+		GLStateCache::Enable(GL_DEPTH_TEST);
 
 		// Clear the frame and z buffers
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -93,10 +188,21 @@ int main(int argc, char* argv[])
 		// refresh the 3D scene
 		g_SceneManager->RenderScene();
 
+		// periodically report the statistics of the rendered frame
+		ReportFrameStatistics();
 
 		// Flips the the back buffer with the front buffer every frame.
 		glfwSwapBuffers(g_Window);
 
+		if (bFirstFrame == true)
+		{
+			std::chrono::duration<double, std::milli> startup = std::chrono::steady_clock::now() - startTime;
+			std::cout << "INFO: Startup - first frame after " << std::fixed << std::setprecision(1)
+				<< startup.count() << " ms, " << g_SceneManager->GetPendingTextureCount()
+				<< " textures still loading" << std::defaultfloat << std::endl;
+			bFirstFrame = false;
+		}
+
 		// query the latest GLFW events
 		glfwPollEvents();
 	}
@@ -174,4 +280,50 @@ bool InitializeGLEW()
 	std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << "\n" << std::endl;
 
 	return(true);
+}
+
+/***********************************************************
+ *	ReportFrameStatistics()
+ *
+ *  This function is used to periodically write the counters
+ *  gathered while rendering the last frame to the console.
+ ***********************************************************/
+void ReportFrameStatistics()
+{
+	double currentTime = glfwGetTime();
+	if ((currentTime - g_LastStatsReport) < FRAME_STATS_INTERVAL)
+	{
+		return;
+	}
+	g_LastStatsReport = currentTime;
+
+	// read the allocation count before writing any output
+	size_t frameAllocations = AllocationCounter::GetFrameCount();
+
+	const RenderQueue::QUEUE_STATS& renderStats = g_SceneManager->GetRenderStats();
+
+	std::cout << "INFO: Frame Statistics - uniform lookups: "
+		<< g_ShaderManager->GetFrameLookupCount();
+	if (AllocationCounter::IsEnabled() == true)
+	{
+		std::cout << ", allocations: " << frameAllocations;
+	}
+	std::cout << ", transforms updated: " << g_SceneManager->GetUpdatedTransformCount()
+		<< ", culled: " << renderStats.culled
+		<< ", draws: " << renderStats.draws
+		<< ", batches: " << renderStats.batches
+		<< ", draw calls: " << g_SceneManager->GetDrawCallCount()
+		<< ", state changes: " << renderStats.unsortedStateChanges
+		<< " unsorted / " << renderStats.sortedStateChanges << " sorted"
+		<< ", GL calls: " << GLStateCache::GetIssuedCount()
+		<< " issued / " << GLStateCache::GetElidedCount() << " elided";
+	if (g_SceneManager->IsGPUCullingEnabled() == true)
+	{
+		std::cout << ", GPU objects: " << g_SceneManager->GetGPUObjectCount()
+			<< std::fixed << std::setprecision(3)
+			<< ", GPU cull: " << g_SceneManager->GetGPUCullMilliseconds() << " ms"
+			<< ", GPU draw: " << g_SceneManager->GetGPUDrawMilliseconds() << " ms"
+			<< std::defaultfloat;
+	}
+	std::cout << std::endl;
 }
\ No newline at end of file
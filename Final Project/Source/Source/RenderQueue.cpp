@@ -0,0 +1,351 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.cpp
+// ============
+// collect the draws of a frame and sort them to minimize state changes
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderQueue.h"
+
+#include <cstring>
+#include <utility>
+
+// declaration of global variables
+namespace
+{
+	// bits of every field packed into the sort key
+	const int KEY_PROGRAM_BITS = 7;
+	const int KEY_TEXTURE_BITS = 12;
+	const int KEY_MATERIAL_BITS = 12;
+	const int KEY_FORMAT_BITS = 2;
+	const int KEY_MESH_BITS = 6;
+	const int KEY_PARTS_BITS = 4;
+	const int KEY_DEPTH_BITS = 20;
+
+	// number of states compared by CountStateChanges()
+	const unsigned int STATE_COUNT = 4;
+
+	// number of bits sorted by each radix sort pass
+	const int RADIX_BITS = 8;
+	const int RADIX_BUCKETS = 1 << RADIX_BITS;
+
+	/***********************************************************
+	 *  KeyField()
+	 *
+	 *  Clamps a value to the passed in number of bits so that
+	 *  it cannot overflow into the neighbouring key fields.
+	 ***********************************************************/
+	inline uint64_t KeyField(uint64_t value, int bits)
+	{
+		const uint64_t maxValue = (1ull << bits) - 1;
+		return((value < maxValue) ? value : maxValue);
+	}
+
+	/***********************************************************
+	 *  QuantizeDepth()
+	 *
+	 *  The bits of a positive float sort in the same order as
+	 *  its value, so the top bits of the distance can be used
+	 *  as the depth field without knowing the far plane.
+	 ***********************************************************/
+	inline uint64_t QuantizeDepth(float viewDepth)
+	{
+		uint32_t bits = 0;
+
+		if (viewDepth > 0.0f)
+		{
+			std::memcpy(&bits, &viewDepth, sizeof(bits));
+		}
+
+		return(bits >> (31 - KEY_DEPTH_BITS));
+	}
+}
+
+/***********************************************************
+ *  RenderQueue()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderQueue::RenderQueue()
+{
+	m_stats = {};
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the submitted
+ *  packets at the start of a frame.
+ ***********************************************************/
+void RenderQueue::Clear()
+{
+	m_packets.clear();
+	m_keys.clear();
+	m_order.clear();
+	m_bounds.Clear();
+	m_stats.culled = 0;
+}
+
+/***********************************************************
+ *  Submit()
+ *
+ *  This method is used for adding a draw packet into the
+ *  queue together with its sort key and world bounds.
+ ***********************************************************/
+void RenderQueue::Submit(
+	const DRAW_PACKET& packet,
+	float viewDepth,
+	const glm::vec3& boundsCenter,
+	const glm::vec3& boundsExtents,
+	float boundsRadius)
+{
+	m_order.push_back((uint32_t)m_packets.size());
+	m_keys.push_back(BuildSortKey(packet, viewDepth));
+	m_packets.push_back(packet);
+	m_bounds.Add(boundsCenter, boundsExtents, boundsRadius);
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method is used for testing the bounds of all of the
+ *  submitted packets against the frustum at once, and for
+ *  removing the packets that are outside of it from the
+ *  sort order.
+ ***********************************************************/
+void RenderQueue::Cull(const FrustumCulling::FRUSTUM& frustum)
+{
+	m_stats.culled = (unsigned int)FrustumCulling::CullBounds(frustum, m_bounds, m_visible);
+	if (m_stats.culled == 0)
+	{
+		return;
+	}
+
+	size_t kept = 0;
+	for (size_t i = 0; i < m_order.size(); i++)
+	{
+		if (m_visible[m_order[i]] != 0)
+		{
+			m_order[kept] = m_order[i];
+			m_keys[kept] = m_keys[i];
+			kept++;
+		}
+	}
+
+	m_order.resize(kept);
+	m_keys.resize(kept);
+}
+
+/***********************************************************
+ *  BuildSortKey()
+ *
+ *  This method is used for packing the state of a packet
+ *  into a 64-bit key.  Opaque draws are sorted by state and
+ *  then front to back, translucent draws are drawn after
+ *  them and sorted back to front.  The material is read per
+ *  instance, so it sorts after the mesh to keep the draws of
+ *  the same mesh together for instancing, and the meshes of
+ *  one vertex layout sort together for the multi-draws.
+ *  The textures packed into one array share their field.
+ *
+ *  opaque:      layer | program | texture | format | mesh | parts | material | depth
+ *  translucent: layer | program | depth   | texture | material | format | mesh | parts
+ ***********************************************************/
+uint64_t RenderQueue::BuildSortKey(const DRAW_PACKET& packet, float viewDepth)
+{
+	uint64_t program = KeyField(packet.program, KEY_PROGRAM_BITS);
+	uint64_t texture = 0;
+	uint64_t material = KeyField(packet.materialIndex + 1, KEY_MATERIAL_BITS);
+	uint64_t format = KeyField(packet.vertexFormat, KEY_FORMAT_BITS);
+	uint64_t mesh = KeyField(packet.mesh, KEY_MESH_BITS);
+	uint64_t parts = KeyField(packet.meshParts, KEY_PARTS_BITS);
+	uint64_t depth = QuantizeDepth(viewDepth);
+	uint64_t key = 0;
+
+	// untextured draws sort before all of the textured ones
+	if (packet.bUseTexture == true)
+	{
+		texture = KeyField(packet.textureBinding + 1, KEY_TEXTURE_BITS);
+	}
+
+	key = program;
+	if (packet.blendMode == BLEND_OPAQUE)
+	{
+		key = (key << KEY_TEXTURE_BITS) | texture;
+		key = (key << KEY_FORMAT_BITS) | format;
+		key = (key << KEY_MESH_BITS) | mesh;
+		key = (key << KEY_PARTS_BITS) | parts;
+		key = (key << KEY_MATERIAL_BITS) | material;
+		key = (key << KEY_DEPTH_BITS) | depth;
+	}
+	else
+	{
+		key |= (1ull << KEY_PROGRAM_BITS);
+		key = (key << KEY_DEPTH_BITS) | (~depth & ((1ull << KEY_DEPTH_BITS) - 1));
+		key = (key << KEY_TEXTURE_BITS) | texture;
+		key = (key << KEY_MATERIAL_BITS) | material;
+		key = (key << KEY_FORMAT_BITS) | format;
+		key = (key << KEY_MESH_BITS) | mesh;
+		key = (key << KEY_PARTS_BITS) | parts;
+	}
+
+	return(key);
+}
+
+/***********************************************************
+ *  Sort()
+ *
+ *  This method is used for sorting the submitted packets by
+ *  their keys with an LSD radix sort.  Passes over key bytes
+ *  that are the same for every packet are skipped.
+ ***********************************************************/
+void RenderQueue::Sort()
+{
+	const size_t count = m_keys.size();
+
+	m_stats.draws = (unsigned int)count;
+	m_stats.unsortedStateChanges = CountStateChanges();
+
+	if (count < 2)
+	{
+		m_stats.sortedStateChanges = m_stats.unsortedStateChanges;
+		m_stats.batches = (unsigned int)count;
+		return;
+	}
+
+	m_scratchKeys.resize(count);
+	m_scratchOrder.resize(count);
+
+	for (int shift = 0; shift < 64; shift += RADIX_BITS)
+	{
+		size_t offsets[RADIX_BUCKETS] = {};
+
+		for (size_t i = 0; i < count; i++)
+		{
+			offsets[(m_keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+		}
+
+		// every key has the same value in this byte
+		if (offsets[(m_keys[0] >> shift) & (RADIX_BUCKETS - 1)] == count)
+		{
+			continue;
+		}
+
+		size_t total = 0;
+		for (int bucket = 0; bucket < RADIX_BUCKETS; bucket++)
+		{
+			size_t bucketCount = offsets[bucket];
+			offsets[bucket] = total;
+			total += bucketCount;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			size_t destination = offsets[(m_keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+			m_scratchKeys[destination] = m_keys[i];
+			m_scratchOrder[destination] = m_order[i];
+		}
+
+		std::swap(m_keys, m_scratchKeys);
+		std::swap(m_order, m_scratchOrder);
+	}
+
+	m_stats.sortedStateChanges = CountStateChanges();
+
+	m_stats.batches = 1;
+	for (size_t i = 1; i < count; i++)
+	{
+		if (CanShareDraw(m_packets[m_order[i - 1]], m_packets[m_order[i]]) == false)
+		{
+			m_stats.batches++;
+		}
+	}
+}
+
+/***********************************************************
+ *  CountStateChanges()
+ *
+ *  This method is used for counting how many of the states
+ *  covered by the sort key (program, blending, texture and
+ *  vertex layout) change when the second packet is drawn
+ *  right after the first one.  The meshes of one layout
+ *  share a vertex array, and the material and the layer or
+ *  bindless handle of a texture are read per instance, so
+ *  none of them is a state change.
+ ***********************************************************/
+unsigned int RenderQueue::CountStateChanges(const DRAW_PACKET& previous, const DRAW_PACKET& next)
+{
+	unsigned int changes = 0;
+
+	if (previous.program != next.program)
+	{
+		changes++;
+	}
+	if (previous.blendMode != next.blendMode)
+	{
+		changes++;
+	}
+	if ((previous.bUseTexture != next.bUseTexture) ||
+		((next.bUseTexture == true) && (previous.textureBinding != next.textureBinding)))
+	{
+		changes++;
+	}
+	if (previous.vertexFormat != next.vertexFormat)
+	{
+		changes++;
+	}
+
+	return(changes);
+}
+
+/***********************************************************
+ *  CanShareDraw()
+ *
+ *  This method is used for checking if two packets can be
+ *  drawn as instances of the same draw call - they need
+ *  the same states and the same parts of the same mesh.
+ *  Everything else is stored per instance.
+ ***********************************************************/
+bool RenderQueue::CanShareDraw(const DRAW_PACKET& previous, const DRAW_PACKET& next)
+{
+	return((CountStateChanges(previous, next) == 0) &&
+		(previous.mesh == next.mesh) &&
+		(previous.meshParts == next.meshParts));
+}
+
+/***********************************************************
+ *  CanShareMultiDraw()
+ *
+ *  This method is used for checking if two packets can be
+ *  commands of the same indirect multi-draw - they need the
+ *  same states, and any mesh of the same vertex layout.
+ ***********************************************************/
+bool RenderQueue::CanShareMultiDraw(const DRAW_PACKET& previous, const DRAW_PACKET& next)
+{
+	return(CountStateChanges(previous, next) == 0);
+}
+
+/***********************************************************
+ *  CountStateChanges()
+ *
+ *  This method is used for counting the state changes that
+ *  submitting the packets in the current order would need.
+ *  The first draw of the frame sets every state once.
+ ***********************************************************/
+unsigned int RenderQueue::CountStateChanges() const
+{
+	unsigned int changes = 0;
+
+	for (size_t i = 0; i < m_order.size(); i++)
+	{
+		if (i == 0)
+		{
+			changes += STATE_COUNT;
+		}
+		else
+		{
+			changes += CountStateChanges(m_packets[m_order[i - 1]], m_packets[m_order[i]]);
+		}
+	}
+
+	return(changes);
+}
@@ -0,0 +1,138 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.h
+// ============
+// collect the draws of a frame and sort them to minimize state changes
+//
+// Every draw is submitted as a packet with a 64-bit sort key, the keys are
+// radix sorted so that draws sharing the same program, texture and mesh end
+// up next to each other before anything is sent to OpenGL, where they can
+// be drawn as the instances of a single draw call, and the draws that only
+// differ by mesh are submitted with one indirect multi-draw.  Packets whose world
+// bounds are outside of the camera frustum are removed before sorting.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrustumCulling.h"
+#include "ShapeMeshes.h"
+#include "TextureRegistry.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  RenderQueue
+ *
+ *  This class contains the draw packets of one frame and
+ *  the order in which they should be submitted.
+ ***********************************************************/
+class RenderQueue
+{
+public:
+	// constructor
+	RenderQueue();
+
+	enum BLEND_MODE
+	{
+		BLEND_OPAQUE = 0,
+		BLEND_ALPHA = 1
+	};
+
+	// everything needed to issue one draw
+	struct DRAW_PACKET
+	{
+		glm::mat4 model;
+		glm::vec4 color;
+		glm::vec2 UVscale;
+		bool bUseTexture;
+		TextureHandle texture;
+		// texture or texture array bound for the draw, which is
+		// shared by the textures packed into the same array, and
+		// the layer of the texture in it or the index of its
+		// bindless handle, which are read per instance
+		int textureBinding;
+		int textureIndex;
+		int materialIndex;
+		ShapeMeshes::MESH_TYPE mesh;
+		unsigned int meshParts;
+		VertexFormat::VERTEX_FORMAT vertexFormat;
+		BLEND_MODE blendMode;
+		int program;
+	};
+
+	// state change counts of the last sorted frame
+	struct QUEUE_STATS
+	{
+		unsigned int draws;
+		unsigned int unsortedStateChanges;
+		unsigned int sortedStateChanges;
+		// number of instanced draws after merging the packets
+		unsigned int batches;
+		// number of packets outside of the camera frustum
+		unsigned int culled;
+	};
+
+	// remove all of the packets, keeping the memory for
+	// the next frame
+	void Clear();
+	// add a draw packet - viewDepth is the distance of the
+	// object from the camera, and the bounds are the world
+	// box and sphere around the object
+	void Submit(
+		const DRAW_PACKET& packet,
+		float viewDepth,
+		const glm::vec3& boundsCenter,
+		const glm::vec3& boundsExtents,
+		float boundsRadius);
+	// remove the packets that are outside of the frustum,
+	// must be called before Sort()
+	void Cull(const FrustumCulling::FRUSTUM& frustum);
+	// sort the submitted packets by their keys
+	void Sort();
+
+	// number of packets left after culling
+	inline int GetCount() const
+	{
+		return((int)m_order.size());
+	}
+	// get a packet in sorted order
+	inline const DRAW_PACKET& GetPacket(int index) const
+	{
+		return(m_packets[m_order[index]]);
+	}
+	inline const QUEUE_STATS& GetStats() const
+	{
+		return(m_stats);
+	}
+
+	// number of GL states that differ between two packets
+	static unsigned int CountStateChanges(const DRAW_PACKET& previous, const DRAW_PACKET& next);
+	// check if two packets can be instances of one draw call
+	static bool CanShareDraw(const DRAW_PACKET& previous, const DRAW_PACKET& next);
+	// check if two packets can be commands of one multi-draw
+	static bool CanShareMultiDraw(const DRAW_PACKET& previous, const DRAW_PACKET& next);
+
+private:
+	// submitted packets, in submission order
+	std::vector<DRAW_PACKET> m_packets;
+	// sort key of every submitted packet
+	std::vector<uint64_t> m_keys;
+	// world bounds of every submitted packet, and the result
+	// of testing them against the frustum
+	FrustumCulling::BOUNDS_LIST m_bounds;
+	std::vector<uint8_t> m_visible;
+	// packet indices, in sorted order after Sort()
+	std::vector<uint32_t> m_order;
+	// scratch buffers for the radix sort passes
+	std::vector<uint64_t> m_scratchKeys;
+	std::vector<uint32_t> m_scratchOrder;
+	// state change counts of the last sorted frame
+	QUEUE_STATS m_stats;
+
+	// pack the state of a packet into its sort key
+	static uint64_t BuildSortKey(const DRAW_PACKET& packet, float viewDepth);
+	// count the state changes of the current packet order
+	unsigned int CountStateChanges() const;
+};
@@ -0,0 +1,366 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegraph.cpp
+// ============
+// retained transforms of the scene objects
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneGraph.h"
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	const float DEGREES_TO_RADIANS = 0.0174532925199432957692f;
+
+	// number of transforms composed by one SSE pass
+	const size_t SIMD_WIDTH = 4;
+
+	// the batched composition loads the records as floats
+	static_assert(sizeof(SceneGraph::TRANSFORM) == 9 * sizeof(float), "TRANSFORM must be 9 packed floats");
+	static_assert(sizeof(glm::mat4) == 16 * sizeof(float), "glm::mat4 must be 16 packed floats");
+
+	/***********************************************************
+	 *  SinCos()
+	 *
+	 *  Calculates the sine and cosine of four angles at once.
+	 *  The angles are reduced to the octant around zero with
+	 *  an extended precision multiple of pi/4, and then both
+	 *  are evaluated with the minimax polynomials of the Cephes
+	 *  library, which are accurate to about 1e-7 in range.
+	 ***********************************************************/
+	inline void SinCos(__m128 x, __m128& sine, __m128& cosine)
+	{
+		const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+
+		// sin(-x) = -sin(x), cos(-x) = cos(x)
+		__m128 sineSign = _mm_and_ps(x, signMask);
+		x = _mm_andnot_ps(signMask, x);
+
+		// the even octant that x is closest to
+		__m128i octant = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.27323954473516f)));
+		octant = _mm_and_si128(_mm_add_epi32(octant, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+		__m128 octantAngle = _mm_cvtepi32_ps(octant);
+
+		// octants 2 and 6 swap the two polynomials, octants 4
+		// and 6 flip the sign of the sine, octants 2 and 4 flip
+		// the sign of the cosine
+		__m128 swapMask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(octant, _mm_set1_epi32(2)), _mm_setzero_si128()));
+		sineSign = _mm_xor_ps(sineSign, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, _mm_set1_epi32(4)), 29)));
+		__m128 cosineSign = _mm_castsi128_ps(_mm_slli_epi32(
+			_mm_andnot_si128(_mm_sub_epi32(octant, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+
+		// x - octant * pi/4, with pi/4 split into three parts
+		x = _mm_sub_ps(x, _mm_mul_ps(octantAngle, _mm_set1_ps(0.78515625f)));
+		x = _mm_sub_ps(x, _mm_mul_ps(octantAngle, _mm_set1_ps(2.4187564849853515625e-4f)));
+		x = _mm_sub_ps(x, _mm_mul_ps(octantAngle, _mm_set1_ps(3.77489497744594108e-8f)));
+		__m128 z = _mm_mul_ps(x, x);
+
+		__m128 cosinePolynomial = _mm_set1_ps(2.443315711809948e-5f);
+		cosinePolynomial = _mm_add_ps(_mm_mul_ps(cosinePolynomial, z), _mm_set1_ps(-1.388731625493765e-3f));
+		cosinePolynomial = _mm_add_ps(_mm_mul_ps(cosinePolynomial, z), _mm_set1_ps(4.166664568298827e-2f));
+		cosinePolynomial = _mm_mul_ps(_mm_mul_ps(cosinePolynomial, z), z);
+		cosinePolynomial = _mm_sub_ps(cosinePolynomial, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+		cosinePolynomial = _mm_add_ps(cosinePolynomial, _mm_set1_ps(1.0f));
+
+		__m128 sinePolynomial = _mm_set1_ps(-1.9515295891e-4f);
+		sinePolynomial = _mm_add_ps(_mm_mul_ps(sinePolynomial, z), _mm_set1_ps(8.3321608736e-3f));
+		sinePolynomial = _mm_add_ps(_mm_mul_ps(sinePolynomial, z), _mm_set1_ps(-1.6666654611e-1f));
+		sinePolynomial = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinePolynomial, z), x), x);
+
+		sine = _mm_or_ps(_mm_and_ps(swapMask, sinePolynomial), _mm_andnot_ps(swapMask, cosinePolynomial));
+		cosine = _mm_or_ps(_mm_and_ps(swapMask, cosinePolynomial), _mm_andnot_ps(swapMask, sinePolynomial));
+		sine = _mm_xor_ps(sine, sineSign);
+		cosine = _mm_xor_ps(cosine, cosineSign);
+	}
+}
+
+/***********************************************************
+ *  SceneGraph()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneGraph::SceneGraph()
+{
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the nodes.
+ ***********************************************************/
+void SceneGraph::Clear()
+{
+	m_transforms.clear();
+	m_parents.clear();
+	m_firstChildren.clear();
+	m_nextSiblings.clear();
+	m_worldMatrices.clear();
+	m_worldVersions.clear();
+	m_dirtyNodes.clear();
+	m_bDirty.clear();
+}
+
+/***********************************************************
+ *  AddNode()
+ *
+ *  This method is used for adding a node under the passed
+ *  in parent.  The world matrix of the new node is composed
+ *  by the next Update().
+ ***********************************************************/
+int SceneGraph::AddNode(const TRANSFORM& transform, int parent)
+{
+	const int node = (int)m_transforms.size();
+
+	if (parent >= node)
+	{
+		parent = NO_PARENT;
+	}
+
+	m_transforms.push_back(transform);
+	m_parents.push_back(parent);
+	m_firstChildren.push_back(NO_PARENT);
+	m_nextSiblings.push_back(NO_PARENT);
+	m_worldMatrices.push_back(glm::mat4(1.0f));
+	m_worldVersions.push_back(0);
+	m_bDirty.push_back(false);
+
+	if (parent != NO_PARENT)
+	{
+		m_nextSiblings[node] = m_firstChildren[parent];
+		m_firstChildren[parent] = node;
+	}
+
+	MarkDirty(node);
+
+	return(node);
+}
+
+/***********************************************************
+ *  SetTransform()
+ *
+ *  This method is used for changing the local transform of
+ *  a node.
+ ***********************************************************/
+void SceneGraph::SetTransform(int node, const TRANSFORM& transform)
+{
+	if ((node < 0) || (node >= GetNodeCount()))
+	{
+		return;
+	}
+
+	m_transforms[node] = transform;
+	MarkDirty(node);
+}
+
+/***********************************************************
+ *  MarkDirty()
+ *
+ *  This method is used for adding a node to the list of
+ *  changed nodes, once.
+ ***********************************************************/
+void SceneGraph::MarkDirty(int node)
+{
+	if (m_bDirty[node] == false)
+	{
+		m_bDirty[node] = true;
+		m_dirtyNodes.push_back(node);
+	}
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for composing the world matrices of
+ *  the changed nodes and of everything below them.  Parents
+ *  have lower indices than their children, so the changed
+ *  nodes are visited in index order and a changed child is
+ *  skipped when its parent already visited it.  The local
+ *  matrices of all visited nodes are composed as one batch
+ *  before the parents are applied.
+ ***********************************************************/
+int SceneGraph::Update()
+{
+	if (m_dirtyNodes.empty() == true)
+	{
+		return(0);
+	}
+
+	std::sort(m_dirtyNodes.begin(), m_dirtyNodes.end());
+
+	// list the nodes to update, every parent before its children
+	m_updateOrder.clear();
+	m_updateTransforms.clear();
+	for (int dirtyNode : m_dirtyNodes)
+	{
+		if (m_bDirty[dirtyNode] == false)
+		{
+			continue;
+		}
+
+		m_updateStack.push_back(dirtyNode);
+		while (m_updateStack.empty() == false)
+		{
+			int node = m_updateStack.back();
+			m_updateStack.pop_back();
+
+			m_updateOrder.push_back(node);
+			m_updateTransforms.push_back(m_transforms[node]);
+			m_bDirty[node] = false;
+
+			for (int child = m_firstChildren[node]; child != NO_PARENT; child = m_nextSiblings[child])
+			{
+				m_updateStack.push_back(child);
+			}
+		}
+	}
+	m_dirtyNodes.clear();
+
+	m_localMatrices.resize(m_updateOrder.size());
+	ComposeTransforms(m_updateTransforms.data(), m_updateTransforms.size(), m_localMatrices.data());
+
+	for (size_t i = 0; i < m_updateOrder.size(); i++)
+	{
+		int node = m_updateOrder[i];
+		int parent = m_parents[node];
+
+		if (parent == NO_PARENT)
+		{
+			m_worldMatrices[node] = m_localMatrices[i];
+		}
+		else
+		{
+			m_worldMatrices[node] = m_worldMatrices[parent] * m_localMatrices[i];
+		}
+		m_worldVersions[node]++;
+	}
+
+	return((int)m_updateOrder.size());
+}
+
+/***********************************************************
+ *  ComposeTransform()
+ *
+ *  This method is used for building the matrix of a local
+ *  transform.  translation * Rx * Ry * Rz * scale is written
+ *  out directly from the sine and cosine of the angles: the
+ *  columns of the rotation are scaled and the translation
+ *  becomes the last column.
+ ***********************************************************/
+glm::mat4 SceneGraph::ComposeTransform(const TRANSFORM& transform)
+{
+	glm::vec3 angles = transform.rotationDegrees * DEGREES_TO_RADIANS;
+	float sx = std::sin(angles.x);
+	float cx = std::cos(angles.x);
+	float sy = std::sin(angles.y);
+	float cy = std::cos(angles.y);
+	float sz = std::sin(angles.z);
+	float cz = std::cos(angles.z);
+	glm::mat4 matrix;
+
+	matrix[0] = glm::vec4(
+		cy * cz * transform.scale.x,
+		(cx * sz + sx * sy * cz) * transform.scale.x,
+		(sx * sz - cx * sy * cz) * transform.scale.x,
+		0.0f);
+	matrix[1] = glm::vec4(
+		-cy * sz * transform.scale.y,
+		(cx * cz - sx * sy * sz) * transform.scale.y,
+		(sx * cz + cx * sy * sz) * transform.scale.y,
+		0.0f);
+	matrix[2] = glm::vec4(
+		sy * transform.scale.z,
+		-sx * cy * transform.scale.z,
+		cx * cy * transform.scale.z,
+		0.0f);
+	matrix[3] = glm::vec4(transform.position, 1.0f);
+
+	return(matrix);
+}
+
+/***********************************************************
+ *  ComposeTransforms()
+ *
+ *  This method is used for building the matrices of an
+ *  array of local transforms.  Four records are transposed
+ *  so that every SSE register holds one value of all four,
+ *  the same products as ComposeTransform() are calculated,
+ *  and the results are transposed back into four matrices.
+ *  The records left over at the end are composed one at a
+ *  time.
+ ***********************************************************/
+void SceneGraph::ComposeTransforms(const TRANSFORM* transforms, size_t count, glm::mat4* matrices)
+{
+	const size_t simdCount = count - (count % SIMD_WIDTH);
+	const __m128 degreesToRadians = _mm_set1_ps(DEGREES_TO_RADIANS);
+
+	for (size_t i = 0; i < simdCount; i += SIMD_WIDTH)
+	{
+		const float* records = reinterpret_cast<const float*>(transforms + i);
+
+		// scale xyz and rotation x, then rotation yz and position xy
+		__m128 scaleX = _mm_loadu_ps(records);
+		__m128 scaleY = _mm_loadu_ps(records + 9);
+		__m128 scaleZ = _mm_loadu_ps(records + 18);
+		__m128 angleX = _mm_loadu_ps(records + 27);
+		_MM_TRANSPOSE4_PS(scaleX, scaleY, scaleZ, angleX);
+		__m128 angleY = _mm_loadu_ps(records + 4);
+		__m128 angleZ = _mm_loadu_ps(records + 13);
+		__m128 positionX = _mm_loadu_ps(records + 22);
+		__m128 positionY = _mm_loadu_ps(records + 31);
+		_MM_TRANSPOSE4_PS(angleY, angleZ, positionX, positionY);
+		__m128 positionZ = _mm_setr_ps(records[8], records[17], records[26], records[35]);
+
+		__m128 sx, cx, sy, cy, sz, cz;
+		SinCos(_mm_mul_ps(angleX, degreesToRadians), sx, cx);
+		SinCos(_mm_mul_ps(angleY, degreesToRadians), sy, cy);
+		SinCos(_mm_mul_ps(angleZ, degreesToRadians), sz, cz);
+
+		__m128 sxsy = _mm_mul_ps(sx, sy);
+		__m128 cxsy = _mm_mul_ps(cx, sy);
+		__m128 zero = _mm_setzero_ps();
+
+		__m128 column0x = _mm_mul_ps(_mm_mul_ps(cy, cz), scaleX);
+		__m128 column0y = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(cx, sz), _mm_mul_ps(sxsy, cz)), scaleX);
+		__m128 column0z = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(sx, sz), _mm_mul_ps(cxsy, cz)), scaleX);
+		__m128 column0w = zero;
+		__m128 column1x = _mm_sub_ps(zero, _mm_mul_ps(_mm_mul_ps(cy, sz), scaleY));
+		__m128 column1y = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(cx, cz), _mm_mul_ps(sxsy, sz)), scaleY);
+		__m128 column1z = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(sx, cz), _mm_mul_ps(cxsy, sz)), scaleY);
+		__m128 column1w = zero;
+		__m128 column2x = _mm_mul_ps(sy, scaleZ);
+		__m128 column2y = _mm_sub_ps(zero, _mm_mul_ps(_mm_mul_ps(sx, cy), scaleZ));
+		__m128 column2z = _mm_mul_ps(_mm_mul_ps(cx, cy), scaleZ);
+		__m128 column2w = zero;
+		__m128 column3w = _mm_set1_ps(1.0f);
+
+		_MM_TRANSPOSE4_PS(column0x, column0y, column0z, column0w);
+		_MM_TRANSPOSE4_PS(column1x, column1y, column1z, column1w);
+		_MM_TRANSPOSE4_PS(column2x, column2y, column2z, column2w);
+		_MM_TRANSPOSE4_PS(positionX, positionY, positionZ, column3w);
+
+		// after the transposes each register is one column of
+		// one matrix, in the order of the records
+		const __m128 columns[4][4] = {
+			{ column0x, column1x, column2x, positionX },
+			{ column0y, column1y, column2y, positionY },
+			{ column0z, column1z, column2z, positionZ },
+			{ column0w, column1w, column2w, column3w } };
+		for (size_t record = 0; record < SIMD_WIDTH; record++)
+		{
+			float* matrix = &matrices[i + record][0][0];
+			for (int column = 0; column < 4; column++)
+			{
+				_mm_storeu_ps(matrix + column * 4, columns[record][column]);
+			}
+		}
+	}
+
+	for (size_t i = simdCount; i < count; i++)
+	{
+		matrices[i] = ComposeTransform(transforms[i]);
+	}
+}
@@ -0,0 +1,110 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegraph.h
+// ============
+// retained transforms of the scene objects
+//
+// Every node keeps its scale, rotation and position, and its world matrix
+// is only composed again after the node or one of its parents was changed.
+// The world matrices of all nodes are stored next to each other so that
+// they can be uploaded as one block.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+/***********************************************************
+ *  SceneGraph
+ *
+ *  This class contains the transform nodes of the scene
+ *  and their world matrices.
+ ***********************************************************/
+class SceneGraph
+{
+public:
+	// constructor
+	SceneGraph();
+
+	// parent of the nodes that are placed directly in the world
+	static constexpr int NO_PARENT = -1;
+
+	// the local transform of a node, applied as scale, then
+	// rotation around Z, Y and X, then translation
+	struct TRANSFORM
+	{
+		glm::vec3 scale;
+		glm::vec3 rotationDegrees;
+		glm::vec3 position;
+	};
+
+	// remove all of the nodes
+	void Clear();
+	// add a node - parents must be added before their children
+	int AddNode(const TRANSFORM& transform, int parent = NO_PARENT);
+	// change the local transform of a node, its world matrix
+	// and the ones of its children are updated by Update()
+	void SetTransform(int node, const TRANSFORM& transform);
+
+	// compose the world matrices of the changed nodes and of
+	// their children, and return the number of updated nodes
+	int Update();
+
+	inline int GetNodeCount() const
+	{
+		return((int)m_transforms.size());
+	}
+	inline const TRANSFORM& GetTransform(int node) const
+	{
+		return(m_transforms[node]);
+	}
+	inline const glm::mat4& GetWorldMatrix(int node) const
+	{
+		return(m_worldMatrices[node]);
+	}
+	// the world matrices of all nodes, in node order
+	inline const std::vector<glm::mat4>& GetWorldMatrices() const
+	{
+		return(m_worldMatrices);
+	}
+	// incremented every time the world matrix of the node is
+	// updated, so that anything derived from the matrix can
+	// tell when it has to be derived again
+	inline unsigned int GetWorldVersion(int node) const
+	{
+		return(m_worldVersions[node]);
+	}
+
+	// compose the matrix of a local transform
+	static glm::mat4 ComposeTransform(const TRANSFORM& transform);
+	// compose the matrices of an array of local transforms,
+	// four at a time with SSE
+	static void ComposeTransforms(const TRANSFORM* transforms, size_t count, glm::mat4* matrices);
+
+private:
+	// local transform, parent, first child and next sibling
+	// of every node
+	std::vector<TRANSFORM> m_transforms;
+	std::vector<int> m_parents;
+	std::vector<int> m_firstChildren;
+	std::vector<int> m_nextSiblings;
+	// world matrix of every node and its update count
+	std::vector<glm::mat4> m_worldMatrices;
+	std::vector<unsigned int> m_worldVersions;
+	// nodes changed since the last update, and whether a
+	// node is already in that list
+	std::vector<int> m_dirtyNodes;
+	std::vector<bool> m_bDirty;
+	// nodes waiting to be updated during Update(), and the
+	// nodes to update in parent first order with their local
+	// transforms and matrices
+	std::vector<int> m_updateStack;
+	std::vector<int> m_updateOrder;
+	std::vector<TRANSFORM> m_updateTransforms;
+	std::vector<glm::mat4> m_localMatrices;
+
+	// mark a node as changed
+	void MarkDirty(int node);
+};
@@ -8,6 +8,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "TextureContainer.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -16,14 +17,130 @@
 
 #include <glm/gtx/transform.hpp>
 
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
 // declaration of global variables
 namespace
 {
-	const char* g_ModelName = "model";
-	const char* g_ColorValueName = "objectColor";
-	const char* g_TextureValueName = "objectTexture";
-	const char* g_UseTextureName = "bUseTexture";
-	const char* g_UseLightingName = "bUseLighting";
+	constexpr UniformID g_TextureValueName("objectTexture");
+	constexpr UniformID g_TextureArrayValueName("objectTextureArray");
+	constexpr UniformID g_UseBindlessTexturesName("bUseBindlessTextures");
+	constexpr UniformID g_UseTextureName("bUseTexture");
+	constexpr UniformID g_UseLightingName("bUseLighting");
+	constexpr UniformID g_FirstInstanceName("firstInstance");
+
+	// the synthetic objects are spread over a square field of
+	// this half size, below the table top
+	const float SYNTHETIC_FIELD_SIZE = 150.0f;
+	const float SYNTHETIC_FIELD_HEIGHT = -12.0f;
+	// fixed seed, so that every run places the same objects
+	const unsigned int SYNTHETIC_SEED = 330;
+
+	// size that every scene texture is resampled to when the
+	// textures are packed, so that all of them fit one array
+	const int TEXTURE_ARRAY_SIZE = 1024;
+
+	// extension of the cooked texture files that the texture
+	// cooker writes next to the images
+	const char* const COOKED_TEXTURE_EXTENSION = ".ctex";
+	// directory that the decoded images of the textures that
+	// were not cooked are kept in between runs
+	const char* const IMAGE_CACHE_DIRECTORY = "./texturecache";
+
+	/***********************************************************
+	 *  GetCookedTexturePath()
+	 *
+	 *  Returns the path of the cooked file of an image, or an
+	 *  empty path when there is none or it is older than the
+	 *  image, so that an edited image is never hidden by the
+	 *  file that was cooked from its last version.
+	 ***********************************************************/
+	std::filesystem::path GetCookedTexturePath(const char* filename)
+	{
+		std::filesystem::path imagePath(filename);
+		std::filesystem::path cookedPath = imagePath;
+		cookedPath.replace_extension(COOKED_TEXTURE_EXTENSION);
+
+		std::error_code error;
+		std::filesystem::file_time_type cookedTime = std::filesystem::last_write_time(cookedPath, error);
+		if (error)
+		{
+			return(std::filesystem::path());
+		}
+		std::filesystem::file_time_type imageTime = std::filesystem::last_write_time(imagePath, error);
+		if ((!error) && (imageTime > cookedTime))
+		{
+			return(std::filesystem::path());
+		}
+
+		return(cookedPath);
+	}
+
+	/***********************************************************
+	 *  GetCookedTextureFormat()
+	 *
+	 *  Gets the OpenGL formats of the levels of a cooked
+	 *  texture.  Returns false when the driver cannot sample
+	 *  the format.
+	 ***********************************************************/
+	bool GetCookedTextureFormat(TEXTURE_FORMAT format, GLenum& internalFormat, GLenum& pixelFormat)
+	{
+		switch (format)
+		{
+		case TEXTURE_FORMAT_RGB8:
+			internalFormat = GL_RGB8;
+			pixelFormat = GL_RGB;
+			return(true);
+		case TEXTURE_FORMAT_RGBA8:
+			internalFormat = GL_RGBA8;
+			pixelFormat = GL_RGBA;
+			return(true);
+		case TEXTURE_FORMAT_BC1:
+			internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+			pixelFormat = GL_RGB;
+			return(GLEW_EXT_texture_compression_s3tc != GL_FALSE);
+		case TEXTURE_FORMAT_BC3:
+			internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+			pixelFormat = GL_RGBA;
+			return(GLEW_EXT_texture_compression_s3tc != GL_FALSE);
+		case TEXTURE_FORMAT_BC4:
+			internalFormat = GL_COMPRESSED_RED_RGTC1;
+			pixelFormat = GL_RED;
+			return(GLEW_ARB_texture_compression_rgtc != GL_FALSE);
+		case TEXTURE_FORMAT_BC5:
+			internalFormat = GL_COMPRESSED_RG_RGTC2;
+			pixelFormat = GL_RG;
+			return(GLEW_ARB_texture_compression_rgtc != GL_FALSE);
+		case TEXTURE_FORMAT_BC7:
+			internalFormat = GL_COMPRESSED_RGBA_BPTC_UNORM;
+			pixelFormat = GL_RGBA;
+			return(GLEW_ARB_texture_compression_bptc != GL_FALSE);
+		default:
+			return(false);
+		}
+	}
+
+	/***********************************************************
+	 *  GetInstanceData()
+	 *
+	 *  Copies the values of a packet that the shaders read
+	 *  per instance.
+	 ***********************************************************/
+	InstanceData GetInstanceData(const RenderQueue::DRAW_PACKET& packet)
+	{
+		InstanceData instance = {};
+
+		instance.model = packet.model;
+		instance.objectColor = packet.color;
+		instance.UVscale = packet.UVscale;
+		instance.materialIndex = packet.materialIndex;
+		instance.textureIndex = packet.textureIndex;
+
+		return(instance);
+	}
 }
 
 /***********************************************************
@@ -35,6 +152,32 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
 {
 	m_pShaderManager = pShaderManager;
 	m_basicMeshes = new ShapeMeshes();
+	m_boundTextureUnits = 0;
+	m_sharedTextureUnit = 0;
+	m_textureBinding = TEXTURE_BINDING_UNITS;
+	m_requestedTextureBinding = TEXTURE_BINDING_UNITS;
+	m_bTexturesLoaded = false;
+	m_bUseImageCache = true;
+	m_textureHandleBuffer = 0;
+	m_sceneTextures = {};
+	m_instanceBuffer = 0;
+	m_indirectBuffer = 0;
+	m_currentNode = SceneGraph::NO_PARENT;
+	m_updatedTransforms = 0;
+
+	m_drawState.model = glm::mat4(1.0f);
+	m_drawState.color = glm::vec4(1.0f);
+	m_drawState.UVscale = glm::vec2(1.0f, 1.0f);
+	m_drawState.bUseTexture = false;
+	m_drawState.texture = INVALID_TEXTURE;
+	m_drawState.textureBinding = INVALID_TEXTURE;
+	m_drawState.textureIndex = -1;
+	m_drawState.materialIndex = 0;
+	m_drawState.mesh = ShapeMeshes::BOX_MESH;
+	m_drawState.meshParts = ShapeMeshes::MESH_PART_ALL;
+	m_drawState.vertexFormat = VertexFormat::VERTEX_FORMAT_FLOAT;
+	m_drawState.blendMode = RenderQueue::BLEND_OPAQUE;
+	m_drawState.program = 0;
 }
 
 /***********************************************************
@@ -44,6 +187,22 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
  ***********************************************************/
 SceneManager::~SceneManager()
 {
+	DestroyGLTextures();
+	if (m_textureHandleBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_textureHandleBuffer);
+		m_textureHandleBuffer = 0;
+	}
+	if (m_instanceBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_instanceBuffer);
+		m_instanceBuffer = 0;
+	}
+	if (m_indirectBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_indirectBuffer);
+		m_indirectBuffer = 0;
+	}
 	m_pShaderManager = NULL;
 	delete m_basicMeshes;
 	m_basicMeshes = NULL;
@@ -52,91 +211,230 @@ SceneManager::~SceneManager()
 /***********************************************************
  *  CreateGLTexture()
  *
- *  This method is used for loading textures from image files,
- *  configuring the texture mapping parameters in OpenGL,
- *  generating the mipmaps, and loading the read texture into
- *  the next available texture slot in memory.
+ *  This method is used for creating a texture for an image
+ *  file, configuring the texture mapping parameters in
+ *  OpenGL, and registering the texture.  Until the image has
+ *  been decoded by the texture loader the texture holds a
+ *  single gray placeholder pixel, so the scene can render
+ *  right away.  The returned handle is INVALID_TEXTURE if it
+ *  failed.
  ***********************************************************/
-bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
+TextureHandle SceneManager::CreateGLTexture(const char* filename, std::string_view tag)
 {
 	int width = 0;
 	int height = 0;
 	int colorChannels = 0;
 	GLuint textureID = 0;
+	GLenum internalFormat = GL_RGB8;
 
-	// indicate to always flip images vertically when loaded
-	stbi_set_flip_vertically_on_load(true);
+	// an image that was cooked needs no decoding at all
+	TextureHandle cookedTexture = CreateCookedTexture(filename, tag);
+	if (cookedTexture != INVALID_TEXTURE)
+	{
+		return(cookedTexture);
+	}
 
-	// try to parse the image data from the specified image file
-	unsigned char* image = stbi_load(
-		filename,
-		&width,
-		&height,
-		&colorChannels,
-		0);
+	// only read the header of the image, the pixels are
+	// decoded by the texture loader
+	if (stbi_info(filename, &width, &height, &colorChannels) == 0)
+	{
+		std::cout << "Could not load image:" << filename << std::endl;
+		return(INVALID_TEXTURE);
+	}
 
-	// if the image was successfully read from the image file
-	if (image)
+	// if the image is in RGB format
+	if (colorChannels == 3)
 	{
-		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
-
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
-		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
-			return false;
-		}
+		internalFormat = GL_RGB8;
+	}
+	// if the image is in RGBA format - it supports transparency
+	else if (colorChannels == 4)
+	{
+		internalFormat = GL_RGBA8;
+	}
+	else
+	{
+		std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
+		return(INVALID_TEXTURE);
+	}
+
+	glGenTextures(1, &textureID);
+	GLStateCache::BindTexture(GL_TEXTURE_2D, textureID);
+
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters - the placeholder has
+	// no mipmaps, the loader samples them once they landed
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+	// the placeholder is replaced when the image lands
+	const unsigned char placeholder[4] = { 128, 128, 128, 255 };
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+	GLStateCache::BindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+
+	// register the texture with the size of the image and
+	// associate it with the special tag string
+	TextureHandle texture = m_textures.Register(tag, textureID, width, height, internalFormat, true);
+	m_textureLoader.Queue(filename, texture);
+
+	return(texture);
+}
+
+/***********************************************************
+ *  CreateCookedTexture()
+ *
+ *  This method is used for creating a texture from the
+ *  cooked file of an image.  The file is mapped into memory
+ *  and every level is handed to OpenGL straight from the
+ *  mapping, so no texel is decoded or converted on the CPU
+ *  and no mipmaps are generated.  The returned handle is
+ *  INVALID_TEXTURE when there is no usable cooked file.
+ ***********************************************************/
+TextureHandle SceneManager::CreateCookedTexture(const char* filename, std::string_view tag)
+{
+	std::filesystem::path cookedPath = GetCookedTexturePath(filename);
+	if (cookedPath.empty() == true)
+	{
+		return(INVALID_TEXTURE);
+	}
 
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
+	TextureContainer container;
+	if (container.Open(cookedPath.string().c_str()) == false)
+	{
+		std::cout << "Could not load cooked texture:" << cookedPath.string() << std::endl;
+		return(INVALID_TEXTURE);
+	}
 
-		// free the image data from local memory
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+	GLenum internalFormat = GL_RGB8;
+	GLenum pixelFormat = GL_RGB;
+	if (GetCookedTextureFormat(container.GetFormat(), internalFormat, pixelFormat) == false)
+	{
+		std::cout << "INFO: " << TextureContainer::GetFormatName(container.GetFormat())
+			<< " textures are not supported, the image is loaded instead of " << cookedPath.string() << std::endl;
+		return(INVALID_TEXTURE);
+	}
+
+	GLuint textureID = 0;
+	glGenTextures(1, &textureID);
+	GLStateCache::BindTexture(GL_TEXTURE_2D, textureID);
+
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters, sampling the cooked
+	// mipmaps when there are any
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+		(container.GetLevelCount() > 1) ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, container.GetLevelCount() - 1);
+	// a single channel texture is sampled as gray
+	if (pixelFormat == GL_RED)
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+	}
 
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
+	glTexStorage2D(GL_TEXTURE_2D, container.GetLevelCount(), internalFormat, container.GetWidth(), container.GetHeight());
 
-		return true;
+	// the rows of the cooked levels are tightly packed
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (int level = 0; level < container.GetLevelCount(); level++)
+	{
+		const TEXTURE_FILE_LEVEL& levelInfo = container.GetLevel(level);
+		if (TextureContainer::IsBlockCompressed(container.GetFormat()) == true)
+		{
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, levelInfo.width, levelInfo.height,
+				internalFormat, (GLsizei)levelInfo.size, container.GetLevelData(level));
+		}
+		else
+		{
+			glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, levelInfo.width, levelInfo.height,
+				pixelFormat, GL_UNSIGNED_BYTE, container.GetLevelData(level));
+		}
 	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	GLStateCache::BindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
 
-	std::cout << "Could not load image:" << filename << std::endl;
+	// register the loaded texture and associate it with the special tag string
+	TextureHandle texture = m_textures.Register(
+		tag, textureID, container.GetWidth(), container.GetHeight(), internalFormat, true);
 
-	// Error loading the image
-	return false;
+	std::cout << "Successfully loaded cooked texture:" << cookedPath.string() << ", width:" << container.GetWidth()
+		<< ", height:" << container.GetHeight() << ", levels:" << container.GetLevelCount()
+		<< ", format:" << TextureContainer::GetFormatName(container.GetFormat())
+		<< ", GPU memory:" << (m_textures.GetEntry(texture).gpuBytes / 1024) << " KB" << std::endl;
+
+	return(texture);
 }
 
 /***********************************************************
  *  BindGLTextures()
  *
  *  This method is used for binding the loaded textures to
- *  OpenGL texture memory slots.  There are up to 16 slots.
+ *  OpenGL texture memory slots.  Every texture array gets
+ *  the slot of its index.  Without arrays every texture gets
+ *  its own slot while there are enough of them, the textures
+ *  past that are bound into a shared slot when they are used.
+ *  The two samplers of the shader must never point at the
+ *  same slot, so the last slot is left to the array sampler
+ *  and the one before it is the shared slot.  Bindless
+ *  textures are not bound at all, their handles are written
+ *  into the storage block that the shader reads them from.
  ***********************************************************/
 void SceneManager::BindGLTextures()
 {
-	for (int i = 0; i < m_loadedTextures; i++)
+	GLint maxTextureUnits = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &maxTextureUnits);
+
+	const int arrayCount = m_textures.GetArrayCount();
+
+	m_sharedTextureUnit = maxTextureUnits - 2;
+	m_boundTextureUnits = 0;
+	if (m_textureBinding == TEXTURE_BINDING_BINDLESS)
+	{
+		std::vector<GLuint64> handles(m_textures.GetCount());
+		for (int i = 0; i < m_textures.GetCount(); i++)
+		{
+			handles[i] = m_textures.GetBindlessHandle(i);
+		}
+
+		if (m_textureHandleBuffer == 0)
+		{
+			glGenBuffers(1, &m_textureHandleBuffer);
+		}
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_textureHandleBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, handles.size() * sizeof(GLuint64), handles.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TEXTURE_HANDLE_BLOCK_BINDING, m_textureHandleBuffer);
+
+		m_pShaderManager->setIntValue(m_shaderHandles.useBindlessTextures, true);
+		m_pShaderManager->setSampler2DValue(m_shaderHandles.objectTextureArray, maxTextureUnits - 1);
+	}
+	else if (arrayCount == 0)
+	{
+		m_boundTextureUnits = m_textures.GetCount();
+		if (m_boundTextureUnits > m_sharedTextureUnit)
+		{
+			m_boundTextureUnits = m_sharedTextureUnit;
+		}
+		m_pShaderManager->setSampler2DValue(m_shaderHandles.objectTextureArray, maxTextureUnits - 1);
+	}
+
+	for (int i = 0; i < arrayCount; i++)
+	{
+		// bind texture arrays on corresponding texture units
+		GLStateCache::BindTextureUnit(i, GL_TEXTURE_2D_ARRAY, m_textures.GetArrayID(i));
+	}
+	for (int i = 0; i < m_boundTextureUnits; i++)
 	{
 		// bind textures on corresponding texture units
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
+		GLStateCache::BindTextureUnit(i, GL_TEXTURE_2D, m_textures.GetTextureID(i));
 	}
+	m_pShaderManager->setSampler2DValue(m_shaderHandles.objectTexture, m_sharedTextureUnit);
+	GLStateCache::ActiveTexture(0);
 }
 
 /***********************************************************
@@ -147,135 +445,110 @@ void SceneManager::BindGLTextures()
  ***********************************************************/
 void SceneManager::DestroyGLTextures()
 {
-	for (int i = 0; i < m_loadedTextures; i++)
-	{
-		glGenTextures(1, &m_textureIDs[i].ID);
-	}
+	m_textures.DestroyAll();
+	m_boundTextureUnits = 0;
 }
 
 /***********************************************************
- *  FindTextureID()
+ *  LoadMaterialTable()
  *
- *  This method is used for getting an ID for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  This method is used for packing the previously defined
+ *  materials into the material table of the shader with a
+ *  single upload, and for indexing the material tags.
  ***********************************************************/
-int SceneManager::FindTextureID(std::string tag)
+void SceneManager::LoadMaterialTable()
 {
-	int textureID = -1;
-	int index = 0;
-	bool bFound = false;
+	std::vector<MaterialData> materialTable(m_objectMaterials.size());
 
-	while ((index < m_loadedTextures) && (bFound == false))
+	m_materialIndices.clear();
+	for (int index = 0; index < (int)m_objectMaterials.size(); index++)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
+		const OBJECT_MATERIAL& material = m_objectMaterials[index];
+
+		materialTable[index].ambientColor = material.ambientColor;
+		materialTable[index].ambientStrength = material.ambientStrength;
+		materialTable[index].diffuseColor = material.diffuseColor;
+		materialTable[index].shininess = material.shininess;
+		materialTable[index].specularColor = material.specularColor;
+		materialTable[index].padding = 0.0f;
+
+		// the first material defined with a tag is the one
+		// that is used for that tag
+		uint32_t hash = HashName(material.tag);
+		auto result = m_materialIndices.emplace(hash, index);
+		if ((result.second == false) &&
+			(m_objectMaterials[result.first->second].tag != material.tag))
 		{
-			textureID = m_textureIDs[index].ID;
-			bFound = true;
+			std::cout << "Material tag hash collision: " << material.tag << std::endl;
 		}
-		else
-			index++;
 	}
 
-	return(textureID);
+	m_pShaderManager->UpdateMaterialTable(materialTable.data(), materialTable.size());
 }
 
 /***********************************************************
- *  FindTextureSlot()
+ *  FindMaterialIndex()
  *
- *  This method is used for getting a slot index for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  This method is used for getting the material table index
+ *  of the previously defined material that is associated
+ *  with the passed in tag, or -1 if there is none.
  ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
+int SceneManager::FindMaterialIndex(std::string_view tag)
 {
-	int textureSlot = -1;
-	int index = 0;
-	bool bFound = false;
-
-	while ((index < m_loadedTextures) && (bFound == false))
+	auto found = m_materialIndices.find(HashName(tag));
+	if (found == m_materialIndices.end())
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
-		{
-			textureSlot = index;
-			bFound = true;
-		}
-		else
-			index++;
+		return(-1);
 	}
 
-	return(textureSlot);
+	return(found->second);
 }
 
 /***********************************************************
- *  FindMaterial()
+ *  ResolveShaderHandles()
  *
- *  This method is used for getting a material from the previously
- *  defined materials list that is associated with the passed in tag.
+ *  This method is used for resolving the handles of the
+ *  uniforms that are set for every draw, so that rendering
+ *  never needs to look up a uniform by name.
  ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
+void SceneManager::ResolveShaderHandles()
 {
-	if (m_objectMaterials.size() == 0)
-	{
-		return(false);
-	}
-
-	int index = 0;
-	bool bFound = false;
-	while ((index < m_objectMaterials.size()) && (bFound == false))
+	if (NULL == m_pShaderManager)
 	{
-		if (m_objectMaterials[index].tag.compare(tag) == 0)
-		{
-			bFound = true;
-			material.ambientColor = m_objectMaterials[index].ambientColor;
-			material.ambientStrength = m_objectMaterials[index].ambientStrength;
-			material.diffuseColor = m_objectMaterials[index].diffuseColor;
-			material.specularColor = m_objectMaterials[index].specularColor;
-			material.shininess = m_objectMaterials[index].shininess;
-		}
-		else
-		{
-			index++;
-		}
+		return;
 	}
 
-	return(true);
+	m_shaderHandles.objectTexture = m_pShaderManager->GetUniformHandle(g_TextureValueName);
+	m_shaderHandles.objectTextureArray = m_pShaderManager->GetUniformHandle(g_TextureArrayValueName);
+	m_shaderHandles.useBindlessTextures = m_pShaderManager->GetUniformHandle(g_UseBindlessTexturesName);
+	m_shaderHandles.useTexture = m_pShaderManager->GetUniformHandle(g_UseTextureName);
+	m_shaderHandles.firstInstance = m_pShaderManager->GetUniformHandle(g_FirstInstanceName);
 }
 
 /***********************************************************
  *  SetTransformations()
  *
- *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
+ *  This method is used for adding a scene graph node with
+ *  the passed in transformation values.  The meshes that
+ *  are submitted next are placed with this node, and the
+ *  returned node can be used to move them later on.
  ***********************************************************/
-void SceneManager::SetTransformations(
+int SceneManager::SetTransformations(
 	glm::vec3 scaleXYZ,
 	float xRotationDegrees,
 	float yRotationDegrees,
 	float zRotationDegrees,
 	glm::vec3 positionXYZ)
 {
-	// variables for this method
-	glm::mat4 modelView;
-	glm::mat4 scale;
-	glm::mat4 rotationX;
-	glm::mat4 rotationY;
-	glm::mat4 rotationZ;
-	glm::mat4 translation;
-
-	// set the scale value in the transform buffer
-	scale = glm::scale(scaleXYZ);
-	// set the rotation values in the transform buffer
-	rotationX = glm::rotate(glm::radians(xRotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
-	rotationY = glm::rotate(glm::radians(yRotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
-	rotationZ = glm::rotate(glm::radians(zRotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
-	// set the translation value in the transform buffer
-	translation = glm::translate(positionXYZ);
-
-	modelView = translation * rotationX * rotationY * rotationZ * scale;
-
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
-	}
+	SceneGraph::TRANSFORM transform;
+
+	transform.scale = scaleXYZ;
+	transform.rotationDegrees = glm::vec3(xRotationDegrees, yRotationDegrees, zRotationDegrees);
+	transform.position = positionXYZ;
+
+	m_currentNode = m_sceneGraph.AddNode(transform);
+
+	return(m_currentNode);
 }
 
 /***********************************************************
@@ -298,31 +571,92 @@ void SceneManager::SetShaderColor(
 	currentColor.b = blueColorValue;
 	currentColor.a = alphaValue;
 
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
-	}
+	m_drawState.bUseTexture = false;
+	m_drawState.color = currentColor;
 }
 
 /***********************************************************
  *  SetShaderTexture()
  *
  *  This method is used for setting the texture data
- *  associated with the passed in ID into the shader.
+ *  associated with the passed in handle into the shader
+ *  for the next draw command.
  ***********************************************************/
-void SceneManager::SetShaderTexture(std::string textureTag)
+void SceneManager::SetShaderTexture(TextureHandle texture)
 {
-	if (NULL != m_pShaderManager)
+	m_drawState.bUseTexture = true;
+
+	// a texture that failed to load keeps the previous texture
+	if (m_textures.IsValid(texture) == true)
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
+		m_drawState.texture = texture;
+		ResolveTextureBinding(m_drawState);
+	}
+}
 
-		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
-		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
+/***********************************************************
+ *  ResolveTextureBinding()
+ *
+ *  This method is used for setting the binding and the
+ *  index that the shader selects the texture of a packet
+ *  with, which depend on how the textures are bound.
+ ***********************************************************/
+void SceneManager::ResolveTextureBinding(RenderQueue::DRAW_PACKET& packet)
+{
+	const TextureRegistry::TEXTURE_ENTRY& entry = m_textures.GetEntry(packet.texture);
+
+	if (m_textureBinding == TEXTURE_BINDING_BINDLESS)
+	{
+		// every texture is read through its handle, so the
+		// draws do not bind any texture
+		packet.textureIndex = packet.texture;
+		packet.textureBinding = 0;
+	}
+	else
+	{
+		// the textures of one array share their binding, the
+		// textures of their own are numbered after the arrays
+		packet.textureIndex = entry.layer;
+		packet.textureBinding = entry.array;
+		if (entry.array < 0)
+		{
+			packet.textureBinding = m_textures.GetArrayCount() + packet.texture;
+		}
 	}
 }
 
+/***********************************************************
+ *  BindShaderTexture()
+ *
+ *  This method is used for pointing the sampler of the
+ *  shader at the texture unit of the passed in texture, or
+ *  at the unit of the array that it was packed into.  The
+ *  bindless textures need no sampler.
+ ***********************************************************/
+void SceneManager::BindShaderTexture(TextureHandle texture)
+{
+	if ((m_textures.IsValid(texture) == false) ||
+		(m_textureBinding == TEXTURE_BINDING_BINDLESS))
+	{
+		return;
+	}
+
+	int textureArray = m_textures.GetEntry(texture).array;
+	if (textureArray >= 0)
+	{
+		m_pShaderManager->setSampler2DValue(m_shaderHandles.objectTextureArray, textureArray);
+		return;
+	}
+
+	int textureSlot = texture;
+	if (texture >= m_boundTextureUnits)
+	{
+		textureSlot = m_sharedTextureUnit;
+		GLStateCache::BindTextureUnit(textureSlot, GL_TEXTURE_2D, m_textures.GetTextureID(texture));
+	}
+	m_pShaderManager->setSampler2DValue(m_shaderHandles.objectTexture, textureSlot);
+}
+
 /***********************************************************
  *  SetTextureUVScale()
  *
@@ -331,38 +665,338 @@ void SceneManager::SetShaderTexture(std::string textureTag)
  ***********************************************************/
 void SceneManager::SetTextureUVScale(float u, float v)
 {
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
-	}
+	m_drawState.UVscale = glm::vec2(u, v);
 }
 
 /***********************************************************
  *  SetShaderMaterial()
  *
- *  This method is used for passing the material values
- *  into the shader.
+ *  This method is used for selecting the material in the
+ *  material table of the shader for the next draw command.
  ***********************************************************/
 void SceneManager::SetShaderMaterial(
-	std::string materialTag)
+	std::string_view materialTag)
+{
+	int materialIndex = FindMaterialIndex(materialTag);
+	if (materialIndex >= 0)
+	{
+		m_drawState.materialIndex = materialIndex;
+	}
+}
+
+/***********************************************************
+ *  SubmitMesh()
+ *
+ *  This method is used for adding a scene object that draws
+ *  the passed in mesh parts with the current node and the
+ *  shader state that was set since the previous draw.
+ ***********************************************************/
+void SceneManager::SubmitMesh(
+	ShapeMeshes::MESH_TYPE mesh,
+	unsigned int meshParts)
+{
+	SCENE_OBJECT object = {};
+
+	m_drawState.mesh = mesh;
+	m_drawState.meshParts = meshParts;
+	m_drawState.vertexFormat = m_basicMeshes->GetMeshVertexFormat(mesh);
+
+	// only untextured draws can be translucent - the shader
+	// writes an alpha of 1 for every textured draw
+	m_drawState.blendMode = RenderQueue::BLEND_OPAQUE;
+	if ((m_drawState.bUseTexture == false) && (m_drawState.color.a < 1.0f))
+	{
+		m_drawState.blendMode = RenderQueue::BLEND_ALPHA;
+	}
+
+	// the world matrix and bounds are filled in once the
+	// world matrix of the node has been composed
+	object.node = m_currentNode;
+	object.worldVersion = 0;
+	object.gpuObject = -1;
+	object.packet = m_drawState;
+	m_sceneObjects.push_back(object);
+}
+
+/***********************************************************
+ *  SubmitSceneObjects()
+ *
+ *  This method is used for adding every scene object into
+ *  the render queue.  The world matrix and bounds of an
+ *  object are only derived again when its node was updated
+ *  since the previous frame.  The objects of the GPU culling
+ *  pass are not queued, they are only written into its
+ *  buffers again when they changed.
+ ***********************************************************/
+void SceneManager::SubmitSceneObjects()
 {
-	if (m_objectMaterials.size() > 0)
+	glm::vec3 viewPosition = glm::vec3(m_pShaderManager->GetFrameData().viewPosition);
+
+	for (SCENE_OBJECT& object : m_sceneObjects)
 	{
-		OBJECT_MATERIAL material;
-		bool bReturn = false;
+		bool bChanged = false;
 
-		bReturn = FindMaterial(materialTag, material);
-		if (bReturn == true)
+		if ((object.node != SceneGraph::NO_PARENT) &&
+			(object.worldVersion != m_sceneGraph.GetWorldVersion(object.node)))
 		{
-			m_pShaderManager->setVec3Value("material.ambientColor", material.ambientColor);
-			m_pShaderManager->setFloatValue("material.ambientStrength", material.ambientStrength);
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
+			bChanged = true;
+
+			// the world box and sphere of the object, for culling
+			const ShapeMeshes::MESH_BOUNDS& localBounds = m_basicMeshes->GetMeshBounds(object.packet.mesh);
+
+			object.packet.model = m_sceneGraph.GetWorldMatrix(object.node);
+			object.worldVersion = m_sceneGraph.GetWorldVersion(object.node);
+			FrustumCulling::TransformBounds(
+				object.packet.model,
+				localBounds.min,
+				localBounds.max,
+				localBounds.radius,
+				object.boundsCenter,
+				object.boundsExtents,
+				object.boundsRadius);
 		}
+
+		if (object.gpuObject >= 0)
+		{
+			if (bChanged == true)
+			{
+				m_gpuCulling.SetObject(
+					object.gpuObject,
+					GetInstanceData(object.packet),
+					object.boundsCenter,
+					object.boundsExtents,
+					object.boundsRadius);
+			}
+			continue;
+		}
+
+		m_renderQueue.Submit(
+			object.packet,
+			glm::length(glm::vec3(object.packet.model[3]) - viewPosition),
+			object.boundsCenter,
+			object.boundsExtents,
+			object.boundsRadius);
 	}
 }
 
+/***********************************************************
+ *  DrawRenderQueue()
+ *
+ *  This method is used for drawing the sorted render queue.
+ *  The values of every packet are uploaded into the instance
+ *  buffer in sorted order, and each run of packets that can
+ *  share a draw becomes one indirect command, with its base
+ *  instance at the first packet of the run.  The commands
+ *  that share the same states and vertex layout are drawn
+ *  with one multi-draw call.  The states are routed through
+ *  the GL state cache, which drops the values that did not
+ *  change since the previous draw.
+ ***********************************************************/
+void SceneManager::DrawRenderQueue()
+{
+	const int count = m_renderQueue.GetCount();
+
+	if (count == 0)
+	{
+		return;
+	}
+
+	// the memory of the instance data is kept between frames
+	m_instanceData.clear();
+	for (int i = 0; i < count; i++)
+	{
+		m_instanceData.push_back(GetInstanceData(m_renderQueue.GetPacket(i)));
+	}
+
+	if (m_instanceBuffer == 0)
+	{
+		glGenBuffers(1, &m_instanceBuffer);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instanceBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, count * sizeof(InstanceData), m_instanceData.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// all of the meshes are drawn out of the same buffers, which
+	// places the meshes before their commands are built
+	m_basicMeshes->BindMeshBuffers();
+
+	// one command for every run of packets that can share a
+	// draw, grouped by the runs that can share a multi-draw
+	m_drawCommands.clear();
+	m_multiDraws.clear();
+	int first = 0;
+	while (first < count)
+	{
+		const RenderQueue::DRAW_PACKET& packet = m_renderQueue.GetPacket(first);
+		int last = first + 1;
+
+		while ((last < count) &&
+			(RenderQueue::CanShareDraw(packet, m_renderQueue.GetPacket(last)) == true))
+		{
+			last++;
+		}
+
+		ShapeMeshes::DRAW_COMMAND command = {};
+		if (m_basicMeshes->GetDrawCommand(packet.mesh, packet.meshParts, last - first, first, command) == true)
+		{
+			if ((m_multiDraws.empty() == true) ||
+				(RenderQueue::CanShareMultiDraw(
+					m_renderQueue.GetPacket(m_multiDraws.back().firstPacket), packet) == false))
+			{
+				MULTI_DRAW multiDraw = {};
+				multiDraw.firstPacket = first;
+				multiDraw.firstCommand = (int)m_drawCommands.size();
+				multiDraw.commandCount = 0;
+				m_multiDraws.push_back(multiDraw);
+			}
+
+			m_drawCommands.push_back(command);
+			m_multiDraws.back().commandCount++;
+		}
+		first = last;
+	}
+
+	if (m_indirectBuffer == 0)
+	{
+		glGenBuffers(1, &m_indirectBuffer);
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+	glBufferData(
+		GL_DRAW_INDIRECT_BUFFER,
+		m_drawCommands.size() * sizeof(ShapeMeshes::DRAW_COMMAND),
+		m_drawCommands.data(),
+		GL_STREAM_DRAW);
+
+	// the base instance of every command finds its packets
+	m_basicMeshes->BindInstanceBuffer(m_instanceBuffer, count);
+	m_pShaderManager->setIntValue(m_shaderHandles.firstInstance, 0);
+
+	for (const MULTI_DRAW& multiDraw : m_multiDraws)
+	{
+		const RenderQueue::DRAW_PACKET& packet = m_renderQueue.GetPacket(multiDraw.firstPacket);
+
+		if (packet.blendMode == RenderQueue::BLEND_ALPHA)
+		{
+			GLStateCache::Enable(GL_BLEND);
+		}
+		else
+		{
+			GLStateCache::Disable(GL_BLEND);
+		}
+
+		m_pShaderManager->setIntValue(m_shaderHandles.useTexture, packet.bUseTexture);
+		if (packet.bUseTexture == true)
+		{
+			BindShaderTexture(packet.texture);
+		}
+
+		m_basicMeshes->MultiDrawMeshes(
+			packet.vertexFormat,
+			multiDraw.firstCommand * sizeof(ShapeMeshes::DRAW_COMMAND),
+			multiDraw.commandCount);
+	}
+
+	// leave the default blending that was set for the window,
+	// and the uniforms for the draws outside of the queue
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	GLStateCache::Enable(GL_BLEND);
+	m_pShaderManager->setIntValue(m_shaderHandles.firstInstance, -1);
+}
+
+/***********************************************************
+ *  BuildGPUObjects()
+ *
+ *  This method is used for adding the opaque scene objects
+ *  into the GPU culling pass, grouped by the states that
+ *  one multi-draw can share.  The translucent objects stay
+ *  in the render queue, which sorts them back to front.
+ *  Every moved object is written into the pass by the next
+ *  SubmitSceneObjects().
+ ***********************************************************/
+void SceneManager::BuildGPUObjects()
+{
+	if (m_gpuCulling.IsAvailable() == false)
+	{
+		return;
+	}
+
+	m_gpuCulling.Clear();
+	m_gpuGroupStates.clear();
+
+	// the commands need the meshes placed in their buffers
+	m_basicMeshes->BindMeshBuffers();
+
+	for (SCENE_OBJECT& object : m_sceneObjects)
+	{
+		ShapeMeshes::DRAW_COMMAND command = {};
+
+		object.gpuObject = -1;
+		if ((object.packet.blendMode != RenderQueue::BLEND_OPAQUE) ||
+			(m_basicMeshes->GetDrawCommand(object.packet.mesh, object.packet.meshParts, 1, 0, command) == false))
+		{
+			continue;
+		}
+
+		int group = 0;
+		while ((group < (int)m_gpuGroupStates.size()) &&
+			(RenderQueue::CanShareMultiDraw(m_gpuGroupStates[group], object.packet) == false))
+		{
+			group++;
+		}
+		if (group == (int)m_gpuGroupStates.size())
+		{
+			m_gpuCulling.AddGroup();
+			m_gpuGroupStates.push_back(object.packet);
+		}
+
+		object.gpuObject = m_gpuCulling.AddObject(group, command);
+		object.worldVersion = 0;
+	}
+}
+
+/***********************************************************
+ *  DrawGPUObjects()
+ *
+ *  This method is used for drawing the objects that passed
+ *  the last GPU culling pass, with one call for each group.
+ *  The base instance of every written command finds the
+ *  values of its object in the instance buffer of the pass.
+ ***********************************************************/
+void SceneManager::DrawGPUObjects()
+{
+	const int count = m_gpuCulling.GetObjectCount();
+
+	if ((m_gpuCulling.IsAvailable() == false) || (count == 0))
+	{
+		return;
+	}
+
+	m_basicMeshes->BindInstanceBuffer(m_gpuCulling.GetInstanceBuffer(), count);
+	m_basicMeshes->BindMeshBuffers();
+	m_pShaderManager->setIntValue(m_shaderHandles.firstInstance, 0);
+	GLStateCache::Disable(GL_BLEND);
+
+	m_gpuCulling.BeginDraws();
+	for (int group = 0; group < m_gpuCulling.GetGroupCount(); group++)
+	{
+		const RenderQueue::DRAW_PACKET& packet = m_gpuGroupStates[group];
+
+		m_pShaderManager->setIntValue(m_shaderHandles.useTexture, packet.bUseTexture);
+		if (packet.bUseTexture == true)
+		{
+			BindShaderTexture(packet.texture);
+		}
+
+		m_gpuCulling.DrawGroup(m_basicMeshes, group, packet.vertexFormat);
+	}
+	m_gpuCulling.EndDraws();
+
+	// leave the default blending that was set for the window,
+	// and the uniforms for the draws outside of the pass
+	GLStateCache::Enable(GL_BLEND);
+	m_pShaderManager->setIntValue(m_shaderHandles.firstInstance, -1);
+}
+
 /**************************************************************/
 /*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
 /*** preparing and rendering their own 3D replicated scenes.***/
@@ -372,21 +1006,27 @@ void SceneManager::SetShaderMaterial(
 
 void SceneManager::SetupSceneLights() {
 
-	m_pShaderManager->setBoolValue("bUseLighting", true);
-
-	m_pShaderManager->setVec3Value("lightSources[0].position", -9.0f, 7.0f, 4.0f);
-	m_pShaderManager->setVec3Value("lightSources[0].ambientColor", 0.01f, 0.01f, 0.01f);
-	m_pShaderManager->setVec3Value("lightSources[0].diffuseColor", 0.5f, 0.5f, 0.5f);
-	m_pShaderManager->setVec3Value("lightSources[0].specularColor", 0.2f, 0.2f, 0.2f);
-	m_pShaderManager->setFloatValue("lightSources[0].focalStrength", 2.0f);
-	m_pShaderManager->setFloatValue("lightSources[0].specularIntensity", 0.3f);
-
-	m_pShaderManager->setVec3Value("lightSources[1].position", 9.0f, 25.0f, -2.0f);
-	m_pShaderManager->setVec3Value("lightSources[1].ambientColor", 0.01f, 0.01f, 0.01f);
-	m_pShaderManager->setVec3Value("lightSources[1].diffuseColor", 0.01f, 0.01f, 0.01f);
-	m_pShaderManager->setVec3Value("lightSources[1].specularColor", 0.01f, 0.01f, 0.01f);
-	m_pShaderManager->setFloatValue("lightSources[1].focalStrength", 1.0f);
-	m_pShaderManager->setFloatValue("lightSources[1].specularIntensity", 0.1f);
+	m_pShaderManager->setBoolValue(g_UseLightingName, true);
+
+	// all of the lights are written into the light block with
+	// one upload - lights that are not set here stay zeroed
+	LightBlock lights = {};
+
+	lights.lightSources[0].position = glm::vec3(-9.0f, 7.0f, 4.0f);
+	lights.lightSources[0].ambientColor = glm::vec3(0.01f, 0.01f, 0.01f);
+	lights.lightSources[0].diffuseColor = glm::vec3(0.5f, 0.5f, 0.5f);
+	lights.lightSources[0].specularColor = glm::vec3(0.2f, 0.2f, 0.2f);
+	lights.lightSources[0].focalStrength = 2.0f;
+	lights.lightSources[0].specularIntensity = 0.3f;
+
+	lights.lightSources[1].position = glm::vec3(9.0f, 25.0f, -2.0f);
+	lights.lightSources[1].ambientColor = glm::vec3(0.01f, 0.01f, 0.01f);
+	lights.lightSources[1].diffuseColor = glm::vec3(0.01f, 0.01f, 0.01f);
+	lights.lightSources[1].specularColor = glm::vec3(0.01f, 0.01f, 0.01f);
+	lights.lightSources[1].focalStrength = 1.0f;
+	lights.lightSources[1].specularIntensity = 0.1f;
+
+	m_pShaderManager->UpdateLightBlock(lights);
 }
 
 
@@ -394,28 +1034,36 @@ void SceneManager::SetupSceneLights() {
    Load the selected textures into memory for use in the scene.
 */
 void SceneManager::LoadSceneTextures() {
-	bool bReturn;
 
-	bReturn = CreateGLTexture("./textures/wax.jpg", "wax");
+	m_sceneTextures.wax = CreateGLTexture("./textures/wax.jpg", "wax");
 
-	bReturn = CreateGLTexture("./textures/wood_base.jpg", "wood");
+	m_sceneTextures.wood = CreateGLTexture("./textures/wood_base.jpg", "wood");
 
-	bReturn = CreateGLTexture("./textures/wood_worn.jpg", "wood_worn");
+	m_sceneTextures.woodWorn = CreateGLTexture("./textures/wood_worn.jpg", "wood_worn");
 
-	bReturn = CreateGLTexture("./textures/placemat.jpg", "placemat");
+	m_sceneTextures.placemat = CreateGLTexture("./textures/placemat.jpg", "placemat");
 
-	bReturn = CreateGLTexture("./textures/notebook_front.png", "d20");
+	m_sceneTextures.d20 = CreateGLTexture("./textures/notebook_front.png", "d20");
 
-	bReturn = CreateGLTexture("./textures/black_leather.png", "notebook");
+	m_sceneTextures.notebook = CreateGLTexture("./textures/black_leather.png", "notebook");
 
-	bReturn = CreateGLTexture("./textures/marble.jpg", "marble");
+	m_sceneTextures.marble = CreateGLTexture("./textures/marble.jpg", "marble");
 
-	bReturn = CreateGLTexture("./textures/metal.jpeg", "metal");
+	m_sceneTextures.metal = CreateGLTexture("./textures/metal.jpeg", "metal");
 
-	bReturn = CreateGLTexture("./textures/glass.jpg", "glass");
+	m_sceneTextures.glass = CreateGLTexture("./textures/glass.jpg", "glass");
+
+	m_sceneTextures.pages = CreateGLTexture("./textures/notebook_pages.jpg", "pages");
+
+	// the images are decoded while the scene renders with
+	// the placeholders, unless they are in the image cache
+	if ((m_bUseImageCache == true) && (m_textureLoader.EnableImageCache(IMAGE_CACHE_DIRECTORY) == false))
+	{
+		std::cout << "INFO: The image cache directory " << IMAGE_CACHE_DIRECTORY
+			<< " cannot be used, every image is decoded" << std::endl;
+	}
+	m_textureLoader.Start();
 
-	bReturn = CreateGLTexture("./textures/notebook_pages.jpg", "pages");
-	
 	BindGLTextures();
 }
 
@@ -558,7 +1206,10 @@ void SceneManager::PrepareScene()
 	// only one instance of a particular mesh needs to be
 	// loaded in memory no matter how many times it is drawn
 	// in the rendered 3D scene
+	ResolveShaderHandles();
+
 	DefineObjectMaterials();
+	LoadMaterialTable();
 
 	LoadSceneTextures();
 
@@ -573,20 +1224,18 @@ void SceneManager::PrepareScene()
 	m_basicMeshes->LoadTorusMesh(0.05f);
 	m_basicMeshes->LoadPyramid4Mesh();
 
-}
+	// the generated meshes only need the precision of the
+	// compact vertex layout, which halves their vertex size
+	m_basicMeshes->SetMeshVertexFormat(ShapeMeshes::CYLINDER_MESH, VertexFormat::VERTEX_FORMAT_COMPACT);
+	m_basicMeshes->SetMeshVertexFormat(ShapeMeshes::CONE_MESH, VertexFormat::VERTEX_FORMAT_COMPACT);
+	m_basicMeshes->SetMeshVertexFormat(ShapeMeshes::SPHERE_MESH, VertexFormat::VERTEX_FORMAT_COMPACT);
+	m_basicMeshes->SetMeshVertexFormat(ShapeMeshes::TORUS_MESH, VertexFormat::VERTEX_FORMAT_COMPACT);
 
-/***********************************************************
- *  RenderScene()
- *
- *  This method is used for rendering the 3D scene by 
- *  transforming and drawing the basic 3D shapes
- ***********************************************************/
-void SceneManager::RenderScene()
-{
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.						***/
-	/******************************************************************/
+	// the objects of the scene are static, so they are only
+	// placed once and kept in the scene graph
+	m_sceneGraph.Clear();
+	m_sceneObjects.clear();
+	m_currentNode = SceneGraph::NO_PARENT;
 
 	RenderTable();
 	RenderPencil();
@@ -595,6 +1244,243 @@ void SceneManager::RenderScene()
 	RenderDEight();
 	RenderDSix();
 	RenderCandleLid();
+
+	BuildGPUObjects();
+}
+
+/***********************************************************
+ *  EnableGPUCulling()
+ *
+ *  This method is used for loading the GPU culling pass.
+ *  When the driver does not support it, every object keeps
+ *  being culled and drawn by the render queue.
+ ***********************************************************/
+void SceneManager::EnableGPUCulling(const char* computeShaderPath)
+{
+	m_gpuCulling.Initialize(m_pShaderManager, computeShaderPath);
+}
+
+/***********************************************************
+ *  SetTextureBinding()
+ *
+ *  This method is used for choosing how the scene textures
+ *  are bound.  Packed into texture arrays they are resampled
+ *  to one size when they are loaded and the shader selects
+ *  the texture of each object by its layer.  Bindless, they
+ *  keep their sizes and the shader reads the handle of each
+ *  object from a storage block, falling back to the texture
+ *  arrays when the driver does not support it or cannot
+ *  index the handles per instance.  Both let the
+ *  draws of different textures share one multi-draw.  The
+ *  textures are bound to units until every image has landed.
+ ***********************************************************/
+void SceneManager::SetTextureBinding(TEXTURE_BINDING binding)
+{
+	m_requestedTextureBinding = binding;
+}
+
+/***********************************************************
+ *  DisableImageCache()
+ *
+ *  This method is used for decoding every texture image on
+ *  load, for measuring the decoding or when the cached
+ *  images are suspected to be stale.  The cache is neither
+ *  read nor written.
+ ***********************************************************/
+void SceneManager::DisableImageCache()
+{
+	m_bUseImageCache = false;
+}
+
+/***********************************************************
+ *  AddSyntheticObjects()
+ *
+ *  This method is used for adding a field of randomly
+ *  placed, colored or textured and rotated meshes below the
+ *  table, so that the culling, drawing and texture binding
+ *  of a scene with a very large number of objects can be
+ *  measured.
+ ***********************************************************/
+void SceneManager::AddSyntheticObjects(int count)
+{
+	const ShapeMeshes::MESH_TYPE meshes[] = {
+		ShapeMeshes::BOX_MESH,
+		ShapeMeshes::SPHERE_MESH,
+		ShapeMeshes::CYLINDER_MESH,
+		ShapeMeshes::CONE_MESH,
+		ShapeMeshes::TORUS_MESH,
+		ShapeMeshes::PYRAMID4_MESH
+	};
+	const int meshCount = sizeof(meshes) / sizeof(meshes[0]);
+
+	std::mt19937 random(SYNTHETIC_SEED);
+	std::uniform_real_distribution<float> position(-SYNTHETIC_FIELD_SIZE, SYNTHETIC_FIELD_SIZE);
+	std::uniform_real_distribution<float> height(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> scale(0.3f, 1.2f);
+	std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+	std::uniform_real_distribution<float> color(0.2f, 1.0f);
+	const int textureCount = m_textures.GetCount();
+	std::uniform_int_distribution<int> texture(0, (textureCount > 0) ? (textureCount - 1) : 0);
+
+	SetShaderMaterial("wood");
+	for (int i = 0; i < count; i++)
+	{
+		SetTransformations(
+			glm::vec3(scale(random)),
+			angle(random),
+			angle(random),
+			angle(random),
+			glm::vec3(position(random), SYNTHETIC_FIELD_HEIGHT + height(random), position(random)));
+		// every other object uses one of the loaded textures
+		if (((i % 2) == 1) && (textureCount > 0))
+		{
+			SetShaderTexture(texture(random));
+			SetTextureUVScale(1.0f, 1.0f);
+		}
+		else
+		{
+			SetShaderColor(color(random), color(random), color(random), 1.0f);
+		}
+		SubmitMesh(meshes[i % meshCount]);
+	}
+
+	BuildGPUObjects();
+
+	std::cout << "INFO: Added " << count << " synthetic objects, "
+		<< m_gpuCulling.GetObjectCount() << " of all objects are culled on the GPU" << std::endl;
+}
+
+/***********************************************************
+ *  UpdateSceneTextures()
+ *
+ *  This method is used for uploading the textures that were
+ *  decoded since the last frame.  Once the last one has
+ *  landed the chosen texture binding is applied.
+ ***********************************************************/
+void SceneManager::UpdateSceneTextures()
+{
+	if (m_bTexturesLoaded == true)
+	{
+		return;
+	}
+
+	int landed = m_textureLoader.Update(m_textures);
+	if (m_textureLoader.IsLoading() == false)
+	{
+		m_bTexturesLoaded = true;
+		if (m_textureLoader.GetQueuedCount() > 0)
+		{
+			std::cout << "INFO: Texture Loading - " << m_textureLoader.GetQueuedCount() << " textures loaded on "
+				<< m_textureLoader.GetThreadCount() << " threads in " << std::fixed << std::setprecision(1)
+				<< m_textureLoader.GetLoadMilliseconds() << " ms" << std::defaultfloat << ", "
+				<< m_textureLoader.GetCachedCount() << " of them from the image cache" << std::endl;
+		}
+		ApplyTextureBinding();
+	}
+	else if (landed > 0)
+	{
+		// the uploads bind the textures on the active unit
+		BindGLTextures();
+	}
+}
+
+/***********************************************************
+ *  ApplyTextureBinding()
+ *
+ *  This method is used for packing the loaded textures into
+ *  texture arrays or making them resident, as chosen, and
+ *  for selecting the textures of the scene objects again
+ *  with the new binding.
+ ***********************************************************/
+void SceneManager::ApplyTextureBinding()
+{
+	TEXTURE_BINDING binding = m_requestedTextureBinding;
+	if (binding == TEXTURE_BINDING_BINDLESS)
+	{
+		if (m_textures.MakeTexturesResident() == false)
+		{
+			// the arrays keep the draws batched as well
+			std::cout << "INFO: Bindless textures are not supported, the textures are packed into texture arrays" << std::endl;
+			binding = TEXTURE_BINDING_ARRAYS;
+		}
+		else
+		{
+			std::cout << "INFO: Bindless Textures - " << m_textures.GetCount() << " resident textures" << std::endl;
+			m_textureBinding = TEXTURE_BINDING_BINDLESS;
+		}
+	}
+	if (binding == TEXTURE_BINDING_ARRAYS)
+	{
+		int arrayCount = m_textures.BuildTextureArrays(TEXTURE_ARRAY_SIZE, TEXTURE_ARRAY_SIZE);
+		std::cout << "INFO: Texture Arrays - " << arrayCount << " arrays, layer size "
+			<< TEXTURE_ARRAY_SIZE << "x" << TEXTURE_ARRAY_SIZE << std::endl;
+		m_textureBinding = TEXTURE_BINDING_ARRAYS;
+	}
+
+	BindGLTextures();
+
+	std::cout << "INFO: Texture Memory - " << m_textures.GetCount() << " textures, "
+		<< (m_textures.GetTotalMemory() / 1024) << " KB" << std::endl;
+
+	if (m_textureBinding == TEXTURE_BINDING_UNITS)
+	{
+		return;
+	}
+
+	for (SCENE_OBJECT& object : m_sceneObjects)
+	{
+		if ((object.packet.bUseTexture == true) && (m_textures.IsValid(object.packet.texture) == true))
+		{
+			ResolveTextureBinding(object.packet);
+		}
+	}
+	BuildGPUObjects();
+}
+
+/***********************************************************
+ *  FinishLoadingTextures()
+ *
+ *  This method is used for waiting until every texture has
+ *  landed, for when the first frames must not show the
+ *  placeholders.
+ ***********************************************************/
+void SceneManager::FinishLoadingTextures()
+{
+	m_textureLoader.Finish(m_textures);
+	UpdateSceneTextures();
+}
+
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for rendering the 3D scene by 
+ *  updating the transforms that changed and drawing the
+ *  scene objects
+ ***********************************************************/
+void SceneManager::RenderScene()
+{
+	UpdateSceneTextures();
+
+	m_basicMeshes->ResetDrawCallCount();
+	m_renderQueue.Clear();
+
+	// only the nodes that were moved since the last frame
+	// have their world matrices composed again
+	m_updatedTransforms = m_sceneGraph.Update();
+	SubmitSceneObjects();
+
+	// drop everything that the camera cannot see
+	const FrameData& frameData = m_pShaderManager->GetFrameData();
+	FrustumCulling::FRUSTUM frustum;
+	FrustumCulling::ExtractFrustum(frameData.projection * frameData.view, frustum);
+	m_gpuCulling.Cull(frustum);
+	m_renderQueue.Cull(frustum);
+
+	// draw the opaque objects kept by the GPU, then everything
+	// that was queued, sorted by state
+	m_renderQueue.Sort();
+	DrawGPUObjects();
+	DrawRenderQueue();
 }
 
 /* 
@@ -628,11 +1514,11 @@ void SceneManager::RenderPencil() {
 		zRotationDegrees,
 		positionXYZ);
 
-	SetShaderTexture("wood");
+	SetShaderTexture(m_sceneTextures.wood);
 	SetTextureUVScale(0.5, 3.0);
 	SetShaderMaterial("wood");
 
-	m_basicMeshes->DrawCylinderMesh(false, false, true);
+	SubmitMesh(ShapeMeshes::CYLINDER_MESH, ShapeMeshes::MESH_PART_SIDES);
 
 	/* Pencil - Cone */
 
@@ -651,11 +1537,11 @@ void SceneManager::RenderPencil() {
 		zRotationDegrees,
 		positionXYZ);
 
-	SetShaderTexture("wood_worn");
+	SetShaderTexture(m_sceneTextures.woodWorn);
 	SetTextureUVScale(1.0, 1.0);
 	SetShaderMaterial("wood");
 
-	m_basicMeshes->DrawConeMesh(false);
+	SubmitMesh(ShapeMeshes::CONE_MESH, ShapeMeshes::MESH_PART_SIDES);
 
 	/* Pencil - Mid Cylinder */
 
@@ -674,12 +1560,12 @@ void SceneManager::RenderPencil() {
 		zRotationDegrees,
 		positionXYZ);
 
-	SetShaderTexture("wood");
+	SetShaderTexture(m_sceneTextures.wood);
 	SetTextureUVScale(3.0, 3.0);
 	SetShaderMaterial("wood_gray");
 
 
-	m_basicMeshes->DrawCylinderMesh(false, false, true);
+	SubmitMesh(ShapeMeshes::CYLINDER_MESH, ShapeMeshes::MESH_PART_SIDES);
 
 	/* Pencil - Top Cylinder */
 
@@ -698,12 +1584,12 @@ void SceneManager::RenderPencil() {
 		zRotationDegrees,
 		positionXYZ);
 
-	SetShaderTexture("wood");
+	SetShaderTexture(m_sceneTextures.wood);
 	SetTextureUVScale(1.0, 1.0);
 	SetShaderMaterial("wood_black");
 
 
-	m_basicMeshes->DrawCylinderMesh(false, false, true);
+	SubmitMesh(ShapeMeshes::CYLINDER_MESH, ShapeMeshes::MESH_PART_SIDES);
 
 	/* Pencil - Half Sphere Cap */
 
@@ -722,11 +1608,11 @@ void SceneManager::RenderPencil() {
 		zRotationDegrees,
 		positionXYZ);
 
-	SetShaderTexture("wood");
+	SetShaderTexture(m_sceneTextures.wood);
 	SetTextureUVScale(3.0, 3.0);
 	SetShaderMaterial("wood_black_pencilcap");
 
-	m_basicMeshes->DrawHalfSphereMesh();
+	SubmitMesh(ShapeMeshes::SPHERE_MESH, ShapeMeshes::MESH_PART_HALF);
 }
 
 /*
@@ -760,11 +1646,11 @@ void SceneManager::RenderNotebook() {
 		positionXYZ);
 
 
-	SetShaderTexture("pages");
+	SetShaderTexture(m_sceneTextures.pages);
 	SetTextureUVScale(0.25, 0.25);
 	SetShaderMaterial("notebookfront");
 
-	m_basicMeshes->DrawBoxMesh();
+	SubmitMesh(ShapeMeshes::BOX_MESH);
 
 	/* Notebook - Top Cover */
 
@@ -783,11 +1669,11 @@ void SceneManager::RenderNotebook() {
 		zRotationDegrees,
 		positionXYZ);
 
-	SetShaderTexture("notebook");
+	SetShaderTexture(m_sceneTextures.notebook);
 	SetTextureUVScale(1.0, 1.0);
 	SetShaderMaterial("notebookfront");
 
-	m_basicMeshes->DrawBoxMesh();
+	SubmitMesh(ShapeMeshes::BOX_MESH);
 
 	/* Notebook - Bottom Cover */
 
@@ -806,11 +1692,11 @@ void SceneManager::RenderNotebook() {
 		zRotationDegrees,
 		positionXYZ);
 
-	SetShaderTexture("notebook");
+	SetShaderTexture(m_sceneTextures.notebook);
 	SetTextureUVScale(1.0, 1.0);
 	SetShaderMaterial("notebookfront");
 
-	m_basicMeshes->DrawBoxMesh();
+	SubmitMesh(ShapeMeshes::BOX_MESH);
 
 	/* Notebook - Cover */
 
@@ -829,11 +1715,11 @@ void SceneManager::RenderNotebook() {
 		zRotationDegrees,
 		positionXYZ);
 
-	SetShaderTexture("d20");
+	SetShaderTexture(m_sceneTextures.d20);
 	SetTextureUVScale(1.0, 1.0);
 	SetShaderMaterial("notebookfront");
 
-	m_basicMeshes->DrawPlaneMesh();
+	SubmitMesh(ShapeMeshes::PLANE_MESH);
 
 	/* Notebook - Spine */
 
@@ -854,11 +1740,11 @@ void SceneManager::RenderNotebook() {
 		positionXYZ);
 
 	//SetShaderColor(0.15f, 0.15f, 0.15f, 1.0f);
-	SetShaderTexture("notebook");
+	SetShaderTexture(m_sceneTextures.notebook);
 	SetTextureUVScale(1.0, 1.0);
 	SetShaderMaterial("notebookfront");
 
-	m_basicMeshes->DrawBoxMesh();
+	SubmitMesh(ShapeMeshes::BOX_MESH);
 
 }
 
@@ -892,13 +1778,13 @@ void SceneManager::RenderTable() {
 		zRotationDegrees,
 		positionXYZ);
 
-	SetShaderTexture("placemat");
+	SetShaderTexture(m_sceneTextures.placemat);
 	SetTextureUVScale(1.0, 1.0);
 	SetShaderMaterial("placemat");
 
 
 	// draw the mesh with transformation values
-	m_basicMeshes->DrawPlaneMesh();
+	SubmitMesh(ShapeMeshes::PLANE_MESH);
 	/****************************************************************/
 
 	/*************************** TABLE ***************************/
@@ -922,12 +1808,12 @@ void SceneManager::RenderTable() {
 		zRotationDegrees,
 		positionXYZ);
 
-	SetShaderTexture("wood");
+	SetShaderTexture(m_sceneTextures.wood);
 	SetTextureUVScale(3.0, 3.0);
 	SetShaderMaterial("wood");
 
 	// draw the mesh with transformation values
-	m_basicMeshes->DrawCylinderMesh();
+	SubmitMesh(ShapeMeshes::CYLINDER_MESH);
 }
 
 /*
@@ -960,11 +1846,11 @@ void SceneManager::RenderCandle() {
 		zRotationDegrees,
 		positionXYZ);
 
-	SetShaderTexture("wax");
+	SetShaderTexture(m_sceneTextures.wax);
 	SetTextureUVScale(1.0, 1.0);
 	SetShaderMaterial("wax");
 
-	m_basicMeshes->DrawCylinderMesh();
+	SubmitMesh(ShapeMeshes::CYLINDER_MESH);
 
 	/* Candle - Interior */
 
@@ -983,11 +1869,11 @@ void SceneManager::RenderCandle() {
 		zRotationDegrees,
 		positionXYZ);
 
-	SetShaderTexture("glass");
+	SetShaderTexture(m_sceneTextures.glass);
 	SetTextureUVScale(1.0, 1.0);
 	SetShaderMaterial("glass");
 
-	m_basicMeshes->DrawCylinderMesh(false, false, true);
+	SubmitMesh(ShapeMeshes::CYLINDER_MESH, ShapeMeshes::MESH_PART_SIDES);
 
 	/* Candle - Jar Lip */
 
@@ -1006,11 +1892,11 @@ void SceneManager::RenderCandle() {
 		zRotationDegrees,
 		positionXYZ);
 
-	SetShaderTexture("glass");
+	SetShaderTexture(m_sceneTextures.glass);
 	SetTextureUVScale(1.0, 1.0);
 	SetShaderMaterial("glass");
 
-	m_basicMeshes->DrawTorusMesh();
+	SubmitMesh(ShapeMeshes::TORUS_MESH);
 
 	/* Candle - Jar */
 
@@ -1029,11 +1915,11 @@ void SceneManager::RenderCandle() {
 		zRotationDegrees,
 		positionXYZ);
 
-	SetShaderTexture("glass");
+	SetShaderTexture(m_sceneTextures.glass);
 	SetTextureUVScale(1.0, 1.0);
 	SetShaderMaterial("glass");
 
-	m_basicMeshes->DrawCylinderMesh(true, false, true);
+	SubmitMesh(ShapeMeshes::CYLINDER_MESH, ShapeMeshes::MESH_PART_TOP | ShapeMeshes::MESH_PART_SIDES);
 
 	/* Candle - Wick */
 
@@ -1055,7 +1941,7 @@ void SceneManager::RenderCandle() {
 	SetShaderColor(0.83f, 0.79f, 0.705f, 1.0f);
 	SetShaderMaterial("wax");
 
-	m_basicMeshes->DrawCylinderMesh();
+	SubmitMesh(ShapeMeshes::CYLINDER_MESH);
 
 
 }
@@ -1089,11 +1975,11 @@ void SceneManager::RenderDEight() {
 		positionXYZ);
 
 	//SetShaderColor(0.0f, 0.25, 0.65f, 1.0f);
-	SetShaderTexture("marble");
+	SetShaderTexture(m_sceneTextures.marble);
 	SetTextureUVScale(1.0, 1.0);
 	SetShaderMaterial("marble_blue");
 
-	m_basicMeshes->DrawPyramid4Mesh();
+	SubmitMesh(ShapeMeshes::PYRAMID4_MESH);
 
 	/* D8 - Pyramid 2 */
 
@@ -1112,7 +1998,7 @@ void SceneManager::RenderDEight() {
 		zRotationDegrees,
 		positionXYZ);
 
-	m_basicMeshes->DrawPyramid4Mesh();
+	SubmitMesh(ShapeMeshes::PYRAMID4_MESH);
 }
 
 /*
@@ -1144,11 +2030,11 @@ void SceneManager::RenderDSix() {
 		positionXYZ);
 
 	//SetShaderColor(0.15f, 0.55f, 0.35f, 1.0f);
-	SetShaderTexture("marble");
+	SetShaderTexture(m_sceneTextures.marble);
 	SetTextureUVScale(3.1, 2.9);
 	SetShaderMaterial("marble_green");
 
-	m_basicMeshes->DrawBoxMesh();
+	SubmitMesh(ShapeMeshes::BOX_MESH);
 }
 
 /*
@@ -1181,11 +2067,11 @@ void SceneManager::RenderCandleLid() {
 		zRotationDegrees,
 		positionXYZ);
 
-	SetShaderTexture("metal");
+	SetShaderTexture(m_sceneTextures.metal);
 	SetTextureUVScale(1.0, 1.0);
 	SetShaderMaterial("metal_gold");
 
-	m_basicMeshes->DrawCylinderMesh();
+	SubmitMesh(ShapeMeshes::CYLINDER_MESH);
 
 
 	/* Lid - Seal Inner */
@@ -1206,11 +2092,11 @@ void SceneManager::RenderCandleLid() {
 		zRotationDegrees,
 		positionXYZ);
 
-	SetShaderTexture("metal");
+	SetShaderTexture(m_sceneTextures.metal);
 	SetTextureUVScale(1.0, 1.0);
 	SetShaderMaterial("metal_gold");
 
-	m_basicMeshes->DrawCylinderMesh(false, false, true);
+	SubmitMesh(ShapeMeshes::CYLINDER_MESH, ShapeMeshes::MESH_PART_SIDES);
 
 	/* Lid - Seal Outer */
 
@@ -1230,10 +2116,10 @@ void SceneManager::RenderCandleLid() {
 		zRotationDegrees,
 		positionXYZ);
 
-	SetShaderTexture("metal");
+	SetShaderTexture(m_sceneTextures.metal);
 	SetTextureUVScale(1.0, 1.0);
 	SetShaderMaterial("metal_gold");
 
-	m_basicMeshes->DrawCylinderMesh(false, false, true);
+	SubmitMesh(ShapeMeshes::CYLINDER_MESH, ShapeMeshes::MESH_PART_SIDES);
 
 }
\ No newline at end of file
@@ -9,10 +9,18 @@
 
 #pragma once
 
+#include "GPUCulling.h"
+#include "RenderQueue.h"
+#include "SceneGraph.h"
 #include "ShaderManager.h"
 #include "ShapeMeshes.h"
+#include "TextureLoader.h"
+#include "TextureRegistry.h"
+#include "UniformBlocks.h"
 
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 /***********************************************************
@@ -29,10 +37,12 @@ public:
 	// destructor
 	~SceneManager();
 
-	struct TEXTURE_INFO
+	// the ways that the textures can be bound for the draws
+	enum TEXTURE_BINDING
 	{
-		std::string tag;
-		uint32_t ID;
+		TEXTURE_BINDING_UNITS = 0,		// every texture on its own texture unit
+		TEXTURE_BINDING_ARRAYS = 1,		// textures resampled into texture arrays
+		TEXTURE_BINDING_BINDLESS = 2	// resident handles read from a storage block
 	};
 
 	struct OBJECT_MATERIAL
@@ -50,28 +60,132 @@ private:
 	ShaderManager* m_pShaderManager;
 	// pointer to basic shapes object
 	ShapeMeshes* m_basicMeshes;
-	// total number of loaded textures
-	int m_loadedTextures;
-	// loaded textures info
-	TEXTURE_INFO m_textureIDs[16];
+	// loaded textures
+	TextureRegistry m_textures;
+	// number of textures that stay bound to their own
+	// texture unit, the rest share the last unit
+	int m_boundTextureUnits;
+	// texture unit shared by the textures past the bound ones
+	int m_sharedTextureUnit;
+	// how the textures are bound for the draws, and the
+	// binding that is applied once every texture has landed
+	TEXTURE_BINDING m_textureBinding;
+	TEXTURE_BINDING m_requestedTextureBinding;
+	// decodes the images of the loaded textures, and whether
+	// it keeps the decoded images in the image cache
+	TextureLoader m_textureLoader;
+	bool m_bTexturesLoaded;
+	bool m_bUseImageCache;
+	// bindless handle of every texture, read by the shader
+	GLuint m_textureHandleBuffer;
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// material table index of every material tag, keyed by
+	// the hash of the tag
+	std::unordered_map<uint32_t, int> m_materialIndices;
+
+	// uniform handles that are set for every draw
+	struct SHADER_HANDLES
+	{
+		UniformHandle objectTexture;
+		UniformHandle objectTextureArray;
+		UniformHandle useBindlessTextures;
+		UniformHandle useTexture;
+		UniformHandle firstInstance;
+	};
+	SHADER_HANDLES m_shaderHandles;
+
+	// handles of the scene textures, resolved when the
+	// textures are loaded
+	struct SCENE_TEXTURES
+	{
+		TextureHandle wax;
+		TextureHandle wood;
+		TextureHandle woodWorn;
+		TextureHandle placemat;
+		TextureHandle d20;
+		TextureHandle notebook;
+		TextureHandle marble;
+		TextureHandle metal;
+		TextureHandle glass;
+		TextureHandle pages;
+	};
+	SCENE_TEXTURES m_sceneTextures;
+
+	// transforms of the scene objects, and the node that
+	// the next submitted mesh is placed with
+	SceneGraph m_sceneGraph;
+	int m_currentNode;
+	// number of nodes updated for the last rendered frame
+	int m_updatedTransforms;
+
+	// one submitted mesh of the retained scene, with its
+	// world bounds from the last time its node changed - the
+	// opaque objects are culled and drawn by the GPU culling
+	// pass when it is available, the others by the queue
+	struct SCENE_OBJECT
+	{
+		int node;
+		unsigned int worldVersion;
+		int gpuObject;
+		RenderQueue::DRAW_PACKET packet;
+		glm::vec3 boundsCenter;
+		glm::vec3 boundsExtents;
+		float boundsRadius;
+	};
+	std::vector<SCENE_OBJECT> m_sceneObjects;
+
+	// draws of the current frame
+	RenderQueue m_renderQueue;
+	// shader state that the next submitted draw will use
+	RenderQueue::DRAW_PACKET m_drawState;
+	// per-object values of the queued draws, in sorted order,
+	// and the storage buffer the shaders read them from
+	std::vector<InstanceData> m_instanceData;
+	GLuint m_instanceBuffer;
+
+	// a block of indirect commands drawn with one multi-draw,
+	// with the packet whose states the commands share
+	struct MULTI_DRAW
+	{
+		int firstPacket;
+		int firstCommand;
+		int commandCount;
+	};
+	// indirect commands of the queued draws, the multi-draws
+	// that submit them, and the buffer they are read from
+	std::vector<ShapeMeshes::DRAW_COMMAND> m_drawCommands;
+	std::vector<MULTI_DRAW> m_multiDraws;
+	GLuint m_indirectBuffer;
+
+	// objects culled on the GPU, and the states shared by the
+	// objects of every group of the GPU culling pass
+	GPUCulling m_gpuCulling;
+	std::vector<RenderQueue::DRAW_PACKET> m_gpuGroupStates;
+
+	// resolve the per-draw uniform handles from the shader
+	void ResolveShaderHandles();
 
 	// load texture images and convert to OpenGL texture data
-	bool CreateGLTexture(const char* filename, std::string tag);
+	TextureHandle CreateGLTexture(const char* filename, std::string_view tag);
+	// create a texture from the cooked file of an image
+	TextureHandle CreateCookedTexture(const char* filename, std::string_view tag);
 	// bind loaded OpenGL textures to slots in memory
 	void BindGLTextures();
 	// free the loaded OpenGL textures
 	void DestroyGLTextures();
-	// find a loaded texture by tag
-	int FindTextureID(std::string tag);
-	int FindTextureSlot(std::string tag);
-	// find a defined material by tag
-	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
-
-	// set the transformation values 
-	// into the transform buffer
-	void SetTransformations(
+	// upload the textures that were decoded since the last frame
+	void UpdateSceneTextures();
+	// apply the chosen texture binding to the landed textures
+	void ApplyTextureBinding();
+	// upload the defined materials into the material table
+	void LoadMaterialTable();
+	// find the material table index of a defined material by tag
+	int FindMaterialIndex(std::string_view tag);
+
+	// add a scene graph node with the transformation
+	// values, for the meshes submitted after it
+	int SetTransformations(
 		glm::vec3 scaleXYZ,
 		float XrotationDegrees,
 		float YrotationDegrees,
@@ -86,7 +200,9 @@ private:
 		float alphaValue);
 
 	// set the texture data into the shader
-	void SetShaderTexture(std::string textureTag);
+	void SetShaderTexture(TextureHandle texture);
+	// select the texture of a packet with the current binding
+	void ResolveTextureBinding(RenderQueue::DRAW_PACKET& packet);
 
 	// set the UV scale for the texture mapping
 	void SetTextureUVScale(
@@ -94,7 +210,23 @@ private:
 
 	// set the object material into the shader
 	void SetShaderMaterial(
-		std::string materialTag);
+		std::string_view materialTag);
+
+	// add a scene object that draws a mesh with the current
+	// node and shader state
+	void SubmitMesh(
+		ShapeMeshes::MESH_TYPE mesh,
+		unsigned int meshParts = ShapeMeshes::MESH_PART_ALL);
+	// add the scene objects into the render queue
+	void SubmitSceneObjects();
+	// draw the sorted render queue
+	void DrawRenderQueue();
+	// move the opaque scene objects into the GPU culling pass
+	void BuildGPUObjects();
+	// draw the objects that the GPU culling pass kept
+	void DrawGPUObjects();
+	// set a texture into the sampler of the shader
+	void BindShaderTexture(TextureHandle texture);
 
 public:
 
@@ -102,6 +234,73 @@ public:
 	// customize for their own 3D scene
 	void PrepareScene();
 	void RenderScene();
+
+	// cull the opaque objects on the GPU when the driver can,
+	// must be called before PrepareScene()
+	void EnableGPUCulling(const char* computeShaderPath);
+	// choose how the textures are bound, so that the draws of
+	// different textures can share their states when they are
+	// packed or bindless - must be called before PrepareScene()
+	void SetTextureBinding(TEXTURE_BINDING binding);
+	// the binding in use, which is the arrays binding when
+	// bindless textures are not supported by the driver
+	inline TEXTURE_BINDING GetTextureBinding() const
+	{
+		return(m_textureBinding);
+	}
+	// decode every texture image instead of reading the ones
+	// that did not change from the image cache - must be
+	// called before PrepareScene()
+	void DisableImageCache();
+	// wait until every texture image has been decoded and
+	// uploaded instead of rendering the placeholders
+	void FinishLoadingTextures();
+	// textures that still show their placeholder
+	inline int GetPendingTextureCount() const
+	{
+		return(m_textureLoader.GetPendingCount());
+	}
+	// GPU memory used by the loaded textures
+	inline size_t GetTextureMemory() const
+	{
+		return(m_textures.GetTotalMemory());
+	}
+	// add a field of randomly placed objects around the scene
+	// for measuring the culling and drawing of large scenes
+	void AddSyntheticObjects(int count);
+	inline bool IsGPUCullingEnabled() const
+	{
+		return(m_gpuCulling.IsAvailable());
+	}
+	// objects in the GPU culling pass and the GPU time of the
+	// last finished culling and drawing passes
+	inline int GetGPUObjectCount() const
+	{
+		return(m_gpuCulling.GetObjectCount());
+	}
+	inline double GetGPUCullMilliseconds() const
+	{
+		return(m_gpuCulling.GetCullMilliseconds());
+	}
+	inline double GetGPUDrawMilliseconds() const
+	{
+		return(m_gpuCulling.GetDrawMilliseconds());
+	}
+	// state change counts of the last rendered frame
+	inline const RenderQueue::QUEUE_STATS& GetRenderStats() const
+	{
+		return(m_renderQueue.GetStats());
+	}
+	// scene graph nodes updated for the last rendered frame
+	inline int GetUpdatedTransformCount() const
+	{
+		return(m_updatedTransforms);
+	}
+	// draw calls sent to OpenGL for the last rendered frame
+	inline unsigned int GetDrawCallCount() const
+	{
+		return(m_basicMeshes->GetDrawCallCount());
+	}
 	void LoadSceneTextures();
 	void DefineObjectMaterials();
 	void SetupSceneLights();
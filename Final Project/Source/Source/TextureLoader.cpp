@@ -0,0 +1,417 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureloader.cpp
+// ============
+// decode the texture images on worker threads and upload them as they land
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureLoader.h"
+#include "GLStateCache.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+/***********************************************************
+ *  TextureLoader()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureLoader::TextureLoader()
+{
+	m_nextJob = 0;
+	m_bStopping = false;
+	m_threadCount = 0;
+	m_cachedCount = 0;
+	m_landedCount = 0;
+	m_nextUploadBuffer = 0;
+	m_loadMilliseconds = 0.0;
+
+	// the scene images are sRGB encoded, and the box filter is
+	// as cheap as the one of the driver
+	m_mipmapOptions.filter = MipmapGenerator::FILTER_BOX;
+	m_mipmapOptions.bSRGB = true;
+	m_mipmapOptions.bPreserveCoverage = false;
+	m_mipmapOptions.coverageReference = 0.5f;
+	m_mipmapOptions.threadCount = 1;
+	m_mipmapOptions.bUseSIMD = true;
+	m_mipmapOptions.bUseAVX2 = true;
+
+	for (int i = 0; i < UPLOAD_BUFFER_COUNT; i++)
+	{
+		m_uploadBuffers[i] = 0;
+		m_uploadFences[i] = 0;
+	}
+}
+
+/***********************************************************
+ *  ~TextureLoader()
+ *
+ *  The destructor for the class - the workers are stopped
+ *  and the images that never landed are freed.
+ ***********************************************************/
+TextureLoader::~TextureLoader()
+{
+	m_bStopping = true;
+	StopLoading();
+
+	for (LOAD_JOB& job : m_jobs)
+	{
+		FreePixels(job);
+	}
+}
+
+/***********************************************************
+ *  Queue()
+ *
+ *  This method is used for adding an image file that is
+ *  decoded into the passed in texture once the loading
+ *  has been started.
+ ***********************************************************/
+void TextureLoader::Queue(const char* filename, TextureHandle texture)
+{
+	LOAD_JOB job = {};
+
+	job.filename = filename;
+	job.texture = texture;
+	job.pixels = NULL;
+	m_jobs.push_back(job);
+}
+
+/***********************************************************
+ *  EnableImageCache()
+ *
+ *  This method is used for keeping the decoded images and
+ *  their mipmaps in the passed in directory, so that the
+ *  images are only decoded again once they change.
+ ***********************************************************/
+bool TextureLoader::EnableImageCache(const char* directory)
+{
+	return(m_imageCache.Enable(directory, FLIP_VERTICALLY, m_mipmapOptions));
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for starting the worker threads,
+ *  one for every queued image up to the number of cores.
+ *  The workers take the next job until none are left.
+ ***********************************************************/
+void TextureLoader::Start()
+{
+	m_startTime = std::chrono::steady_clock::now();
+	if (m_jobs.empty() == true)
+	{
+		// every texture was cooked, there is nothing to decode
+		return;
+	}
+
+	// the flag is only read by the workers
+	stbi_set_flip_vertically_on_load(FLIP_VERTICALLY);
+
+	m_threadCount = (int)std::thread::hardware_concurrency();
+	if (m_threadCount > MAX_DECODE_THREADS)
+	{
+		m_threadCount = MAX_DECODE_THREADS;
+	}
+	if (m_threadCount > (int)m_jobs.size())
+	{
+		m_threadCount = (int)m_jobs.size();
+	}
+	if ((m_threadCount < 1) && (m_jobs.empty() == false))
+	{
+		m_threadCount = 1;
+	}
+
+	// the cores that no worker decodes on help to filter the
+	// rows of the mipmaps
+	m_mipmapOptions.threadCount = std::max((int)std::thread::hardware_concurrency() / m_threadCount, 1);
+
+	for (int i = 0; i < m_threadCount; i++)
+	{
+		m_workers.emplace_back(&TextureLoader::DecodeJobs, this);
+	}
+
+	glGenBuffers(UPLOAD_BUFFER_COUNT, m_uploadBuffers);
+}
+
+/***********************************************************
+ *  DecodeJobs()
+ *
+ *  This method is run by every worker thread for decoding
+ *  the queued images and building their mipmaps, and for
+ *  handing each decoded image over to the GL thread.
+ ***********************************************************/
+void TextureLoader::DecodeJobs()
+{
+	while (m_bStopping == false)
+	{
+		int index = m_nextJob++;
+		if (index >= (int)m_jobs.size())
+		{
+			return;
+		}
+
+		DecodeJob(m_jobs[index]);
+
+		std::lock_guard<std::mutex> lock(m_decodedMutex);
+		m_decodedJobs.push_back(index);
+	}
+}
+
+/***********************************************************
+ *  DecodeJob()
+ *
+ *  This method is used for reading the decoded image and
+ *  mipmaps of a job from the image cache, or for decoding
+ *  the image file and building its mipmaps when the cache
+ *  has no up to date copy.  The file is read once, for both
+ *  decoding and hashing it into the cache.
+ ***********************************************************/
+void TextureLoader::DecodeJob(LOAD_JOB& job)
+{
+	ImageCache::SOURCE_STAMP stamp = {};
+	if (m_imageCache.Load(job.filename.c_str(), stamp,
+		job.width, job.height, job.channels, job.cachedPixels, job.mipmaps) == true)
+	{
+		job.pixels = job.cachedPixels.data();
+		m_cachedCount++;
+		return;
+	}
+	job.cachedPixels.clear();
+	job.mipmaps.clear();
+
+	std::vector<uint8_t> contents;
+	if (ImageCache::ReadFile(job.filename.c_str(), contents) == false)
+	{
+		return;
+	}
+
+	job.pixels = stbi_load_from_memory(
+		contents.data(), (int)contents.size(), &job.width, &job.height, &job.channels, 0);
+	if (NULL == job.pixels)
+	{
+		return;
+	}
+
+	MipmapGenerator::GenerateMipmaps(
+		job.pixels, job.width, job.height, job.channels, m_mipmapOptions, job.mipmaps);
+	m_imageCache.Store(job.filename.c_str(), stamp, contents,
+		job.pixels, job.width, job.height, job.channels, job.mipmaps);
+}
+
+/***********************************************************
+ *  FreePixels()
+ *
+ *  This method is used for freeing the decoded image of a
+ *  job, with stb_image when it decoded the image.
+ ***********************************************************/
+void TextureLoader::FreePixels(LOAD_JOB& job)
+{
+	if ((NULL != job.pixels) && (job.cachedPixels.empty() == true))
+	{
+		stbi_image_free(job.pixels);
+	}
+	std::vector<uint8_t>().swap(job.cachedPixels);
+	job.pixels = NULL;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for uploading the images that were
+ *  decoded since the last update, as far as the upload
+ *  ring has free buffers.  The rest wait for the next
+ *  update.  A texture that failed to decode keeps its
+ *  placeholder, it counts as landed.
+ ***********************************************************/
+int TextureLoader::Update(const TextureRegistry& textures)
+{
+	if (IsLoading() == false)
+	{
+		return(0);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_decodedMutex);
+		m_uploadJobs.insert(m_uploadJobs.end(), m_decodedJobs.begin(), m_decodedJobs.end());
+		m_decodedJobs.clear();
+	}
+
+	size_t uploaded = 0;
+	while ((uploaded < m_uploadJobs.size()) &&
+		(UploadJob(textures, m_jobs[m_uploadJobs[uploaded]]) == true))
+	{
+		uploaded++;
+	}
+	m_uploadJobs.erase(m_uploadJobs.begin(), m_uploadJobs.begin() + uploaded);
+	m_landedCount += (int)uploaded;
+
+	if (IsLoading() == false)
+	{
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - m_startTime;
+		m_loadMilliseconds = elapsed.count();
+		StopLoading();
+	}
+
+	return((int)uploaded);
+}
+
+/***********************************************************
+ *  Finish()
+ *
+ *  This method is used for waiting until every queued
+ *  image has been decoded and uploaded.
+ ***********************************************************/
+void TextureLoader::Finish(const TextureRegistry& textures)
+{
+	while (IsLoading() == true)
+	{
+		if (Update(textures) == 0)
+		{
+			// wait for a worker to decode an image or for the
+			// GPU to release a buffer of the ring
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+}
+
+/***********************************************************
+ *  UploadJob()
+ *
+ *  This method is used for copying a decoded image and its
+ *  mipmaps into the next buffer of the upload ring, one
+ *  level after the other, and for specifying every level
+ *  of its texture from that buffer.  When the buffer cannot
+ *  be mapped or its contents are lost on unmapping, the
+ *  levels are specified from the decoded pixels instead.
+ *  The decoded levels are freed once they have been
+ *  handed to the driver.
+ ***********************************************************/
+bool TextureLoader::UploadJob(const TextureRegistry& textures, LOAD_JOB& job)
+{
+	if (NULL == job.pixels)
+	{
+		std::cout << "Could not load image:" << job.filename << std::endl;
+		return(true);
+	}
+
+	GLsync& fence = m_uploadFences[m_nextUploadBuffer];
+	if (fence != 0)
+	{
+		// the driver may still be reading the last upload
+		if (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED)
+		{
+			return(false);
+		}
+		glDeleteSync(fence);
+		fence = 0;
+	}
+
+	const TextureRegistry::TEXTURE_ENTRY& entry = textures.GetEntry(job.texture);
+	GLenum format = (job.channels == 4) ? GL_RGBA : GL_RGB;
+	size_t imageBytes = (size_t)job.width * (size_t)job.height * (size_t)job.channels;
+	size_t uploadBytes = imageBytes;
+	for (const std::vector<uint8_t>& mipmap : job.mipmaps)
+	{
+		uploadBytes += mipmap.size();
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_uploadBuffers[m_nextUploadBuffer]);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, uploadBytes, NULL, GL_STREAM_DRAW);
+	unsigned char* mapped = (unsigned char*)glMapBufferRange(
+		GL_PIXEL_UNPACK_BUFFER, 0, uploadBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	bool bBuffered = false;
+	if (NULL != mapped)
+	{
+		std::memcpy(mapped, job.pixels, imageBytes);
+		size_t offset = imageBytes;
+		for (const std::vector<uint8_t>& mipmap : job.mipmaps)
+		{
+			std::memcpy(mapped + offset, mipmap.data(), mipmap.size());
+			offset += mipmap.size();
+		}
+		// the contents are lost when the unmap fails
+		bBuffered = (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE);
+	}
+	if (bBuffered == false)
+	{
+		// the levels are specified straight from the decoded
+		// pixels instead, which copies them before returning
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	// the rows of the decoded levels are tightly packed
+	GLStateCache::BindTexture(GL_TEXTURE_2D, entry.ID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, entry.internalFormat, job.width, job.height, 0, format, GL_UNSIGNED_BYTE,
+		(bBuffered == true) ? (const void*)0 : (const void*)job.pixels);
+	size_t offset = imageBytes;
+	int levelWidth = job.width;
+	int levelHeight = job.height;
+	for (int level = 1; level <= (int)job.mipmaps.size(); level++)
+	{
+		levelWidth = (levelWidth > 1) ? (levelWidth / 2) : 1;
+		levelHeight = (levelHeight > 1) ? (levelHeight / 2) : 1;
+		glTexImage2D(GL_TEXTURE_2D, level, entry.internalFormat, levelWidth, levelHeight, 0, format, GL_UNSIGNED_BYTE,
+			(bBuffered == true) ? (const void*)offset : (const void*)job.mipmaps[level - 1].data());
+		offset += job.mipmaps[level - 1].size();
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	// sample the levels that were uploaded, and only those
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)job.mipmaps.size());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+		(job.mipmaps.empty() == true) ? GL_LINEAR : GL_LINEAR_MIPMAP_LINEAR);
+	GLStateCache::BindTexture(GL_TEXTURE_2D, 0);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	// the decoded levels are only freed once they have been
+	// handed to the driver one way or the other
+	FreePixels(job);
+	std::vector<std::vector<uint8_t>>().swap(job.mipmaps);
+
+	if (bBuffered == true)
+	{
+		fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_nextUploadBuffer = (m_nextUploadBuffer + 1) % UPLOAD_BUFFER_COUNT;
+	}
+
+	std::cout << "Successfully loaded image:" << job.filename << ", width:" << job.width << ", height:" << job.height
+		<< ", channels:" << job.channels << ", GPU memory:" << (entry.gpuBytes / 1024) << " KB" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  StopLoading()
+ *
+ *  This method is used for waiting for the worker threads
+ *  to return and for deleting the upload ring.
+ ***********************************************************/
+void TextureLoader::StopLoading()
+{
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+	m_workers.clear();
+
+	for (int i = 0; i < UPLOAD_BUFFER_COUNT; i++)
+	{
+		if (m_uploadFences[i] != 0)
+		{
+			glDeleteSync(m_uploadFences[i]);
+			m_uploadFences[i] = 0;
+		}
+	}
+	if (m_uploadBuffers[0] != 0)
+	{
+		glDeleteBuffers(UPLOAD_BUFFER_COUNT, m_uploadBuffers);
+		for (int i = 0; i < UPLOAD_BUFFER_COUNT; i++)
+		{
+			m_uploadBuffers[i] = 0;
+		}
+	}
+}
@@ -0,0 +1,155 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureloader.h
+// ============
+// decode the texture images on worker threads and upload them as they land
+//
+// The image files are decoded by a small pool of worker threads while the
+// scene keeps rendering with placeholder textures.  The workers also build
+// the mipmap chain of every image, filtered in linear light.  Every frame
+// the GL thread copies the decoded levels into a ring of pixel unpack
+// buffers and specifies the textures from them, so the driver copies the
+// pixels on its own time.  A buffer of the ring is only written again once
+// the fence of its last upload has passed, which never blocks the frame.
+// When the image cache is enabled the workers read the decoded levels of
+// the images that did not change since the last run instead of decoding.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ImageCache.h"
+#include "MipmapGenerator.h"
+#include "TextureRegistry.h"
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  TextureLoader
+ *
+ *  This class contains the queued image files, the worker
+ *  threads that decode them and the buffers that the
+ *  decoded images are uploaded through.
+ ***********************************************************/
+class TextureLoader
+{
+public:
+	// constructor
+	TextureLoader();
+	// destructor
+	~TextureLoader();
+
+	// add an image file to decode into a registered texture,
+	// must be called before Start()
+	void Queue(const char* filename, TextureHandle texture);
+	// keep the decoded images in the passed in directory, must
+	// be called before Start() - returns false when the
+	// directory cannot be used
+	bool EnableImageCache(const char* directory);
+	// start decoding the queued images on the worker threads
+	void Start();
+	// upload the decoded images that the upload buffers have
+	// room for - returns the number of textures that landed
+	int Update(const TextureRegistry& textures);
+	// block until every queued image has landed
+	void Finish(const TextureRegistry& textures);
+
+	inline bool IsLoading() const
+	{
+		return(m_landedCount < (int)m_jobs.size());
+	}
+	inline int GetQueuedCount() const
+	{
+		return((int)m_jobs.size());
+	}
+	// number of textures that still show their placeholder
+	inline int GetPendingCount() const
+	{
+		return((int)m_jobs.size() - m_landedCount);
+	}
+	inline int GetThreadCount() const
+	{
+		return(m_threadCount);
+	}
+	// number of landed images that were read from the cache
+	inline int GetCachedCount() const
+	{
+		return(m_cachedCount);
+	}
+	// time from Start() until the last texture landed
+	inline double GetLoadMilliseconds() const
+	{
+		return(m_loadMilliseconds);
+	}
+
+private:
+	// number of buffers in the upload ring
+	static constexpr int UPLOAD_BUFFER_COUNT = 3;
+	// most worker threads that decode at the same time
+	static constexpr int MAX_DECODE_THREADS = 4;
+	// the scene images are stored bottom row first
+	static constexpr bool FLIP_VERTICALLY = true;
+
+	// one image file, its decoded pixels and the levels below
+	// the image - the pixels are decoded by stb_image, or point
+	// into the cached image when it was read from the cache
+	struct LOAD_JOB
+	{
+		std::string filename;
+		TextureHandle texture;
+		unsigned char* pixels;
+		std::vector<uint8_t> cachedPixels;
+		std::vector<std::vector<uint8_t>> mipmaps;
+		int width;
+		int height;
+		int channels;
+	};
+
+	// queued images - the list does not change once the
+	// workers are running
+	std::vector<LOAD_JOB> m_jobs;
+	// next job that a worker takes, and the set flag that
+	// stops the workers early
+	std::atomic<int> m_nextJob;
+	std::atomic<bool> m_bStopping;
+	// jobs decoded by the workers, guarded by the mutex, and
+	// the decoded jobs the GL thread has not uploaded yet
+	std::mutex m_decodedMutex;
+	std::vector<int> m_decodedJobs;
+	std::vector<int> m_uploadJobs;
+	std::vector<std::thread> m_workers;
+	int m_threadCount;
+	// how the workers build the mipmaps, and the cache of the
+	// decoded images and their mipmaps
+	MipmapGenerator::MIPMAP_OPTIONS m_mipmapOptions;
+	ImageCache m_imageCache;
+	std::atomic<int> m_cachedCount;
+	int m_landedCount;
+
+	// ring of pixel unpack buffers and the fence of the last
+	// upload from every buffer
+	GLuint m_uploadBuffers[UPLOAD_BUFFER_COUNT];
+	GLsync m_uploadFences[UPLOAD_BUFFER_COUNT];
+	int m_nextUploadBuffer;
+
+	std::chrono::steady_clock::time_point m_startTime;
+	double m_loadMilliseconds;
+
+	// decode jobs until none are left - runs on the workers
+	void DecodeJobs();
+	// read a job from the image cache, or decode it and store
+	// it in the cache
+	void DecodeJob(LOAD_JOB& job);
+	// free the decoded pixels of a job
+	static void FreePixels(LOAD_JOB& job);
+	// upload one decoded job - returns false when the next
+	// buffer of the ring is still in use
+	bool UploadJob(const TextureRegistry& textures, LOAD_JOB& job);
+	// wait for the workers and free the upload ring
+	void StopLoading();
+};
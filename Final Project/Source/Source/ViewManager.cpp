@@ -20,8 +20,6 @@ namespace
 	// Variables for window width and height
 	const int WINDOW_WIDTH = 1000;
 	const int WINDOW_HEIGHT = 800;
-	const char* g_ViewName = "view";
-	const char* g_ProjectionName = "projection";
 
 	// camera object used for viewing and interacting with
 	// the 3D scene
@@ -126,7 +124,7 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 	glfwSetScrollCallback(window, scroll_callback);
 
 	// enable blending for supporting tranparent rendering
-	glEnable(GL_BLEND);
+	GLStateCache::Enable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	m_pWindow = window;
@@ -270,11 +268,13 @@ void ViewManager::PrepareSceneView()
 	// if the shader manager object is valid
 	if (NULL != m_pShaderManager)
 	{
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ViewName, view);
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
-		// set the view position of the camera into the shader for proper rendering
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+		FrameData frameData;
+
+		// set the view and projection matrices and the view position
+		// of the camera into the frame data block for proper rendering
+		frameData.view = view;
+		frameData.projection = projection;
+		frameData.viewPosition = glm::vec4(g_pCamera->Position, 1.0f);
+		m_pShaderManager->UpdateFrameData(frameData);
 	}
 }
\ No newline at end of file
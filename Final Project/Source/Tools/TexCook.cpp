@@ -0,0 +1,386 @@
+///////////////////////////////////////////////////////////////////////////////
+// texcook.cpp
+// ============
+// cook the scene images into texture files that are ready for upload
+//
+// Every image is decoded once, flipped the same way the scene loads it, and
+// written with its whole mipmap chain into a cooked texture file next to it
+// (or into the output directory).  The mipmaps are filtered in linear light,
+// with a Kaiser filter unless the box filter is asked for.  The scene loads
+// the cooked file instead of the image whenever it is at least as new as
+// the image.
+//
+//   texcook [--format raw|bc|bc1|bc3|bc4|bc5|bc7] [--quality fast|normal|high]
+//           [--mip-filter box|kaiser] [--alpha-coverage <reference>]
+//           [--threads <count>] [--output <directory>] <image or directory>...
+//
+// "raw" keeps the texels as they are, "bc" compresses opaque images to BC1
+// and images with alpha to BC3, and the other formats force one block
+// format for every image.  BC4 and BC5 hold data rather than color, so
+// their mipmaps are filtered without the sRGB conversion.  The quality
+// preset trades encoding time for fewer artifacts, and the peak signal to
+// noise ratio of the first level is reported for every compressed image.
+// The alpha coverage keeps the share of texels above the reference alpha
+// in every level.  A directory cooks every image in it.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BlockCompression.h"
+#include "MipmapGenerator.h"
+#include "TextureContainer.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	const char* const FORMAT_ARGUMENT = "--format";
+	const char* const QUALITY_ARGUMENT = "--quality";
+	const char* const MIP_FILTER_ARGUMENT = "--mip-filter";
+	const char* const ALPHA_COVERAGE_ARGUMENT = "--alpha-coverage";
+	const char* const THREADS_ARGUMENT = "--threads";
+	const char* const OUTPUT_ARGUMENT = "--output";
+	// extension of the cooked texture files
+	const char* const COOKED_EXTENSION = ".ctex";
+
+	// how the levels of the images are stored
+	enum COOK_FORMAT
+	{
+		COOK_RAW = 0,		// the decoded texels
+		COOK_BC_AUTO = 1,	// BC1, or BC3 for images with alpha
+		COOK_BC_FIXED = 2	// one block format for every image
+	};
+
+	struct COOK_OPTIONS
+	{
+		COOK_FORMAT cookFormat;
+		// the block format of COOK_BC_FIXED
+		TEXTURE_FORMAT blockFormat;
+		BlockCompression::ENCODE_OPTIONS encode;
+		MipmapGenerator::MIPMAP_OPTIONS mipmaps;
+	};
+
+	/***********************************************************
+	 *  ParseFormat()
+	 *
+	 *  Reads the value of the format argument into the options,
+	 *  returns false for an unknown format.
+	 ***********************************************************/
+	bool ParseFormat(const char* name, COOK_OPTIONS& options)
+	{
+		const struct
+		{
+			const char* name;
+			TEXTURE_FORMAT format;
+		} blockFormats[] = {
+			{ "bc1", TEXTURE_FORMAT_BC1 },
+			{ "bc3", TEXTURE_FORMAT_BC3 },
+			{ "bc4", TEXTURE_FORMAT_BC4 },
+			{ "bc5", TEXTURE_FORMAT_BC5 },
+			{ "bc7", TEXTURE_FORMAT_BC7 }
+		};
+
+		if (std::strcmp(name, "raw") == 0)
+		{
+			options.cookFormat = COOK_RAW;
+			return(true);
+		}
+		if (std::strcmp(name, "bc") == 0)
+		{
+			options.cookFormat = COOK_BC_AUTO;
+			return(true);
+		}
+		for (const auto& blockFormat : blockFormats)
+		{
+			if (std::strcmp(name, blockFormat.name) == 0)
+			{
+				options.cookFormat = COOK_BC_FIXED;
+				options.blockFormat = blockFormat.format;
+				return(true);
+			}
+		}
+		return(false);
+	}
+
+	/***********************************************************
+	 *  ParseQuality()
+	 *
+	 *  Reads the value of the quality argument into the
+	 *  options, returns false for an unknown preset.
+	 ***********************************************************/
+	bool ParseQuality(const char* name, COOK_OPTIONS& options)
+	{
+		const char* const presets[] = { "fast", "normal", "high" };
+		for (int i = 0; i < 3; i++)
+		{
+			if (std::strcmp(name, presets[i]) == 0)
+			{
+				options.encode.quality = (BlockCompression::QUALITY)i;
+				return(true);
+			}
+		}
+		return(false);
+	}
+
+	/***********************************************************
+	 *  IsImageFile()
+	 *
+	 *  Returns whether a file in a cooked directory has the
+	 *  extension of an image that stb_image can decode.
+	 ***********************************************************/
+	bool IsImageFile(const std::filesystem::path& path)
+	{
+		std::string extension = path.extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(),
+			[](unsigned char c) { return((char)std::tolower(c)); });
+
+		return((extension == ".jpg") || (extension == ".jpeg") || (extension == ".png") ||
+			(extension == ".tga") || (extension == ".bmp"));
+	}
+
+	/***********************************************************
+	 *  ExpandToRGBA()
+	 *
+	 *  Returns the texels of an RGB level with an opaque alpha
+	 *  added, as the block encoder reads them.
+	 ***********************************************************/
+	std::vector<unsigned char> ExpandToRGBA(const std::vector<unsigned char>& texels, int channels)
+	{
+		if (channels == 4)
+		{
+			return(texels);
+		}
+
+		const size_t count = texels.size() / 3;
+		std::vector<unsigned char> expanded(count * 4);
+		for (size_t i = 0; i < count; i++)
+		{
+			expanded[i * 4 + 0] = texels[i * 3 + 0];
+			expanded[i * 4 + 1] = texels[i * 3 + 1];
+			expanded[i * 4 + 2] = texels[i * 3 + 2];
+			expanded[i * 4 + 3] = 255;
+		}
+		return(expanded);
+	}
+
+	/***********************************************************
+	 *  CookImage()
+	 *
+	 *  Decodes an image, builds its mipmap chain, converts the
+	 *  levels into the cooked format and writes the file.
+	 ***********************************************************/
+	bool CookImage(
+		const std::filesystem::path& imagePath,
+		const std::filesystem::path& cookedPath,
+		const COOK_OPTIONS& options)
+	{
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+
+		// the same orientation that the scene loads images with
+		stbi_set_flip_vertically_on_load(true);
+		unsigned char* image = stbi_load(imagePath.string().c_str(), &width, &height, &channels, 0);
+		if (NULL == image)
+		{
+			std::cout << "Could not load image:" << imagePath.string() << std::endl;
+			return(false);
+		}
+		if ((channels != 3) && (channels != 4))
+		{
+			std::cout << "Not implemented to handle image with " << channels << " channels: " << imagePath.string() << std::endl;
+			stbi_image_free(image);
+			return(false);
+		}
+
+		TEXTURE_FORMAT format = (channels == 4) ? TEXTURE_FORMAT_RGBA8 : TEXTURE_FORMAT_RGB8;
+		if (options.cookFormat == COOK_BC_AUTO)
+		{
+			format = (channels == 4) ? TEXTURE_FORMAT_BC3 : TEXTURE_FORMAT_BC1;
+		}
+		else if (options.cookFormat == COOK_BC_FIXED)
+		{
+			format = options.blockFormat;
+		}
+
+		// the full chain down to 1x1, with the same sizes as the
+		// driver gives the levels
+		MipmapGenerator::MIPMAP_OPTIONS mipmapOptions = options.mipmaps;
+		mipmapOptions.bSRGB = (format != TEXTURE_FORMAT_BC4) && (format != TEXTURE_FORMAT_BC5);
+
+		std::vector<std::vector<unsigned char>> levels;
+		MipmapGenerator::GenerateMipmaps(image, width, height, channels, mipmapOptions, levels);
+		levels.emplace(levels.begin(), image, image + (size_t)width * height * channels);
+		stbi_image_free(image);
+
+		double psnr = 0.0;
+		double encodeMilliseconds = 0.0;
+		if (TextureContainer::IsBlockCompressed(format) == true)
+		{
+			auto startTime = std::chrono::steady_clock::now();
+
+			int levelWidth = width;
+			int levelHeight = height;
+			for (size_t i = 0; i < levels.size(); i++)
+			{
+				std::vector<unsigned char> texels = ExpandToRGBA(levels[i], channels);
+				std::vector<unsigned char> blocks;
+				BlockCompression::CompressImage(format, texels.data(), levelWidth, levelHeight, options.encode, blocks);
+				if (i == 0)
+				{
+					psnr = BlockCompression::MeasurePSNR(format, texels.data(), levelWidth, levelHeight, blocks);
+				}
+				levels[i].swap(blocks);
+				levelWidth = (levelWidth > 1) ? (levelWidth / 2) : 1;
+				levelHeight = (levelHeight > 1) ? (levelHeight / 2) : 1;
+			}
+
+			// the time includes the one measurement of the
+			// first level
+			encodeMilliseconds = std::chrono::duration<double, std::milli>(
+				std::chrono::steady_clock::now() - startTime).count();
+		}
+
+		if (TextureContainer::Write(cookedPath.string().c_str(), format, width, height, levels) == false)
+		{
+			std::cout << "Could not write cooked texture:" << cookedPath.string() << std::endl;
+			return(false);
+		}
+
+		size_t cookedBytes = 0;
+		for (const std::vector<unsigned char>& level : levels)
+		{
+			cookedBytes += level.size();
+		}
+		std::cout << "Cooked " << imagePath.string() << " -> " << cookedPath.string()
+			<< ", width:" << width << ", height:" << height << ", levels:" << levels.size()
+			<< ", format:" << TextureContainer::GetFormatName(format)
+			<< ", size:" << (cookedBytes / 1024) << " KB";
+		if (TextureContainer::IsBlockCompressed(format) == true)
+		{
+			std::cout << ", PSNR:" << psnr << " dB, encoded in " << encodeMilliseconds << " ms";
+		}
+		std::cout << std::endl;
+
+		return(true);
+	}
+}
+
+/***********************************************************
+ *  main(int, char*)
+ *
+ *  This function gets called after the cooker has been
+ *  launched, and cooks every image named on the command line.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	COOK_OPTIONS options = {};
+	options.cookFormat = COOK_RAW;
+	options.encode.quality = BlockCompression::QUALITY_NORMAL;
+	options.encode.threadCount = 0;
+	options.encode.bUseSIMD = true;
+	options.mipmaps.filter = MipmapGenerator::FILTER_KAISER;
+	options.mipmaps.bSRGB = true;
+	options.mipmaps.bPreserveCoverage = false;
+	options.mipmaps.coverageReference = 0.5f;
+	options.mipmaps.threadCount = 0;
+	options.mipmaps.bUseSIMD = true;
+	options.mipmaps.bUseAVX2 = true;
+
+	bool bUsage = false;
+	std::filesystem::path outputDirectory;
+	std::vector<std::filesystem::path> images;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if ((std::strcmp(argv[i], FORMAT_ARGUMENT) == 0) && ((i + 1) < argc))
+		{
+			bUsage = bUsage || (ParseFormat(argv[++i], options) == false);
+		}
+		else if ((std::strcmp(argv[i], QUALITY_ARGUMENT) == 0) && ((i + 1) < argc))
+		{
+			bUsage = bUsage || (ParseQuality(argv[++i], options) == false);
+		}
+		else if ((std::strcmp(argv[i], MIP_FILTER_ARGUMENT) == 0) && ((i + 1) < argc))
+		{
+			const char* filter = argv[++i];
+			bUsage = bUsage || ((std::strcmp(filter, "box") != 0) && (std::strcmp(filter, "kaiser") != 0));
+			options.mipmaps.filter = (std::strcmp(filter, "box") == 0) ?
+				MipmapGenerator::FILTER_BOX : MipmapGenerator::FILTER_KAISER;
+		}
+		else if ((std::strcmp(argv[i], ALPHA_COVERAGE_ARGUMENT) == 0) && ((i + 1) < argc))
+		{
+			options.mipmaps.bPreserveCoverage = true;
+			options.mipmaps.coverageReference = (float)std::atof(argv[++i]);
+		}
+		else if ((std::strcmp(argv[i], THREADS_ARGUMENT) == 0) && ((i + 1) < argc))
+		{
+			options.encode.threadCount = std::atoi(argv[++i]);
+			options.mipmaps.threadCount = options.encode.threadCount;
+		}
+		else if ((std::strcmp(argv[i], OUTPUT_ARGUMENT) == 0) && ((i + 1) < argc))
+		{
+			outputDirectory = argv[++i];
+		}
+		else if (std::filesystem::is_directory(argv[i]) == true)
+		{
+			std::vector<std::filesystem::path> found;
+			for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(argv[i]))
+			{
+				if ((entry.is_regular_file() == true) && (IsImageFile(entry.path()) == true))
+				{
+					found.push_back(entry.path());
+				}
+			}
+			std::sort(found.begin(), found.end());
+			images.insert(images.end(), found.begin(), found.end());
+		}
+		else
+		{
+			images.push_back(argv[i]);
+		}
+	}
+
+	if ((bUsage == true) || (images.empty() == true))
+	{
+		std::cout << "usage: texcook [--format raw|bc|bc1|bc3|bc4|bc5|bc7] [--quality fast|normal|high]"
+			<< " [--mip-filter box|kaiser] [--alpha-coverage <reference>] [--threads <count>]"
+			<< " [--output <directory>] <image or directory>..." << std::endl;
+		return(EXIT_FAILURE);
+	}
+
+	if ((outputDirectory.empty() == false) && (std::filesystem::is_directory(outputDirectory) == false))
+	{
+		std::filesystem::create_directories(outputDirectory);
+	}
+
+	int failed = 0;
+	for (const std::filesystem::path& image : images)
+	{
+		std::filesystem::path cookedPath = image;
+		cookedPath.replace_extension(COOKED_EXTENSION);
+		if (outputDirectory.empty() == false)
+		{
+			cookedPath = outputDirectory / cookedPath.filename();
+		}
+
+		if (CookImage(image, cookedPath, options) == false)
+		{
+			failed++;
+		}
+	}
+
+	std::cout << "INFO: Cooked " << (images.size() - failed) << " of " << images.size() << " images" << std::endl;
+
+	return((failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
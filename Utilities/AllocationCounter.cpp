@@ -0,0 +1,213 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationcounter.cpp
+// ============
+// count the heap allocations made while rendering each frame
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace
+{
+	// allocations made since the last reset
+	std::atomic<size_t> g_FrameAllocations(0);
+
+#ifdef _DEBUG
+	/***********************************************************
+	 *  AllocateAligned()
+	 *
+	 *  Counts an over-aligned allocation and serves it from
+	 *  the aligned allocator of the platform.  Returns NULL
+	 *  when it failed.
+	 ***********************************************************/
+	void* AllocateAligned(std::size_t size, std::align_val_t alignment)
+	{
+		g_FrameAllocations++;
+		std::size_t bytes = (std::size_t)alignment;
+		// the size must be a multiple of the alignment
+		size = (size > 0) ? ((size + bytes - 1) / bytes * bytes) : bytes;
+#ifdef _WIN32
+		return(_aligned_malloc(size, bytes));
+#else
+		return(std::aligned_alloc(bytes, size));
+#endif
+	}
+
+	/***********************************************************
+	 *  FreeAligned()
+	 *
+	 *  Frees an allocation made by AllocateAligned().
+	 ***********************************************************/
+	void FreeAligned(void* memory)
+	{
+#ifdef _WIN32
+		_aligned_free(memory);
+#else
+		std::free(memory);
+#endif
+	}
+#endif
+}
+
+/***********************************************************
+ *  IsEnabled()
+ *
+ *  Returns whether the global allocation hook is part of
+ *  this build.
+ ***********************************************************/
+bool AllocationCounter::IsEnabled()
+{
+#ifdef _DEBUG
+	return(true);
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  ResetFrameCount()
+ *
+ *  Called at the start of every frame to reset the count.
+ ***********************************************************/
+void AllocationCounter::ResetFrameCount()
+{
+	g_FrameAllocations = 0;
+}
+
+/***********************************************************
+ *  GetFrameCount()
+ *
+ *  Returns the allocations made since the last reset.
+ ***********************************************************/
+size_t AllocationCounter::GetFrameCount()
+{
+	return(g_FrameAllocations);
+}
+
+#ifdef _DEBUG
+
+// replacements of the global allocation functions - every
+// allocation is counted and then served by malloc()
+void* operator new(std::size_t size)
+{
+	g_FrameAllocations++;
+	void* memory = std::malloc(size > 0 ? size : 1);
+	if (NULL == memory)
+	{
+		throw std::bad_alloc();
+	}
+	return(memory);
+}
+
+void* operator new[](std::size_t size)
+{
+	return(operator new(size));
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	g_FrameAllocations++;
+	return(std::malloc(size > 0 ? size : 1));
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	g_FrameAllocations++;
+	return(std::malloc(size > 0 ? size : 1));
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+	std::free(memory);
+}
+
+// the over-aligned forms, which need their own allocator
+// because the memory must be freed by the matching function
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	void* memory = AllocateAligned(size, alignment);
+	if (NULL == memory)
+	{
+		throw std::bad_alloc();
+	}
+	return(memory);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return(operator new(size, alignment));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return(AllocateAligned(size, alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return(AllocateAligned(size, alignment));
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+	FreeAligned(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept
+{
+	FreeAligned(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept
+{
+	FreeAligned(memory);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept
+{
+	FreeAligned(memory);
+}
+
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	FreeAligned(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	FreeAligned(memory);
+}
+
+#endif
@@ -0,0 +1,23 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationcounter.h
+// ============
+// count the heap allocations made while rendering each frame
+//
+// The global operator new hook is only compiled into debug builds (_DEBUG),
+// release builds keep the default allocator and always report zero.  The
+// over-aligned forms of operator new are counted as well.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+namespace AllocationCounter
+{
+	// true when the allocation hook is compiled into this build
+	bool IsEnabled();
+	// start counting the allocations for a new frame
+	void ResetFrameCount();
+	// number of allocations made since the last reset
+	size_t GetFrameCount();
+}
@@ -0,0 +1,1167 @@
+///////////////////////////////////////////////////////////////////////////////
+// blockcompression.cpp
+// ============
+// compress images into the BCn block formats on the CPU
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BlockCompression.h"
+
+#include <xmmintrin.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+namespace
+{
+	// texels in one 4x4 block
+	const int BLOCK_TEXELS = 16;
+
+	// the texels of a block split by channel, so that the same
+	// channel of four texels loads into one SSE register
+	struct BLOCK
+	{
+		alignas(16) float channels[4][BLOCK_TEXELS];
+		bool bOpaque;
+	};
+
+	// palette position of every BC1 index between the endpoints
+	const float COLOR_WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	// palette positions of the eight and the six value modes
+	// of a single channel block - 0 and 255 are not between the
+	// endpoints, and are left out of the refit
+	const float EIGHT_VALUE_WEIGHTS[8] = {
+		0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+	const float SIX_VALUE_WEIGHTS[8] = {
+		0.0f, 1.0f, 1.0f / 5.0f, 2.0f / 5.0f, 3.0f / 5.0f, 4.0f / 5.0f, -1.0f, -1.0f };
+	// interpolation weights of the 4-bit BC7 indices, out of 64
+	const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	/***********************************************************
+	 *  GetRefitCount()
+	 *
+	 *  Returns how many times the endpoints of a block are
+	 *  refitted to its indices with a quality preset.
+	 ***********************************************************/
+	int GetRefitCount(BlockCompression::QUALITY quality)
+	{
+		switch (quality)
+		{
+		case BlockCompression::QUALITY_FAST:
+			return(0);
+		case BlockCompression::QUALITY_NORMAL:
+			return(1);
+		default:
+			return(3);
+		}
+	}
+
+	/***********************************************************
+	 *  GetBlockBytes()
+	 *
+	 *  Returns the size of one block of a format.
+	 ***********************************************************/
+	int GetBlockBytes(TEXTURE_FORMAT format)
+	{
+		return(((format == TEXTURE_FORMAT_BC1) || (format == TEXTURE_FORMAT_BC4)) ? 8 : 16);
+	}
+
+	/***********************************************************
+	 *  GetStoredChannels()
+	 *
+	 *  Returns how many of the RGBA channels a format stores,
+	 *  which are always the first ones.
+	 ***********************************************************/
+	int GetStoredChannels(TEXTURE_FORMAT format)
+	{
+		switch (format)
+		{
+		case TEXTURE_FORMAT_BC1:
+			return(3);
+		case TEXTURE_FORMAT_BC4:
+			return(1);
+		case TEXTURE_FORMAT_BC5:
+			return(2);
+		default:
+			return(4);
+		}
+	}
+
+	/***********************************************************
+	 *  LoadBlock()
+	 *
+	 *  Splits 16 RGBA texels into the channels of a block.
+	 ***********************************************************/
+	void LoadBlock(const uint8_t texels[64], BLOCK& block)
+	{
+		block.bOpaque = true;
+		for (int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				block.channels[c][i] = (float)texels[i * 4 + c];
+			}
+			block.bOpaque = block.bOpaque && (texels[i * 4 + 3] == 255);
+		}
+	}
+
+	/***********************************************************
+	 *  FindNearestIndicesScalar()
+	 *
+	 *  Finds the nearest palette entry of every texel over a
+	 *  run of channels of a block, one texel at a time, and
+	 *  returns the summed squared error.
+	 ***********************************************************/
+	float FindNearestIndicesScalar(
+		const BLOCK& block,
+		int firstChannel,
+		int channelCount,
+		const float palette[][4],
+		int paletteCount,
+		uint8_t indices[BLOCK_TEXELS])
+	{
+		float totalError = 0.0f;
+		for (int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			float bestError = FLT_MAX;
+			int bestIndex = 0;
+			for (int p = 0; p < paletteCount; p++)
+			{
+				float error = 0.0f;
+				for (int c = 0; c < channelCount; c++)
+				{
+					float difference = block.channels[firstChannel + c][i] - palette[p][c];
+					error += difference * difference;
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					bestIndex = p;
+				}
+			}
+			indices[i] = (uint8_t)bestIndex;
+			totalError += bestError;
+		}
+
+		return(totalError);
+	}
+
+	/***********************************************************
+	 *  FindNearestIndices()
+	 *
+	 *  Finds the nearest palette entry of every texel over a
+	 *  run of channels of a block, four texels at a time, and
+	 *  returns the summed squared error.  The indices are the
+	 *  same as those of the scalar search.
+	 ***********************************************************/
+	float FindNearestIndices(
+		const BLOCK& block,
+		int firstChannel,
+		int channelCount,
+		const float palette[][4],
+		int paletteCount,
+		uint8_t indices[BLOCK_TEXELS],
+		bool bUseSIMD)
+	{
+		if (bUseSIMD == false)
+		{
+			return(FindNearestIndicesScalar(block, firstChannel, channelCount, palette, paletteCount, indices));
+		}
+
+		float totalError = 0.0f;
+		for (int i = 0; i < BLOCK_TEXELS; i += 4)
+		{
+			__m128 texels[4];
+			for (int c = 0; c < channelCount; c++)
+			{
+				texels[c] = _mm_load_ps(&block.channels[firstChannel + c][i]);
+			}
+
+			__m128 bestError = _mm_set1_ps(FLT_MAX);
+			__m128 bestIndex = _mm_setzero_ps();
+			for (int p = 0; p < paletteCount; p++)
+			{
+				__m128 error = _mm_setzero_ps();
+				for (int c = 0; c < channelCount; c++)
+				{
+					__m128 difference = _mm_sub_ps(texels[c], _mm_set1_ps(palette[p][c]));
+					error = _mm_add_ps(error, _mm_mul_ps(difference, difference));
+				}
+
+				// only a strictly smaller error takes the texel, as
+				// in the scalar search
+				__m128 closer = _mm_cmplt_ps(error, bestError);
+				bestError = _mm_min_ps(error, bestError);
+				bestIndex = _mm_or_ps(
+					_mm_and_ps(closer, _mm_set1_ps((float)p)),
+					_mm_andnot_ps(closer, bestIndex));
+			}
+
+			alignas(16) float errors[4];
+			alignas(16) float nearest[4];
+			_mm_store_ps(errors, bestError);
+			_mm_store_ps(nearest, bestIndex);
+			for (int j = 0; j < 4; j++)
+			{
+				indices[i + j] = (uint8_t)nearest[j];
+				totalError += errors[j];
+			}
+		}
+
+		return(totalError);
+	}
+
+	/***********************************************************
+	 *  FindPrincipalEndpoints()
+	 *
+	 *  Finds the two ends of the texels of a block along their
+	 *  principal axis over a run of channels, which a few power
+	 *  iterations on their covariance give.
+	 ***********************************************************/
+	void FindPrincipalEndpoints(
+		const BLOCK& block,
+		int firstChannel,
+		int channelCount,
+		float start[4],
+		float end[4])
+	{
+		float mean[4] = {};
+		for (int c = 0; c < channelCount; c++)
+		{
+			for (int i = 0; i < BLOCK_TEXELS; i++)
+			{
+				mean[c] += block.channels[firstChannel + c][i];
+			}
+			mean[c] /= (float)BLOCK_TEXELS;
+		}
+
+		float covariance[4][4] = {};
+		for (int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			for (int a = 0; a < channelCount; a++)
+			{
+				float da = block.channels[firstChannel + a][i] - mean[a];
+				for (int b = a; b < channelCount; b++)
+				{
+					covariance[a][b] += da * (block.channels[firstChannel + b][i] - mean[b]);
+				}
+			}
+		}
+		for (int a = 0; a < channelCount; a++)
+		{
+			for (int b = 0; b < a; b++)
+			{
+				covariance[a][b] = covariance[b][a];
+			}
+		}
+
+		float axis[4] = { 0.5f, 0.5f, 0.5f, 0.5f };
+		for (int iteration = 0; iteration < 4; iteration++)
+		{
+			float next[4] = {};
+			float length = 0.0f;
+			for (int a = 0; a < channelCount; a++)
+			{
+				for (int b = 0; b < channelCount; b++)
+				{
+					next[a] += covariance[a][b] * axis[b];
+				}
+				length += next[a] * next[a];
+			}
+			length = std::sqrt(length);
+			if (length < 1e-6f)
+			{
+				break;
+			}
+			for (int a = 0; a < channelCount; a++)
+			{
+				axis[a] = next[a] / length;
+			}
+		}
+
+		float minProjection = 0.0f;
+		float maxProjection = 0.0f;
+		for (int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			float projection = 0.0f;
+			for (int c = 0; c < channelCount; c++)
+			{
+				projection += (block.channels[firstChannel + c][i] - mean[c]) * axis[c];
+			}
+			minProjection = std::min(projection, minProjection);
+			maxProjection = std::max(projection, maxProjection);
+		}
+
+		for (int c = 0; c < channelCount; c++)
+		{
+			start[c] = std::min(std::max(mean[c] + axis[c] * maxProjection, 0.0f), 255.0f);
+			end[c] = std::min(std::max(mean[c] + axis[c] * minProjection, 0.0f), 255.0f);
+		}
+	}
+
+	/***********************************************************
+	 *  RefitEndpoints()
+	 *
+	 *  Solves for the two endpoints that best reproduce the
+	 *  texels of a block by least squares, with every texel at
+	 *  the palette position of its index.  Indices with a
+	 *  negative position are left out.  Returns false when the
+	 *  indices do not tell the endpoints apart.
+	 ***********************************************************/
+	bool RefitEndpoints(
+		const BLOCK& block,
+		int firstChannel,
+		int channelCount,
+		const uint8_t indices[BLOCK_TEXELS],
+		const float weights[],
+		float start[4],
+		float end[4])
+	{
+		float startStart = 0.0f;
+		float startEnd = 0.0f;
+		float endEnd = 0.0f;
+		float towardsStart[4] = {};
+		float towardsEnd[4] = {};
+		for (int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			float t = weights[indices[i]];
+			if (t < 0.0f)
+			{
+				continue;
+			}
+
+			float s = 1.0f - t;
+			startStart += s * s;
+			startEnd += s * t;
+			endEnd += t * t;
+			for (int c = 0; c < channelCount; c++)
+			{
+				towardsStart[c] += s * block.channels[firstChannel + c][i];
+				towardsEnd[c] += t * block.channels[firstChannel + c][i];
+			}
+		}
+
+		float determinant = startStart * endEnd - startEnd * startEnd;
+		if (std::fabs(determinant) < 1e-6f)
+		{
+			return(false);
+		}
+
+		for (int c = 0; c < channelCount; c++)
+		{
+			float a = (endEnd * towardsStart[c] - startEnd * towardsEnd[c]) / determinant;
+			float b = (startStart * towardsEnd[c] - startEnd * towardsStart[c]) / determinant;
+			start[c] = std::min(std::max(a, 0.0f), 255.0f);
+			end[c] = std::min(std::max(b, 0.0f), 255.0f);
+		}
+
+		return(true);
+	}
+
+	/***********************************************************
+	 *  PackColor565()
+	 *
+	 *  Returns the nearest 5:6:5 color of an 8-bit color.
+	 ***********************************************************/
+	uint16_t PackColor565(const float color[4])
+	{
+		int red = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+		int green = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+		int blue = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+
+		red = (red < 0) ? 0 : ((red > 31) ? 31 : red);
+		green = (green < 0) ? 0 : ((green > 63) ? 63 : green);
+		blue = (blue < 0) ? 0 : ((blue > 31) ? 31 : blue);
+
+		return((uint16_t)((red << 11) | (green << 5) | blue));
+	}
+
+	/***********************************************************
+	 *  UnpackColor565()
+	 *
+	 *  Expands a 5:6:5 color to the 8-bit color that the GPU
+	 *  decodes it to.
+	 ***********************************************************/
+	void UnpackColor565(uint16_t packed, int color[3])
+	{
+		int red = (packed >> 11) & 31;
+		int green = (packed >> 5) & 63;
+		int blue = packed & 31;
+
+		color[0] = (red << 3) | (red >> 2);
+		color[1] = (green << 2) | (green >> 4);
+		color[2] = (blue << 3) | (blue >> 2);
+	}
+
+	/***********************************************************
+	 *  BuildColorPalette()
+	 *
+	 *  Builds the four color palette of two 5:6:5 endpoints,
+	 *  or the three color one when the first is not larger -
+	 *  the color part of BC3 always has four colors.
+	 ***********************************************************/
+	void BuildColorPalette(uint16_t color0, uint16_t color1, bool bFourColors, int palette[4][3])
+	{
+		UnpackColor565(color0, palette[0]);
+		UnpackColor565(color1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			if ((bFourColors == true) || (color0 > color1))
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+			else
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  EncodeColorBlock()
+	 *
+	 *  Writes the endpoints and the 2-bit palette indices of
+	 *  the color part of a BC1 or BC3 block.  The endpoints
+	 *  are always ordered for the four color palette.
+	 ***********************************************************/
+	void EncodeColorBlock(const BLOCK& block, uint8_t output[8], BlockCompression::QUALITY quality, bool bUseSIMD)
+	{
+		float start[4];
+		float end[4];
+		FindPrincipalEndpoints(block, 0, 3, start, end);
+
+		float bestError = FLT_MAX;
+		uint16_t bestColor0 = 0;
+		uint16_t bestColor1 = 0;
+		uint8_t bestIndices[BLOCK_TEXELS] = {};
+
+		const int refitCount = GetRefitCount(quality);
+		for (int refit = 0; refit <= refitCount; refit++)
+		{
+			uint16_t color0 = PackColor565(start);
+			uint16_t color1 = PackColor565(end);
+			if (color0 < color1)
+			{
+				std::swap(color0, color1);
+			}
+			// equal endpoints would select the three color
+			// palette, so one of them is moved by a step
+			if (color0 == color1)
+			{
+				if (color1 > 0)
+				{
+					color1--;
+				}
+				else
+				{
+					color0++;
+				}
+			}
+
+			int entries[4][3];
+			BuildColorPalette(color0, color1, false, entries);
+			float palette[4][4] = {};
+			for (int p = 0; p < 4; p++)
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					palette[p][c] = (float)entries[p][c];
+				}
+			}
+
+			uint8_t indices[BLOCK_TEXELS];
+			float error = FindNearestIndices(block, 0, 3, palette, 4, indices, bUseSIMD);
+			if (error < bestError)
+			{
+				bestError = error;
+				bestColor0 = color0;
+				bestColor1 = color1;
+				std::memcpy(bestIndices, indices, sizeof(indices));
+			}
+
+			if ((bestError == 0.0f) ||
+				(refit == refitCount) ||
+				(RefitEndpoints(block, 0, 3, indices, COLOR_WEIGHTS, start, end) == false))
+			{
+				break;
+			}
+		}
+
+		uint32_t packedIndices = 0;
+		for (int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			packedIndices |= (uint32_t)bestIndices[i] << (i * 2);
+		}
+
+		output[0] = (uint8_t)(bestColor0 & 0xff);
+		output[1] = (uint8_t)(bestColor0 >> 8);
+		output[2] = (uint8_t)(bestColor1 & 0xff);
+		output[3] = (uint8_t)(bestColor1 >> 8);
+		std::memcpy(output + 4, &packedIndices, 4);
+	}
+
+	/***********************************************************
+	 *  BuildChannelPalette()
+	 *
+	 *  Builds the palette of a single channel block.  A first
+	 *  endpoint larger than the second selects eight values
+	 *  between them, otherwise six values and 0 and 255.
+	 ***********************************************************/
+	void BuildChannelPalette(int value0, int value1, int palette[8])
+	{
+		palette[0] = value0;
+		palette[1] = value1;
+		if (value0 > value1)
+		{
+			for (int step = 1; step < 7; step++)
+			{
+				palette[step + 1] = ((7 - step) * value0 + step * value1) / 7;
+			}
+		}
+		else
+		{
+			for (int step = 1; step < 5; step++)
+			{
+				palette[step + 1] = ((5 - step) * value0 + step * value1) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	/***********************************************************
+	 *  EncodeChannelMode()
+	 *
+	 *  Encodes one channel of a block in the eight or the six
+	 *  value mode, starting from the passed in endpoints, and
+	 *  returns the squared error of the block.
+	 ***********************************************************/
+	float EncodeChannelMode(
+		const BLOCK& block,
+		int channel,
+		bool bSixValues,
+		float low,
+		float high,
+		int refitCount,
+		bool bUseSIMD,
+		uint8_t output[8])
+	{
+		const float* weights = (bSixValues == true) ? SIX_VALUE_WEIGHTS : EIGHT_VALUE_WEIGHTS;
+		float start[4] = { (bSixValues == true) ? low : high };
+		float end[4] = { (bSixValues == true) ? high : low };
+
+		float bestError = FLT_MAX;
+		for (int refit = 0; refit <= refitCount; refit++)
+		{
+			int value0 = (int)(start[0] + 0.5f);
+			int value1 = (int)(end[0] + 0.5f);
+			// the order of the endpoints selects the mode, so
+			// equal endpoints are only kept in the six value mode
+			if ((bSixValues == true) ? (value0 > value1) : (value0 < value1))
+			{
+				std::swap(value0, value1);
+			}
+			if ((bSixValues == false) && (value0 == value1))
+			{
+				if (value0 < 255)
+				{
+					value0++;
+				}
+				else
+				{
+					value1--;
+				}
+			}
+
+			int entries[8];
+			BuildChannelPalette(value0, value1, entries);
+			float palette[8][4] = {};
+			for (int p = 0; p < 8; p++)
+			{
+				palette[p][0] = (float)entries[p];
+			}
+
+			uint8_t indices[BLOCK_TEXELS];
+			float error = FindNearestIndices(block, channel, 1, palette, 8, indices, bUseSIMD);
+			if (error < bestError)
+			{
+				bestError = error;
+
+				uint64_t packedIndices = 0;
+				for (int i = 0; i < BLOCK_TEXELS; i++)
+				{
+					packedIndices |= (uint64_t)indices[i] << (i * 3);
+				}
+				output[0] = (uint8_t)value0;
+				output[1] = (uint8_t)value1;
+				for (int i = 0; i < 6; i++)
+				{
+					output[2 + i] = (uint8_t)(packedIndices >> (i * 8));
+				}
+			}
+
+			start[0] = (float)value0;
+			end[0] = (float)value1;
+			if ((bestError == 0.0f) ||
+				(refit == refitCount) ||
+				(RefitEndpoints(block, channel, 1, indices, weights, start, end) == false))
+			{
+				break;
+			}
+		}
+
+		return(bestError);
+	}
+
+	/***********************************************************
+	 *  EncodeChannelBlock()
+	 *
+	 *  Writes the endpoints and the 3-bit indices of a single
+	 *  channel block, the alpha of BC3 or a channel of BC4 and
+	 *  BC5.  The high quality preset also tries the six value
+	 *  mode, which keeps exact 0 and 255 texels.
+	 ***********************************************************/
+	void EncodeChannelBlock(
+		const BLOCK& block,
+		int channel,
+		uint8_t output[8],
+		BlockCompression::QUALITY quality,
+		bool bUseSIMD)
+	{
+		float low = 255.0f;
+		float high = 0.0f;
+		float innerLow = 255.0f;
+		float innerHigh = 0.0f;
+		for (int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			float value = block.channels[channel][i];
+			low = std::min(value, low);
+			high = std::max(value, high);
+			if ((value > 0.0f) && (value < 255.0f))
+			{
+				innerLow = std::min(value, innerLow);
+				innerHigh = std::max(value, innerHigh);
+			}
+		}
+
+		const int refitCount = GetRefitCount(quality);
+		float error = EncodeChannelMode(block, channel, false, low, high, refitCount, bUseSIMD, output);
+		if ((quality == BlockCompression::QUALITY_HIGH) && (error > 0.0f))
+		{
+			if (innerLow > innerHigh)
+			{
+				innerLow = 0.0f;
+				innerHigh = 0.0f;
+			}
+
+			uint8_t sixValues[8];
+			if (EncodeChannelMode(block, channel, true, innerLow, innerHigh, refitCount, bUseSIMD, sixValues) < error)
+			{
+				std::memcpy(output, sixValues, sizeof(sixValues));
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  WriteBits()
+	 *
+	 *  Writes the low bits of a value into a block, from the
+	 *  passed in bit position up.
+	 ***********************************************************/
+	void WriteBits(uint8_t* block, int& position, uint32_t value, int bits)
+	{
+		for (int i = 0; i < bits; i++, position++)
+		{
+			if (((value >> i) & 1) != 0)
+			{
+				block[position / 8] |= (uint8_t)(1 << (position % 8));
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  ReadBits()
+	 *
+	 *  Reads a value from a block, from the passed in bit
+	 *  position up.
+	 ***********************************************************/
+	uint32_t ReadBits(const uint8_t* block, int& position, int bits)
+	{
+		uint32_t value = 0;
+		for (int i = 0; i < bits; i++, position++)
+		{
+			value |= (uint32_t)((block[position / 8] >> (position % 8)) & 1) << i;
+		}
+		return(value);
+	}
+
+	/***********************************************************
+	 *  QuantizeEndpoint()
+	 *
+	 *  Returns the 7-bit channels of a BC7 mode 6 endpoint with
+	 *  a p-bit, and the squared error of the 8-bit endpoint
+	 *  that they make.
+	 ***********************************************************/
+	float QuantizeEndpoint(const float endpoint[4], int pBit, int quantized[4])
+	{
+		float error = 0.0f;
+		for (int c = 0; c < 4; c++)
+		{
+			int value = (int)((endpoint[c] - pBit) / 2.0f + 0.5f);
+			quantized[c] = (value < 0) ? 0 : ((value > 127) ? 127 : value);
+
+			float difference = (float)((quantized[c] << 1) | pBit) - endpoint[c];
+			error += difference * difference;
+		}
+		return(error);
+	}
+
+	/***********************************************************
+	 *  EncodeBC7Block()
+	 *
+	 *  Writes a BC7 block in mode 6 - one line through RGBA
+	 *  with 7-bit endpoints, a p-bit each and 4-bit indices.
+	 *  The normal presets take the p-bit nearest to each
+	 *  endpoint, the high one tries all four pairs.  Opaque
+	 *  blocks always keep an alpha of 255.
+	 ***********************************************************/
+	void EncodeBC7Block(const BLOCK& block, uint8_t output[16], BlockCompression::QUALITY quality, bool bUseSIMD)
+	{
+		float start[4];
+		float end[4];
+		FindPrincipalEndpoints(block, 0, 4, start, end);
+
+		float weights[16];
+		for (int i = 0; i < 16; i++)
+		{
+			weights[i] = BC7_WEIGHTS[i] / 64.0f;
+		}
+
+		float bestError = FLT_MAX;
+		int bestEndpoints[2][4] = {};
+		int bestPBits[2] = {};
+		uint8_t bestIndices[BLOCK_TEXELS] = {};
+
+		const int refitCount = GetRefitCount(quality);
+		for (int refit = 0; refit <= refitCount; refit++)
+		{
+			// the p-bit pairs to try, as bit 0 and bit 1
+			int pairs[4];
+			int pairCount = 0;
+			if (block.bOpaque == true)
+			{
+				pairs[pairCount++] = 3;
+			}
+			else if (quality == BlockCompression::QUALITY_HIGH)
+			{
+				for (int pair = 0; pair < 4; pair++)
+				{
+					pairs[pairCount++] = pair;
+				}
+			}
+			else
+			{
+				int unused[4];
+				int startBit = (QuantizeEndpoint(start, 1, unused) < QuantizeEndpoint(start, 0, unused)) ? 1 : 0;
+				int endBit = (QuantizeEndpoint(end, 1, unused) < QuantizeEndpoint(end, 0, unused)) ? 1 : 0;
+				pairs[pairCount++] = startBit | (endBit << 1);
+			}
+
+			uint8_t refitIndices[BLOCK_TEXELS] = {};
+			float refitError = FLT_MAX;
+			for (int i = 0; i < pairCount; i++)
+			{
+				int pBits[2] = { pairs[i] & 1, pairs[i] >> 1 };
+				int endpoints[2][4];
+				QuantizeEndpoint(start, pBits[0], endpoints[0]);
+				QuantizeEndpoint(end, pBits[1], endpoints[1]);
+
+				float palette[16][4];
+				for (int p = 0; p < 16; p++)
+				{
+					for (int c = 0; c < 4; c++)
+					{
+						int value0 = (endpoints[0][c] << 1) | pBits[0];
+						int value1 = (endpoints[1][c] << 1) | pBits[1];
+						palette[p][c] = (float)(((64 - BC7_WEIGHTS[p]) * value0 + BC7_WEIGHTS[p] * value1 + 32) >> 6);
+					}
+				}
+
+				uint8_t indices[BLOCK_TEXELS];
+				float error = FindNearestIndices(block, 0, 4, palette, 16, indices, bUseSIMD);
+				if (error < refitError)
+				{
+					refitError = error;
+					std::memcpy(refitIndices, indices, sizeof(indices));
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					std::memcpy(bestEndpoints, endpoints, sizeof(endpoints));
+					std::memcpy(bestPBits, pBits, sizeof(pBits));
+					std::memcpy(bestIndices, indices, sizeof(indices));
+				}
+			}
+
+			if ((bestError == 0.0f) ||
+				(refit == refitCount) ||
+				(RefitEndpoints(block, 0, 4, refitIndices, weights, start, end) == false))
+			{
+				break;
+			}
+		}
+
+		// the first texel is the anchor, whose index is stored
+		// without its top bit
+		if (bestIndices[0] >= 8)
+		{
+			std::swap(bestEndpoints[0], bestEndpoints[1]);
+			std::swap(bestPBits[0], bestPBits[1]);
+			for (int i = 0; i < BLOCK_TEXELS; i++)
+			{
+				bestIndices[i] = (uint8_t)(15 - bestIndices[i]);
+			}
+		}
+
+		std::memset(output, 0, 16);
+		int position = 0;
+		WriteBits(output, position, 1 << 6, 7);
+		for (int c = 0; c < 4; c++)
+		{
+			WriteBits(output, position, (uint32_t)bestEndpoints[0][c], 7);
+			WriteBits(output, position, (uint32_t)bestEndpoints[1][c], 7);
+		}
+		WriteBits(output, position, (uint32_t)bestPBits[0], 1);
+		WriteBits(output, position, (uint32_t)bestPBits[1], 1);
+		for (int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			WriteBits(output, position, bestIndices[i], (i == 0) ? 3 : 4);
+		}
+	}
+
+	/***********************************************************
+	 *  DecodeColorBlock()
+	 *
+	 *  Decodes the color part of a BC1 or BC3 block into the
+	 *  RGB of the texels.  The alpha is only written for the
+	 *  transparent entry of the three color palette.
+	 ***********************************************************/
+	void DecodeColorBlock(const uint8_t* block, uint8_t texels[64], bool bFourColors)
+	{
+		uint16_t color0 = (uint16_t)(block[0] | (block[1] << 8));
+		uint16_t color1 = (uint16_t)(block[2] | (block[3] << 8));
+		uint32_t indices = 0;
+		std::memcpy(&indices, block + 4, 4);
+
+		int palette[4][3];
+		BuildColorPalette(color0, color1, bFourColors, palette);
+
+		for (int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			int index = (indices >> (i * 2)) & 3;
+			for (int c = 0; c < 3; c++)
+			{
+				texels[i * 4 + c] = (uint8_t)palette[index][c];
+			}
+			if ((bFourColors == false) && (color0 <= color1) && (index == 3))
+			{
+				texels[i * 4 + 3] = 0;
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  DecodeChannelBlock()
+	 *
+	 *  Decodes a single channel block into one channel of the
+	 *  texels.
+	 ***********************************************************/
+	void DecodeChannelBlock(const uint8_t* block, uint8_t texels[64], int channel)
+	{
+		int palette[8];
+		BuildChannelPalette(block[0], block[1], palette);
+
+		uint64_t indices = 0;
+		for (int i = 0; i < 6; i++)
+		{
+			indices |= (uint64_t)block[2 + i] << (i * 8);
+		}
+		for (int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			texels[i * 4 + channel] = (uint8_t)palette[(indices >> (i * 3)) & 7];
+		}
+	}
+
+	/***********************************************************
+	 *  DecodeBC7Block()
+	 *
+	 *  Decodes a BC7 block.  Only mode 6 is decoded, which is
+	 *  the only mode the encoder writes, the other modes are
+	 *  left black.
+	 ***********************************************************/
+	void DecodeBC7Block(const uint8_t* block, uint8_t texels[64])
+	{
+		int position = 0;
+		if (ReadBits(block, position, 7) != (1 << 6))
+		{
+			return;
+		}
+
+		int endpoints[2][4];
+		for (int c = 0; c < 4; c++)
+		{
+			endpoints[0][c] = (int)ReadBits(block, position, 7);
+			endpoints[1][c] = (int)ReadBits(block, position, 7);
+		}
+		int pBit0 = (int)ReadBits(block, position, 1);
+		int pBit1 = (int)ReadBits(block, position, 1);
+
+		for (int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			int weight = BC7_WEIGHTS[ReadBits(block, position, (i == 0) ? 3 : 4)];
+			for (int c = 0; c < 4; c++)
+			{
+				int value0 = (endpoints[0][c] << 1) | pBit0;
+				int value1 = (endpoints[1][c] << 1) | pBit1;
+				texels[i * 4 + c] = (uint8_t)(((64 - weight) * value0 + weight * value1 + 32) >> 6);
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  GatherBlock()
+	 *
+	 *  Copies the texels of one block of an RGBA image, with
+	 *  the last column and row repeated past the edges.
+	 ***********************************************************/
+	void GatherBlock(const uint8_t* pixels, int width, int height, int blockX, int blockY, uint8_t texels[64])
+	{
+		for (int y = 0; y < 4; y++)
+		{
+			int row = std::min(blockY * 4 + y, height - 1);
+			for (int x = 0; x < 4; x++)
+			{
+				int column = std::min(blockX * 4 + x, width - 1);
+				std::memcpy(&texels[(y * 4 + x) * 4], &pixels[((size_t)row * width + column) * 4], 4);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  EncodeBlock()
+ *
+ *  Encodes one block of texels into a block of a block
+ *  compressed format.  BC3 holds the alpha block first and
+ *  the color block after it, BC5 the red block first and the
+ *  green block after it.
+ ***********************************************************/
+void BlockCompression::EncodeBlock(
+	TEXTURE_FORMAT format,
+	const uint8_t texels[64],
+	uint8_t* block,
+	QUALITY quality,
+	bool bUseSIMD)
+{
+	BLOCK channels;
+	LoadBlock(texels, channels);
+
+	switch (format)
+	{
+	case TEXTURE_FORMAT_BC1:
+		EncodeColorBlock(channels, block, quality, bUseSIMD);
+		break;
+	case TEXTURE_FORMAT_BC3:
+		EncodeChannelBlock(channels, 3, block, quality, bUseSIMD);
+		EncodeColorBlock(channels, block + 8, quality, bUseSIMD);
+		break;
+	case TEXTURE_FORMAT_BC4:
+		EncodeChannelBlock(channels, 0, block, quality, bUseSIMD);
+		break;
+	case TEXTURE_FORMAT_BC5:
+		EncodeChannelBlock(channels, 0, block, quality, bUseSIMD);
+		EncodeChannelBlock(channels, 1, block + 8, quality, bUseSIMD);
+		break;
+	case TEXTURE_FORMAT_BC7:
+		EncodeBC7Block(channels, block, quality, bUseSIMD);
+		break;
+	default:
+		break;
+	}
+}
+
+/***********************************************************
+ *  DecodeBlock()
+ *
+ *  Decodes one block of a block compressed format into 16
+ *  RGBA texels.
+ ***********************************************************/
+void BlockCompression::DecodeBlock(TEXTURE_FORMAT format, const uint8_t* block, uint8_t texels[64])
+{
+	for (int i = 0; i < BLOCK_TEXELS; i++)
+	{
+		texels[i * 4 + 0] = 0;
+		texels[i * 4 + 1] = 0;
+		texels[i * 4 + 2] = 0;
+		texels[i * 4 + 3] = 255;
+	}
+
+	switch (format)
+	{
+	case TEXTURE_FORMAT_BC1:
+		DecodeColorBlock(block, texels, false);
+		break;
+	case TEXTURE_FORMAT_BC3:
+		DecodeChannelBlock(block, texels, 3);
+		DecodeColorBlock(block + 8, texels, true);
+		break;
+	case TEXTURE_FORMAT_BC4:
+		DecodeChannelBlock(block, texels, 0);
+		break;
+	case TEXTURE_FORMAT_BC5:
+		DecodeChannelBlock(block, texels, 0);
+		DecodeChannelBlock(block + 8, texels, 1);
+		break;
+	case TEXTURE_FORMAT_BC7:
+		DecodeBC7Block(block, texels);
+		break;
+	default:
+		break;
+	}
+}
+
+/***********************************************************
+ *  CompressImage()
+ *
+ *  Compresses an RGBA image block by block, in rows of
+ *  blocks from the first row of the image.  The workers take
+ *  the next row of blocks until none is left, so a slow row
+ *  does not hold the others up.
+ ***********************************************************/
+void BlockCompression::CompressImage(
+	TEXTURE_FORMAT format,
+	const uint8_t* pixels,
+	int width,
+	int height,
+	const ENCODE_OPTIONS& options,
+	std::vector<uint8_t>& blocks)
+{
+	const int blockBytes = GetBlockBytes(format);
+	const int blocksWide = (width + 3) / 4;
+	const int blocksHigh = (height + 3) / 4;
+
+	blocks.resize(TextureContainer::GetLevelSize(format, width, height));
+
+	int threadCount = options.threadCount;
+	if (threadCount <= 0)
+	{
+		threadCount = std::max((int)std::thread::hardware_concurrency(), 1);
+	}
+	threadCount = std::min(threadCount, blocksHigh);
+
+	std::atomic<int> nextRow(0);
+	auto encodeRows = [&]()
+	{
+		uint8_t texels[64];
+		for (int blockY = nextRow++; blockY < blocksHigh; blockY = nextRow++)
+		{
+			for (int blockX = 0; blockX < blocksWide; blockX++)
+			{
+				GatherBlock(pixels, width, height, blockX, blockY, texels);
+				uint8_t* block = &blocks[((size_t)blockY * blocksWide + blockX) * blockBytes];
+				EncodeBlock(format, texels, block, options.quality, options.bUseSIMD);
+			}
+		}
+	};
+
+	// the calling thread encodes rows as well
+	std::vector<std::thread> workers;
+	for (int i = 1; i < threadCount; i++)
+	{
+		workers.emplace_back(encodeRows);
+	}
+	encodeRows();
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+/***********************************************************
+ *  DecompressImage()
+ *
+ *  Decompresses the blocks of an image into RGBA texels,
+ *  leaving out the texels past the edges.
+ ***********************************************************/
+void BlockCompression::DecompressImage(
+	TEXTURE_FORMAT format,
+	const std::vector<uint8_t>& blocks,
+	int width,
+	int height,
+	std::vector<uint8_t>& pixels)
+{
+	const int blockBytes = GetBlockBytes(format);
+	const int blocksWide = (width + 3) / 4;
+	const int blocksHigh = (height + 3) / 4;
+
+	pixels.resize((size_t)width * height * 4);
+
+	uint8_t texels[64];
+	for (int blockY = 0; blockY < blocksHigh; blockY++)
+	{
+		for (int blockX = 0; blockX < blocksWide; blockX++)
+		{
+			DecodeBlock(format, &blocks[((size_t)blockY * blocksWide + blockX) * blockBytes], texels);
+			for (int y = 0; (y < 4) && (blockY * 4 + y < height); y++)
+			{
+				for (int x = 0; (x < 4) && (blockX * 4 + x < width); x++)
+				{
+					size_t pixel = ((size_t)(blockY * 4 + y) * width + (blockX * 4 + x)) * 4;
+					std::memcpy(&pixels[pixel], &texels[(y * 4 + x) * 4], 4);
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  MeasurePSNR()
+ *
+ *  Returns the peak signal to noise ratio of the compressed
+ *  image over the channels that its format stores, which is
+ *  infinite when the image is reproduced exactly.
+ ***********************************************************/
+double BlockCompression::MeasurePSNR(
+	TEXTURE_FORMAT format,
+	const uint8_t* pixels,
+	int width,
+	int height,
+	const std::vector<uint8_t>& blocks)
+{
+	std::vector<uint8_t> decoded;
+	DecompressImage(format, blocks, width, height, decoded);
+
+	const int channels = GetStoredChannels(format);
+	double squaredError = 0.0;
+	for (size_t i = 0; i < decoded.size(); i += 4)
+	{
+		for (int c = 0; c < channels; c++)
+		{
+			double difference = (double)decoded[i + c] - (double)pixels[i + c];
+			squaredError += difference * difference;
+		}
+	}
+
+	double meanError = squaredError / ((double)width * height * channels);
+	if (meanError <= 0.0)
+	{
+		return(std::numeric_limits<double>::infinity());
+	}
+	return(10.0 * std::log10(255.0 * 255.0 / meanError));
+}
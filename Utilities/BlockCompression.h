@@ -0,0 +1,83 @@
+///////////////////////////////////////////////////////////////////////////////
+// blockcompression.h
+// ============
+// compress images into the BCn block formats on the CPU
+//
+// Every 4x4 block of texels is encoded on its own.  The endpoints of a block
+// start on the principal axis of its texels, every texel takes the palette
+// entry nearest to it, and the better presets refit the endpoints to the
+// chosen entries by least squares a few times.  The nearest entries are
+// found for four texels at a time with SSE, and the rows of blocks of an
+// image are spread over worker threads.  BC7 is always written in mode 6,
+// one RGBA line with 16 palette entries, which suits the smooth scene
+// textures.  Everything runs on the CPU, so the encoder and its decoder
+// can be used and checked without a GPU.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TextureContainer.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace BlockCompression
+{
+	// how hard the encoder searches for the endpoints
+	enum QUALITY
+	{
+		QUALITY_FAST = 0,		// principal axis endpoints only
+		QUALITY_NORMAL = 1,		// one least squares refit
+		QUALITY_HIGH = 2		// several refits, and every endpoint mode
+	};
+
+	struct ENCODE_OPTIONS
+	{
+		QUALITY quality;
+		// worker threads, 0 for one per core
+		int threadCount;
+		// find the nearest palette entries with SSE
+		bool bUseSIMD;
+	};
+
+	// encode one block of 16 RGBA texels, stored as 4 rows of 4
+	// texels, into a block of a block compressed format - BC1
+	// ignores the alpha, BC4 keeps the red and BC5 the red and
+	// green channel
+	void EncodeBlock(
+		TEXTURE_FORMAT format,
+		const uint8_t texels[64],
+		uint8_t* block,
+		QUALITY quality,
+		bool bUseSIMD);
+	// decode a block the way the GPU samples it, the channels
+	// that a format does not store are 0 and the alpha is 255
+	void DecodeBlock(TEXTURE_FORMAT format, const uint8_t* block, uint8_t texels[64]);
+
+	// compress a whole RGBA image into rows of blocks of a block
+	// compressed format - the blocks past the right and bottom
+	// edges repeat the last column and row of the image
+	void CompressImage(
+		TEXTURE_FORMAT format,
+		const uint8_t* pixels,
+		int width,
+		int height,
+		const ENCODE_OPTIONS& options,
+		std::vector<uint8_t>& blocks);
+	// decompress the blocks of an image back into RGBA texels
+	void DecompressImage(
+		TEXTURE_FORMAT format,
+		const std::vector<uint8_t>& blocks,
+		int width,
+		int height,
+		std::vector<uint8_t>& pixels);
+	// peak signal to noise ratio in dB of the compressed image
+	// against the RGBA image, over the channels that the format
+	// stores
+	double MeasurePSNR(
+		TEXTURE_FORMAT format,
+		const uint8_t* pixels,
+		int width,
+		int height,
+		const std::vector<uint8_t>& blocks);
+}
@@ -0,0 +1,246 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustumculling.cpp
+// ============
+// test the world bounds of objects against the camera frustum
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrustumCulling.h"
+
+#include <xmmintrin.h>
+
+#include <algorithm>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	const int FRUSTUM_PLANES = 6;
+	// number of objects tested by one SSE pass
+	const size_t SIMD_WIDTH = 4;
+
+	/***********************************************************
+	 *  IsOutside()
+	 *
+	 *  Checks one object against one plane.  The box reaches
+	 *  as far towards the plane as its extents projected onto
+	 *  the normal, and whichever of the box and the sphere is
+	 *  smaller along the normal decides.
+	 ***********************************************************/
+	inline bool IsOutside(const glm::vec4& plane, const FrustumCulling::BOUNDS_LIST& bounds, size_t i)
+	{
+		float distance = plane.x * bounds.centerX[i] + plane.y * bounds.centerY[i] + plane.z * bounds.centerZ[i] + plane.w;
+		float boxRadius =
+			std::abs(plane.x) * bounds.extentX[i] +
+			std::abs(plane.y) * bounds.extentY[i] +
+			std::abs(plane.z) * bounds.extentZ[i];
+
+		return(distance < -std::min(boxRadius, bounds.radius[i]));
+	}
+
+	/***********************************************************
+	 *  CullRange()
+	 *
+	 *  Tests the objects from first to last one at a time.
+	 ***********************************************************/
+	size_t CullRange(
+		const FrustumCulling::FRUSTUM& frustum,
+		const FrustumCulling::BOUNDS_LIST& bounds,
+		size_t first,
+		size_t last,
+		std::vector<uint8_t>& visible)
+	{
+		size_t culled = 0;
+
+		for (size_t i = first; i < last; i++)
+		{
+			bool bOutside = false;
+			for (int plane = 0; (plane < FRUSTUM_PLANES) && (bOutside == false); plane++)
+			{
+				bOutside = IsOutside(frustum.planes[plane], bounds, i);
+			}
+
+			visible[i] = (bOutside == true) ? 0 : 1;
+			if (bOutside == true)
+			{
+				culled++;
+			}
+		}
+
+		return(culled);
+	}
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the bounds while
+ *  keeping the memory for the next frame.
+ ***********************************************************/
+void FrustumCulling::BOUNDS_LIST::Clear()
+{
+	centerX.clear();
+	centerY.clear();
+	centerZ.clear();
+	extentX.clear();
+	extentY.clear();
+	extentZ.clear();
+	radius.clear();
+}
+
+/***********************************************************
+ *  Add()
+ *
+ *  This method is used for adding the world bounds of one
+ *  object to the end of the list.
+ ***********************************************************/
+void FrustumCulling::BOUNDS_LIST::Add(const glm::vec3& center, const glm::vec3& extents, float sphereRadius)
+{
+	centerX.push_back(center.x);
+	centerY.push_back(center.y);
+	centerZ.push_back(center.z);
+	extentX.push_back(extents.x);
+	extentY.push_back(extents.y);
+	extentZ.push_back(extents.z);
+	radius.push_back(sphereRadius);
+}
+
+/***********************************************************
+ *  ExtractFrustum()
+ *
+ *  This function is used for getting the frustum planes out
+ *  of the rows of a projection * view matrix.  A point is
+ *  inside when it is between -w and w on every clip axis.
+ ***********************************************************/
+void FrustumCulling::ExtractFrustum(const glm::mat4& viewProjection, FRUSTUM& frustum)
+{
+	// glm matrices are stored by column
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+	{
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	}
+
+	frustum.planes[0] = rows[3] + rows[0];	// left
+	frustum.planes[1] = rows[3] - rows[0];	// right
+	frustum.planes[2] = rows[3] + rows[1];	// bottom
+	frustum.planes[3] = rows[3] - rows[1];	// top
+	frustum.planes[4] = rows[3] + rows[2];	// near
+	frustum.planes[5] = rows[3] - rows[2];	// far
+
+	for (int i = 0; i < FRUSTUM_PLANES; i++)
+	{
+		float length = glm::length(glm::vec3(frustum.planes[i]));
+		if (length > 0.0f)
+		{
+			frustum.planes[i] /= length;
+		}
+	}
+}
+
+/***********************************************************
+ *  TransformBounds()
+ *
+ *  This function is used for moving the local bounds of a
+ *  mesh into the world.  The box extents are rotated with
+ *  the absolute values of the matrix, and the sphere grows
+ *  with the largest scale of the three axes.
+ ***********************************************************/
+void FrustumCulling::TransformBounds(
+	const glm::mat4& model,
+	const glm::vec3& localMin,
+	const glm::vec3& localMax,
+	float localRadius,
+	glm::vec3& center,
+	glm::vec3& extents,
+	float& radius)
+{
+	glm::vec3 localCenter = (localMin + localMax) * 0.5f;
+	glm::vec3 localExtents = (localMax - localMin) * 0.5f;
+	glm::vec3 axisX(model[0]);
+	glm::vec3 axisY(model[1]);
+	glm::vec3 axisZ(model[2]);
+
+	center = glm::vec3(model * glm::vec4(localCenter, 1.0f));
+	extents =
+		glm::abs(axisX) * localExtents.x +
+		glm::abs(axisY) * localExtents.y +
+		glm::abs(axisZ) * localExtents.z;
+	radius = localRadius * std::sqrt(std::max(
+		glm::dot(axisX, axisX),
+		std::max(glm::dot(axisY, axisY), glm::dot(axisZ, axisZ))));
+}
+
+/***********************************************************
+ *  CullBounds()
+ *
+ *  This function is used for testing four objects at a time
+ *  against every plane with SSE.  The objects left over at
+ *  the end are tested one at a time.
+ ***********************************************************/
+size_t FrustumCulling::CullBounds(const FRUSTUM& frustum, const BOUNDS_LIST& bounds, std::vector<uint8_t>& visible)
+{
+	const size_t count = bounds.Size();
+	const size_t simdCount = count - (count % SIMD_WIDTH);
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	size_t culled = 0;
+
+	visible.resize(count);
+
+	for (size_t i = 0; i < simdCount; i += SIMD_WIDTH)
+	{
+		__m128 centerX = _mm_loadu_ps(&bounds.centerX[i]);
+		__m128 centerY = _mm_loadu_ps(&bounds.centerY[i]);
+		__m128 centerZ = _mm_loadu_ps(&bounds.centerZ[i]);
+		__m128 extentX = _mm_loadu_ps(&bounds.extentX[i]);
+		__m128 extentY = _mm_loadu_ps(&bounds.extentY[i]);
+		__m128 extentZ = _mm_loadu_ps(&bounds.extentZ[i]);
+		__m128 radius = _mm_loadu_ps(&bounds.radius[i]);
+		__m128 outside = _mm_setzero_ps();
+
+		for (int plane = 0; plane < FRUSTUM_PLANES; plane++)
+		{
+			const glm::vec4& p = frustum.planes[plane];
+			__m128 normalX = _mm_set1_ps(p.x);
+			__m128 normalY = _mm_set1_ps(p.y);
+			__m128 normalZ = _mm_set1_ps(p.z);
+
+			__m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(normalX, centerX), _mm_mul_ps(normalY, centerY)),
+				_mm_add_ps(_mm_mul_ps(normalZ, centerZ), _mm_set1_ps(p.w)));
+			__m128 boxRadius = _mm_add_ps(
+				_mm_add_ps(
+					_mm_mul_ps(_mm_andnot_ps(signMask, normalX), extentX),
+					_mm_mul_ps(_mm_andnot_ps(signMask, normalY), extentY)),
+				_mm_mul_ps(_mm_andnot_ps(signMask, normalZ), extentZ));
+			__m128 reach = _mm_min_ps(boxRadius, radius);
+
+			// outside when distance < -reach, or distance + reach < 0
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+		}
+
+		int outsideBits = _mm_movemask_ps(outside);
+		for (size_t lane = 0; lane < SIMD_WIDTH; lane++)
+		{
+			uint8_t bOutside = (uint8_t)((outsideBits >> lane) & 1);
+			visible[i + lane] = bOutside ^ 1;
+			culled += bOutside;
+		}
+	}
+
+	culled += CullRange(frustum, bounds, simdCount, count, visible);
+
+	return(culled);
+}
+
+/***********************************************************
+ *  CullBoundsScalar()
+ *
+ *  This function is used for testing the objects one at a
+ *  time, as a reference for the SSE version.
+ ***********************************************************/
+size_t FrustumCulling::CullBoundsScalar(const FRUSTUM& frustum, const BOUNDS_LIST& bounds, std::vector<uint8_t>& visible)
+{
+	visible.resize(bounds.Size());
+
+	return(CullRange(frustum, bounds, 0, bounds.Size(), visible));
+}
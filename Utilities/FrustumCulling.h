@@ -0,0 +1,70 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustumculling.h
+// ============
+// test the world bounds of objects against the camera frustum
+//
+// The bounds of all objects are kept as separate arrays of floats so that
+// the SSE test can load four objects at a time.  An object is culled when
+// its bounding sphere or its box is completely outside of one plane.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace FrustumCulling
+{
+	// the six planes of the camera frustum, normalized, with
+	// the normals pointing into the frustum
+	struct FRUSTUM
+	{
+		glm::vec4 planes[6];
+	};
+
+	// world bounds of any number of objects - every object
+	// has a box given by its center and half extents, and a
+	// sphere around the same center
+	struct BOUNDS_LIST
+	{
+		std::vector<float> centerX;
+		std::vector<float> centerY;
+		std::vector<float> centerZ;
+		std::vector<float> extentX;
+		std::vector<float> extentY;
+		std::vector<float> extentZ;
+		std::vector<float> radius;
+
+		// remove all of the bounds, keeping the memory
+		void Clear();
+		void Add(const glm::vec3& center, const glm::vec3& extents, float sphereRadius);
+		inline size_t Size() const
+		{
+			return(centerX.size());
+		}
+	};
+
+	// get the frustum planes out of a projection * view matrix
+	void ExtractFrustum(const glm::mat4& viewProjection, FRUSTUM& frustum);
+
+	// move local bounds into the world with a model matrix - the
+	// box stays axis aligned and grows to hold the rotated box
+	void TransformBounds(
+		const glm::mat4& model,
+		const glm::vec3& localMin,
+		const glm::vec3& localMax,
+		float localRadius,
+		glm::vec3& center,
+		glm::vec3& extents,
+		float& radius);
+
+	// test all of the bounds against the frustum, visible is set
+	// to 1 for every object that is at least partly inside and 0
+	// for the others - returns the number of culled objects
+	size_t CullBounds(const FRUSTUM& frustum, const BOUNDS_LIST& bounds, std::vector<uint8_t>& visible);
+	// the same test, one object at a time without SSE
+	size_t CullBoundsScalar(const FRUSTUM& frustum, const BOUNDS_LIST& bounds, std::vector<uint8_t>& visible);
+}
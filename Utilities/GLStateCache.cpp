@@ -0,0 +1,459 @@
+///////////////////////////////////////////////////////////////////////////////
+// glstatecache.cpp
+// ============
+// shadow copy of the OpenGL state that drops redundant state changes
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GLStateCache.h"
+
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	// value of a shadowed object binding that is not known
+	const GLuint UNKNOWN_BINDING = 0xFFFFFFFF;
+
+	// texture targets that are shadowed for every texture unit
+	const GLenum g_TextureTargets[] = { GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_CUBE_MAP };
+	const int TEXTURE_TARGET_COUNT = sizeof(g_TextureTargets) / sizeof(g_TextureTargets[0]);
+
+	// number of capabilities that can be shadowed
+	const int MAX_CAPABILITIES = 16;
+
+	struct TEXTURE_UNIT
+	{
+		GLuint textures[TEXTURE_TARGET_COUNT];
+	};
+
+	struct CAPABILITY
+	{
+		GLenum capability;
+		bool bEnabled;
+	};
+
+	// last value sent to a uniform location - a type of zero
+	// means that the value is not known
+	struct UNIFORM_VALUE
+	{
+		GLenum type;
+		GLfloat data[16];
+	};
+
+	GLuint g_Program = UNKNOWN_BINDING;
+	GLuint g_VertexArray = UNKNOWN_BINDING;
+	GLuint g_ActiveUnit = UNKNOWN_BINDING;
+	std::vector<TEXTURE_UNIT> g_TextureUnits;
+	CAPABILITY g_Capabilities[MAX_CAPABILITIES];
+	int g_CapabilityCount = 0;
+
+	// uniform values of every program that has been used, and
+	// the values of the program currently in use
+	std::unordered_map<GLuint, std::vector<UNIFORM_VALUE>> g_ProgramUniforms;
+	std::vector<UNIFORM_VALUE>* g_pUniforms = NULL;
+
+	unsigned int g_IssuedCalls = 0;
+	unsigned int g_ElidedCalls = 0;
+
+	/***********************************************************
+	 *  Changed()
+	 *
+	 *  Counts a shadowed call and returns whether it has to be
+	 *  sent to OpenGL.
+	 ***********************************************************/
+	inline bool Changed(bool bChanged)
+	{
+		if (bChanged == true)
+		{
+			g_IssuedCalls++;
+		}
+		else
+		{
+			g_ElidedCalls++;
+		}
+		return(bChanged);
+	}
+
+	/***********************************************************
+	 *  GetTargetIndex()
+	 *
+	 *  Returns the shadow index of a texture target, or -1 if
+	 *  the target is not shadowed.
+	 ***********************************************************/
+	int GetTargetIndex(GLenum target)
+	{
+		for (int i = 0; i < TEXTURE_TARGET_COUNT; i++)
+		{
+			if (g_TextureTargets[i] == target)
+			{
+				return(i);
+			}
+		}
+		return(-1);
+	}
+
+	/***********************************************************
+	 *  GetTextureUnit()
+	 *
+	 *  Returns the shadow of a texture unit, growing the list
+	 *  of units the first time a unit is used.
+	 ***********************************************************/
+	TEXTURE_UNIT& GetTextureUnit(GLuint unit)
+	{
+		if (unit >= g_TextureUnits.size())
+		{
+			TEXTURE_UNIT unknownUnit;
+			for (int i = 0; i < TEXTURE_TARGET_COUNT; i++)
+			{
+				unknownUnit.textures[i] = UNKNOWN_BINDING;
+			}
+			g_TextureUnits.resize(unit + 1, unknownUnit);
+		}
+		return(g_TextureUnits[unit]);
+	}
+
+	/***********************************************************
+	 *  SetCapability()
+	 *
+	 *  Updates the shadow of a capability and returns whether
+	 *  the state has to be sent to OpenGL.
+	 ***********************************************************/
+	bool SetCapability(GLenum capability, bool bEnabled)
+	{
+		for (int i = 0; i < g_CapabilityCount; i++)
+		{
+			if (g_Capabilities[i].capability == capability)
+			{
+				if (g_Capabilities[i].bEnabled == bEnabled)
+				{
+					return(Changed(false));
+				}
+				g_Capabilities[i].bEnabled = bEnabled;
+				return(Changed(true));
+			}
+		}
+
+		if (g_CapabilityCount < MAX_CAPABILITIES)
+		{
+			g_Capabilities[g_CapabilityCount].capability = capability;
+			g_Capabilities[g_CapabilityCount].bEnabled = bEnabled;
+			g_CapabilityCount++;
+		}
+		return(Changed(true));
+	}
+
+	/***********************************************************
+	 *  SetUniform()
+	 *
+	 *  Updates the shadow of a uniform location of the program
+	 *  in use and returns whether the value has to be sent to
+	 *  OpenGL.  Setting location -1 is a no-op in OpenGL, so
+	 *  it is always dropped.
+	 ***********************************************************/
+	bool SetUniform(GLint location, GLenum type, const void* value, size_t size)
+	{
+		if (location < 0)
+		{
+			return(Changed(false));
+		}
+		if (NULL == g_pUniforms)
+		{
+			return(Changed(true));
+		}
+
+		if ((size_t)location >= g_pUniforms->size())
+		{
+			UNIFORM_VALUE unknownValue = {};
+			g_pUniforms->resize(location + 1, unknownValue);
+		}
+
+		UNIFORM_VALUE& uniform = (*g_pUniforms)[location];
+		if ((uniform.type == type) && (std::memcmp(uniform.data, value, size) == 0))
+		{
+			return(Changed(false));
+		}
+
+		uniform.type = type;
+		std::memcpy(uniform.data, value, size);
+		return(Changed(true));
+	}
+}
+
+/***********************************************************
+ *  Invalidate()
+ *
+ *  Called after OpenGL state was changed without going
+ *  through the cache, so that the next call of every kind
+ *  is sent to OpenGL.
+ ***********************************************************/
+void GLStateCache::Invalidate()
+{
+	g_Program = UNKNOWN_BINDING;
+	g_VertexArray = UNKNOWN_BINDING;
+	g_ActiveUnit = UNKNOWN_BINDING;
+	g_TextureUnits.clear();
+	g_CapabilityCount = 0;
+	g_ProgramUniforms.clear();
+	g_pUniforms = NULL;
+}
+
+/***********************************************************
+ *  UseProgram()
+ *
+ *  Makes the passed in program current.
+ ***********************************************************/
+void GLStateCache::UseProgram(GLuint program)
+{
+	if (Changed(program != g_Program) == true)
+	{
+		glUseProgram(program);
+		g_Program = program;
+		g_pUniforms = &g_ProgramUniforms[program];
+	}
+}
+
+/***********************************************************
+ *  ForgetProgram()
+ *
+ *  Drops the shadowed uniform values of a program before it
+ *  is deleted.  OpenGL may reuse its ID for a new program,
+ *  whose first uniform values must not be compared with the
+ *  values of the deleted one.
+ ***********************************************************/
+void GLStateCache::ForgetProgram(GLuint program)
+{
+	g_ProgramUniforms.erase(program);
+
+	if (program == g_Program)
+	{
+		// the deleted program stays in use until another one is
+		// made current, and the next one must always be sent
+		g_Program = UNKNOWN_BINDING;
+		g_pUniforms = NULL;
+	}
+}
+
+/***********************************************************
+ *  BindVertexArray()
+ *
+ *  Binds the passed in vertex array object.
+ ***********************************************************/
+void GLStateCache::BindVertexArray(GLuint vertexArray)
+{
+	if (Changed(vertexArray != g_VertexArray) == true)
+	{
+		glBindVertexArray(vertexArray);
+		g_VertexArray = vertexArray;
+	}
+}
+
+/***********************************************************
+ *  ActiveTexture()
+ *
+ *  Selects the texture unit that BindTexture() binds into.
+ ***********************************************************/
+void GLStateCache::ActiveTexture(GLuint unit)
+{
+	if (Changed(unit != g_ActiveUnit) == true)
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+		g_ActiveUnit = unit;
+	}
+}
+
+/***********************************************************
+ *  BindTexture()
+ *
+ *  Binds a texture on the active texture unit.
+ ***********************************************************/
+void GLStateCache::BindTexture(GLenum target, GLuint texture)
+{
+	int targetIndex = GetTargetIndex(target);
+
+	// without a known unit or target the call cannot be shadowed
+	if ((g_ActiveUnit == UNKNOWN_BINDING) || (targetIndex < 0))
+	{
+		Changed(true);
+		glBindTexture(target, texture);
+		return;
+	}
+
+	TEXTURE_UNIT& textureUnit = GetTextureUnit(g_ActiveUnit);
+	if (Changed(texture != textureUnit.textures[targetIndex]) == true)
+	{
+		glBindTexture(target, texture);
+		textureUnit.textures[targetIndex] = texture;
+	}
+}
+
+/***********************************************************
+ *  BindTextureUnit()
+ *
+ *  Binds a texture on the passed in texture unit, only
+ *  switching the active unit when the binding changes.
+ ***********************************************************/
+void GLStateCache::BindTextureUnit(GLuint unit, GLenum target, GLuint texture)
+{
+	int targetIndex = GetTargetIndex(target);
+
+	if ((targetIndex >= 0) && (GetTextureUnit(unit).textures[targetIndex] == texture))
+	{
+		Changed(false);
+		return;
+	}
+
+	ActiveTexture(unit);
+	BindTexture(target, texture);
+}
+
+/***********************************************************
+ *  DeleteTextures()
+ *
+ *  Deletes textures - OpenGL unbinds a deleted texture from
+ *  every unit, so the shadow does the same.
+ ***********************************************************/
+void GLStateCache::DeleteTextures(GLsizei count, const GLuint* textures)
+{
+	glDeleteTextures(count, textures);
+
+	for (size_t unit = 0; unit < g_TextureUnits.size(); unit++)
+	{
+		for (int target = 0; target < TEXTURE_TARGET_COUNT; target++)
+		{
+			for (GLsizei i = 0; i < count; i++)
+			{
+				if (g_TextureUnits[unit].textures[target] == textures[i])
+				{
+					g_TextureUnits[unit].textures[target] = 0;
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  Enable()
+ *
+ *  Enables an OpenGL capability.
+ ***********************************************************/
+void GLStateCache::Enable(GLenum capability)
+{
+	if (SetCapability(capability, true) == true)
+	{
+		glEnable(capability);
+	}
+}
+
+/***********************************************************
+ *  Disable()
+ *
+ *  Disables an OpenGL capability.
+ ***********************************************************/
+void GLStateCache::Disable(GLenum capability)
+{
+	if (SetCapability(capability, false) == true)
+	{
+		glDisable(capability);
+	}
+}
+
+/***********************************************************
+ *  SetUniform*()
+ *
+ *  Set a uniform value of the program in use.
+ ***********************************************************/
+void GLStateCache::SetUniform1i(GLint location, GLint value)
+{
+	if (SetUniform(location, GL_INT, &value, sizeof(value)) == true)
+	{
+		glUniform1i(location, value);
+	}
+}
+
+void GLStateCache::SetUniform1f(GLint location, GLfloat value)
+{
+	if (SetUniform(location, GL_FLOAT, &value, sizeof(value)) == true)
+	{
+		glUniform1f(location, value);
+	}
+}
+
+void GLStateCache::SetUniform2fv(GLint location, const GLfloat* value)
+{
+	if (SetUniform(location, GL_FLOAT_VEC2, value, 2 * sizeof(GLfloat)) == true)
+	{
+		glUniform2fv(location, 1, value);
+	}
+}
+
+void GLStateCache::SetUniform3fv(GLint location, const GLfloat* value)
+{
+	if (SetUniform(location, GL_FLOAT_VEC3, value, 3 * sizeof(GLfloat)) == true)
+	{
+		glUniform3fv(location, 1, value);
+	}
+}
+
+void GLStateCache::SetUniform4fv(GLint location, const GLfloat* value)
+{
+	if (SetUniform(location, GL_FLOAT_VEC4, value, 4 * sizeof(GLfloat)) == true)
+	{
+		glUniform4fv(location, 1, value);
+	}
+}
+
+void GLStateCache::SetUniformMatrix2fv(GLint location, const GLfloat* value)
+{
+	if (SetUniform(location, GL_FLOAT_MAT2, value, 4 * sizeof(GLfloat)) == true)
+	{
+		glUniformMatrix2fv(location, 1, GL_FALSE, value);
+	}
+}
+
+void GLStateCache::SetUniformMatrix3fv(GLint location, const GLfloat* value)
+{
+	if (SetUniform(location, GL_FLOAT_MAT3, value, 9 * sizeof(GLfloat)) == true)
+	{
+		glUniformMatrix3fv(location, 1, GL_FALSE, value);
+	}
+}
+
+void GLStateCache::SetUniformMatrix4fv(GLint location, const GLfloat* value)
+{
+	if (SetUniform(location, GL_FLOAT_MAT4, value, 16 * sizeof(GLfloat)) == true)
+	{
+		glUniformMatrix4fv(location, 1, GL_FALSE, value);
+	}
+}
+
+/***********************************************************
+ *  ResetFrameCounters()
+ *
+ *  Called at the start of every frame to reset the counts.
+ ***********************************************************/
+void GLStateCache::ResetFrameCounters()
+{
+	g_IssuedCalls = 0;
+	g_ElidedCalls = 0;
+}
+
+/***********************************************************
+ *  GetIssuedCount()
+ *
+ *  Returns the calls sent to OpenGL since the last reset.
+ ***********************************************************/
+unsigned int GLStateCache::GetIssuedCount()
+{
+	return(g_IssuedCalls);
+}
+
+/***********************************************************
+ *  GetElidedCount()
+ *
+ *  Returns the redundant calls dropped since the last reset.
+ ***********************************************************/
+unsigned int GLStateCache::GetElidedCount()
+{
+	return(g_ElidedCalls);
+}
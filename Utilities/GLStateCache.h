@@ -0,0 +1,55 @@
+///////////////////////////////////////////////////////////////////////////////
+// glstatecache.h
+// ============
+// shadow copy of the OpenGL state that drops redundant state changes
+//
+// Every call routed through here is compared with the last value that was
+// sent to OpenGL and is only issued when the value differs.  Code that
+// changes the same state without going through the cache must call
+// Invalidate() afterwards.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+namespace GLStateCache
+{
+	// forget all of the shadowed state
+	void Invalidate();
+
+	// bound objects
+	void UseProgram(GLuint program);
+	// forget the uniform values of a program that is about to
+	// be deleted, as OpenGL may hand its ID to a new program
+	void ForgetProgram(GLuint program);
+	void BindVertexArray(GLuint vertexArray);
+	void ActiveTexture(GLuint unit);
+	// bind a texture on the active texture unit
+	void BindTexture(GLenum target, GLuint texture);
+	// bind a texture on the passed in texture unit
+	void BindTextureUnit(GLuint unit, GLenum target, GLuint texture);
+	// delete textures and forget where they were bound
+	void DeleteTextures(GLsizei count, const GLuint* textures);
+
+	// enabled capabilities
+	void Enable(GLenum capability);
+	void Disable(GLenum capability);
+
+	// uniform values of the program in use, by location
+	void SetUniform1i(GLint location, GLint value);
+	void SetUniform1f(GLint location, GLfloat value);
+	void SetUniform2fv(GLint location, const GLfloat* value);
+	void SetUniform3fv(GLint location, const GLfloat* value);
+	void SetUniform4fv(GLint location, const GLfloat* value);
+	void SetUniformMatrix2fv(GLint location, const GLfloat* value);
+	void SetUniformMatrix3fv(GLint location, const GLfloat* value);
+	void SetUniformMatrix4fv(GLint location, const GLfloat* value);
+
+	// start counting the calls for a new frame
+	void ResetFrameCounters();
+	// number of calls sent to OpenGL since the last reset
+	unsigned int GetIssuedCount();
+	// number of redundant calls dropped since the last reset
+	unsigned int GetElidedCount();
+}
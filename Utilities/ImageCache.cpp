@@ -0,0 +1,459 @@
+///////////////////////////////////////////////////////////////////////////////
+// imagecache.cpp
+// ============
+// keep the decoded pixels and mipmaps of the scene images on disk
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ImageCache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+// declaration of global variables
+namespace
+{
+	// extension of the cached files
+	const char* const CACHE_FILE_EXTENSION = ".dimg";
+
+	// the primes of the 64-bit xxHash
+	const uint64_t HASH_PRIME_1 = 0x9E3779B185EBCA87ull;
+	const uint64_t HASH_PRIME_2 = 0xC2B2AE3D27D4EB4Full;
+	const uint64_t HASH_PRIME_3 = 0x165667B19E3779F9ull;
+	const uint64_t HASH_PRIME_4 = 0x85EBCA77C2B2AE63ull;
+	const uint64_t HASH_PRIME_5 = 0x27D4EB2F165667C5ull;
+
+	// the options that change the cached pixels, packed
+	// without padding so that they can be hashed
+	struct OPTIONS_KEY
+	{
+		uint32_t version;
+		uint32_t flipVertically;
+		uint32_t filter;
+		uint32_t sRGB;
+		uint32_t preserveCoverage;
+		float coverageReference;
+	};
+
+	inline uint64_t RotateLeft(uint64_t value, int bits)
+	{
+		return((value << bits) | (value >> (64 - bits)));
+	}
+
+	inline uint64_t Read64(const uint8_t* data)
+	{
+		uint64_t value;
+		std::memcpy(&value, data, sizeof(value));
+		return(value);
+	}
+
+	inline uint32_t Read32(const uint8_t* data)
+	{
+		uint32_t value;
+		std::memcpy(&value, data, sizeof(value));
+		return(value);
+	}
+
+	inline uint64_t HashRound(uint64_t accumulator, uint64_t input)
+	{
+		accumulator += input * HASH_PRIME_2;
+		accumulator = RotateLeft(accumulator, 31);
+		return(accumulator * HASH_PRIME_1);
+	}
+
+	inline uint64_t HashMerge(uint64_t hash, uint64_t accumulator)
+	{
+		hash ^= HashRound(0, accumulator);
+		return(hash * HASH_PRIME_1 + HASH_PRIME_4);
+	}
+
+	/***********************************************************
+	 *  GetLevelSizes()
+	 *
+	 *  Gets the size in bytes of the image and of every level
+	 *  below it down to 1x1.  Returns the size of all levels.
+	 ***********************************************************/
+	uint64_t GetLevelSizes(int width, int height, int channels, std::vector<uint64_t>& sizes)
+	{
+		uint64_t total = 0;
+		sizes.clear();
+		while (true)
+		{
+			sizes.push_back((uint64_t)width * (uint64_t)height * (uint64_t)channels);
+			total += sizes.back();
+			if ((width == 1) && (height == 1))
+			{
+				break;
+			}
+			width = (width > 1) ? (width / 2) : 1;
+			height = (height > 1) ? (height / 2) : 1;
+		}
+		return(total);
+	}
+}
+
+/***********************************************************
+ *  ImageCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ImageCache::ImageCache()
+{
+	m_optionsKey = 0;
+}
+
+/***********************************************************
+ *  Enable()
+ *
+ *  This method is used for choosing the cache directory and
+ *  the options that the cached images are decoded with.
+ *  The cached files of other options are never read, they
+ *  have other names.
+ ***********************************************************/
+bool ImageCache::Enable(const char* directory, bool bFlipVertically, const MipmapGenerator::MIPMAP_OPTIONS& options)
+{
+	Disable();
+
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	if (std::filesystem::is_directory(directory, error) == false)
+	{
+		return(false);
+	}
+
+	// the threads and SSE give the same pixels, so they are
+	// not part of the key
+	OPTIONS_KEY key = {};
+	key.version = FILE_VERSION;
+	key.flipVertically = (bFlipVertically == true) ? 1 : 0;
+	key.filter = (uint32_t)options.filter;
+	key.sRGB = (options.bSRGB == true) ? 1 : 0;
+	key.preserveCoverage = (options.bPreserveCoverage == true) ? 1 : 0;
+	key.coverageReference = (options.bPreserveCoverage == true) ? options.coverageReference : 0.0f;
+
+	m_optionsKey = HashContent(&key, sizeof(key), 0);
+	m_directory = directory;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Disable()
+ *
+ *  This method is used for turning the cache off, the
+ *  cached files are kept.
+ ***********************************************************/
+void ImageCache::Disable()
+{
+	m_directory.clear();
+	m_optionsKey = 0;
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for reading the cached image and
+ *  mipmaps of an image file.  The cached file must have
+ *  been written with the same options and must hold the
+ *  full mipmap chain.  It is used right away when the size
+ *  and time of the image match, and after hashing the image
+ *  when only the time differs - its time is then updated so
+ *  the next start does not hash again.
+ ***********************************************************/
+bool ImageCache::Load(
+	const char* filename,
+	SOURCE_STAMP& stamp,
+	int& width,
+	int& height,
+	int& channels,
+	std::vector<uint8_t>& pixels,
+	std::vector<std::vector<uint8_t>>& mipmaps) const
+{
+	if ((GetSourceStamp(filename, stamp) == false) || (IsEnabled() == false))
+	{
+		return(false);
+	}
+
+	std::string cachePath = GetCachePath(filename);
+	std::ifstream file(cachePath, std::ios::binary);
+	if (file.is_open() == false)
+	{
+		return(false);
+	}
+
+	IMAGE_CACHE_HEADER header = {};
+	file.read((char*)&header, sizeof(header));
+	if ((file.good() == false) ||
+		(header.magic != FILE_MAGIC) ||
+		(header.version != FILE_VERSION) ||
+		(header.optionsKey != m_optionsKey) ||
+		(header.sourceSize != stamp.size) ||
+		(header.width == 0) ||
+		(header.height == 0) ||
+		(header.channels < 1) ||
+		(header.channels > 4))
+	{
+		return(false);
+	}
+
+	// a file that was cut short is rewritten
+	std::vector<uint64_t> levelSizes;
+	uint64_t dataSize = GetLevelSizes((int)header.width, (int)header.height, (int)header.channels, levelSizes);
+	std::error_code error;
+	if ((header.levelCount != (uint32_t)levelSizes.size()) ||
+		(std::filesystem::file_size(cachePath, error) != sizeof(header) + dataSize))
+	{
+		return(false);
+	}
+
+	if (header.sourceTime != stamp.time)
+	{
+		std::vector<uint8_t> contents;
+		if ((ReadFile(filename, contents) == false) ||
+			(HashContent(contents.data(), contents.size(), 0) != header.contentHash))
+		{
+			return(false);
+		}
+
+		std::fstream update(cachePath, std::ios::binary | std::ios::in | std::ios::out);
+		update.seekp(offsetof(IMAGE_CACHE_HEADER, sourceTime));
+		update.write((const char*)&stamp.time, sizeof(stamp.time));
+	}
+
+	width = (int)header.width;
+	height = (int)header.height;
+	channels = (int)header.channels;
+	pixels.resize((size_t)levelSizes[0]);
+	file.read((char*)pixels.data(), (std::streamsize)pixels.size());
+	mipmaps.resize(levelSizes.size() - 1);
+	for (size_t i = 0; i < mipmaps.size(); i++)
+	{
+		mipmaps[i].resize((size_t)levelSizes[i + 1]);
+		file.read((char*)mipmaps[i].data(), (std::streamsize)mipmaps[i].size());
+	}
+
+	return(file.good());
+}
+
+/***********************************************************
+ *  Store()
+ *
+ *  This method is used for writing the decoded image and
+ *  mipmaps of an image file into its cached file.  The
+ *  contents are the bytes of the image file that were
+ *  decoded, and the stamp was taken before they were read,
+ *  so an image that changes meanwhile is hashed next time.
+ *  The file is written under another name and renamed, so
+ *  a worker that stops halfway leaves no broken file.
+ ***********************************************************/
+bool ImageCache::Store(
+	const char* filename,
+	const SOURCE_STAMP& stamp,
+	const std::vector<uint8_t>& contents,
+	const uint8_t* pixels,
+	int width,
+	int height,
+	int channels,
+	const std::vector<std::vector<uint8_t>>& mipmaps) const
+{
+	if ((IsEnabled() == false) || (stamp.size != (uint64_t)contents.size()))
+	{
+		return(false);
+	}
+
+	std::vector<uint64_t> levelSizes;
+	GetLevelSizes(width, height, channels, levelSizes);
+	if (levelSizes.size() != mipmaps.size() + 1)
+	{
+		return(false);
+	}
+
+	IMAGE_CACHE_HEADER header = {};
+	header.magic = FILE_MAGIC;
+	header.version = FILE_VERSION;
+	header.optionsKey = m_optionsKey;
+	header.sourceSize = stamp.size;
+	header.sourceTime = stamp.time;
+	header.contentHash = HashContent(contents.data(), contents.size(), 0);
+	header.width = (uint32_t)width;
+	header.height = (uint32_t)height;
+	header.channels = (uint32_t)channels;
+	header.levelCount = (uint32_t)levelSizes.size();
+
+	std::string cachePath = GetCachePath(filename);
+	std::string writePath = cachePath + ".tmp";
+	{
+		std::ofstream file(writePath, std::ios::binary | std::ios::trunc);
+		if (file.is_open() == false)
+		{
+			return(false);
+		}
+
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)pixels, (std::streamsize)levelSizes[0]);
+		for (const std::vector<uint8_t>& mipmap : mipmaps)
+		{
+			file.write((const char*)mipmap.data(), (std::streamsize)mipmap.size());
+		}
+		if (file.good() == false)
+		{
+			file.close();
+			std::error_code error;
+			std::filesystem::remove(writePath, error);
+			return(false);
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(writePath, cachePath, error);
+	if (error)
+	{
+		std::filesystem::remove(writePath, error);
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetSourceStamp()
+ *
+ *  This method is used for getting the size and the time of
+ *  the last change of a file, without reading it.
+ ***********************************************************/
+bool ImageCache::GetSourceStamp(const char* filename, SOURCE_STAMP& stamp)
+{
+	std::error_code error;
+	stamp.size = (uint64_t)std::filesystem::file_size(filename, error);
+	if (error)
+	{
+		return(false);
+	}
+	stamp.time = (int64_t)std::filesystem::last_write_time(filename, error).time_since_epoch().count();
+
+	return(!error);
+}
+
+/***********************************************************
+ *  ReadFile()
+ *
+ *  This method is used for reading a whole file into the
+ *  passed in buffer.
+ ***********************************************************/
+bool ImageCache::ReadFile(const char* filename, std::vector<uint8_t>& contents)
+{
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+	if (file.is_open() == false)
+	{
+		return(false);
+	}
+
+	std::streamoff size = file.tellg();
+	if (size < 0)
+	{
+		return(false);
+	}
+	contents.resize((size_t)size);
+	file.seekg(0);
+	file.read((char*)contents.data(), size);
+
+	return(file.good());
+}
+
+/***********************************************************
+ *  HashContent()
+ *
+ *  This method is used for hashing a block of memory with
+ *  the 64-bit xxHash.  Blocks of 32 bytes are hashed in four
+ *  independent lanes, which keeps the multipliers busy, so
+ *  the image files hash far faster than they are read.
+ ***********************************************************/
+uint64_t ImageCache::HashContent(const void* data, size_t size, uint64_t seed)
+{
+	const uint8_t* input = (const uint8_t*)data;
+	const uint8_t* end = input + size;
+	uint64_t hash = 0;
+
+	if (size >= 32)
+	{
+		uint64_t lanes[4] = {
+			seed + HASH_PRIME_1 + HASH_PRIME_2,
+			seed + HASH_PRIME_2,
+			seed,
+			seed - HASH_PRIME_1 };
+
+		const uint8_t* lastStripe = end - 32;
+		while (input <= lastStripe)
+		{
+			lanes[0] = HashRound(lanes[0], Read64(input));
+			lanes[1] = HashRound(lanes[1], Read64(input + 8));
+			lanes[2] = HashRound(lanes[2], Read64(input + 16));
+			lanes[3] = HashRound(lanes[3], Read64(input + 24));
+			input += 32;
+		}
+
+		hash = RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) + RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18);
+		for (int i = 0; i < 4; i++)
+		{
+			hash = HashMerge(hash, lanes[i]);
+		}
+	}
+	else
+	{
+		hash = seed + HASH_PRIME_5;
+	}
+
+	hash += (uint64_t)size;
+
+	// the tail that does not fill a whole stripe
+	while (input + 8 <= end)
+	{
+		hash ^= HashRound(0, Read64(input));
+		hash = RotateLeft(hash, 27) * HASH_PRIME_1 + HASH_PRIME_4;
+		input += 8;
+	}
+	if (input + 4 <= end)
+	{
+		hash ^= (uint64_t)Read32(input) * HASH_PRIME_1;
+		hash = RotateLeft(hash, 23) * HASH_PRIME_2 + HASH_PRIME_3;
+		input += 4;
+	}
+	while (input < end)
+	{
+		hash ^= (uint64_t)(*input) * HASH_PRIME_5;
+		hash = RotateLeft(hash, 11) * HASH_PRIME_1;
+		input++;
+	}
+
+	// mix the bits so that every input bit reaches every
+	// output bit
+	hash ^= hash >> 33;
+	hash *= HASH_PRIME_2;
+	hash ^= hash >> 29;
+	hash *= HASH_PRIME_3;
+	hash ^= hash >> 32;
+
+	return(hash);
+}
+
+/***********************************************************
+ *  GetCachePath()
+ *
+ *  This method is used for getting the path of the cached
+ *  file of an image file, named after the hash of the full
+ *  path of the image and of the options.
+ ***********************************************************/
+std::string ImageCache::GetCachePath(const char* filename) const
+{
+	std::error_code error;
+	std::filesystem::path imagePath = std::filesystem::absolute(filename, error);
+	std::string imageName = imagePath.lexically_normal().generic_string();
+
+	std::ostringstream name;
+	name << std::hex << std::setw(16) << std::setfill('0')
+		<< HashContent(imageName.data(), imageName.size(), m_optionsKey) << CACHE_FILE_EXTENSION;
+
+	return((std::filesystem::path(m_directory) / name.str()).string());
+}
@@ -0,0 +1,119 @@
+///////////////////////////////////////////////////////////////////////////////
+// imagecache.h
+// ============
+// keep the decoded pixels and mipmaps of the scene images on disk
+//
+// Decoding the JPEG and PNG images is most of the work of loading the scene,
+// and it gives the same pixels every run as long as the images do not
+// change.  The cache stores the decoded image and its mipmap chain in one
+// file per image, named after the path of the image and the options that it
+// was decoded with.  A cached file is trusted when the size and the
+// modification time of the image still match.  When only the time differs,
+// the image is hashed and compared with the content hash that was stored, so
+// touching or checking out an unchanged image does not throw its file away.
+// The cache does not depend on OpenGL.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MipmapGenerator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// start of every cached file, the levels follow it back to
+// back with tightly packed rows
+struct IMAGE_CACHE_HEADER
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t optionsKey;
+	uint64_t sourceSize;
+	int64_t sourceTime;
+	uint64_t contentHash;
+	uint32_t width;
+	uint32_t height;
+	uint32_t channels;
+	uint32_t levelCount;
+};
+
+static_assert(sizeof(IMAGE_CACHE_HEADER) == 56, "IMAGE_CACHE_HEADER must match the file layout");
+
+/***********************************************************
+ *  ImageCache
+ *
+ *  This class looks up and stores the decoded images in the
+ *  cache directory.  It is only read after it has been
+ *  enabled, so the decode workers can share it.
+ ***********************************************************/
+class ImageCache
+{
+public:
+	// "DIMG" read as a little endian integer
+	static constexpr uint32_t FILE_MAGIC = 0x474D4944;
+	static constexpr uint32_t FILE_VERSION = 1;
+
+	// size and modification time of an image file, which are
+	// compared before anything is hashed
+	struct SOURCE_STAMP
+	{
+		uint64_t size;
+		int64_t time;
+	};
+
+	// constructor
+	ImageCache();
+
+	// use the passed in directory, created when missing, for
+	// images that are decoded and mipmapped with the passed in
+	// options - returns false when the directory is not usable
+	bool Enable(const char* directory, bool bFlipVertically, const MipmapGenerator::MIPMAP_OPTIONS& options);
+	void Disable();
+
+	inline bool IsEnabled() const
+	{
+		return(m_directory.empty() == false);
+	}
+
+	// read the cached image and mipmaps of an image file -
+	// returns false when there is no cached file or it is out
+	// of date, the stamp of the image is filled in either way
+	bool Load(
+		const char* filename,
+		SOURCE_STAMP& stamp,
+		int& width,
+		int& height,
+		int& channels,
+		std::vector<uint8_t>& pixels,
+		std::vector<std::vector<uint8_t>>& mipmaps) const;
+	// write the decoded image and mipmaps of an image file,
+	// with the stamp taken before its contents were read
+	bool Store(
+		const char* filename,
+		const SOURCE_STAMP& stamp,
+		const std::vector<uint8_t>& contents,
+		const uint8_t* pixels,
+		int width,
+		int height,
+		int channels,
+		const std::vector<std::vector<uint8_t>>& mipmaps) const;
+
+	// get the size and modification time of a file
+	static bool GetSourceStamp(const char* filename, SOURCE_STAMP& stamp);
+	// read a whole file into memory
+	static bool ReadFile(const char* filename, std::vector<uint8_t>& contents);
+	// 64-bit xxHash of a block of memory
+	static uint64_t HashContent(const void* data, size_t size, uint64_t seed);
+
+private:
+	// the cache directory, empty while the cache is disabled
+	std::string m_directory;
+	// hash of the decode and mipmap options that change the
+	// cached pixels
+	uint64_t m_optionsKey;
+
+	// path of the cached file of an image file
+	std::string GetCachePath(const char* filename) const;
+};
@@ -0,0 +1,605 @@
+///////////////////////////////////////////////////////////////////////////////
+// mipmapgenerator.cpp
+// ============
+// build the mipmap chain of an image on the CPU
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MipmapGenerator.h"
+
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <thread>
+
+// the AVX2 code is compiled for AVX2 whatever the build
+// targets, and is only called once the CPU was found to have it
+#if defined(_MSC_VER)
+#define AVX2_FUNCTION
+#else
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+
+namespace
+{
+	// rows of the next level that a worker takes at least, so
+	// the small levels are not split over threads
+	const int MIN_ROWS_PER_THREAD = 16;
+	// support of the Kaiser filter in texels of the next level
+	// to either side, and the shape of its window
+	const double KAISER_WIDTH = 3.0;
+	const double KAISER_ALPHA = 4.0;
+	// entries of the table from linear light to sRGB - fine
+	// enough that the dark values round the same as the exact
+	// conversion
+	const int LINEAR_TABLE_SIZE = 65536;
+	const double PI = 3.14159265358979323846;
+
+	// the taps of a filter along one axis - the source texel and
+	// the weight of every tap of every target texel, with the
+	// source texels clamped to the edges
+	struct FILTER_TAPS
+	{
+		int tapCount;
+		std::vector<int> sources;
+		std::vector<float> weights;
+	};
+
+	// conversion of the 8-bit values to the floats that the
+	// filters work in and back, for the sRGB encoded channels
+	// and for the channels that are stored linear
+	struct COLOR_TABLES
+	{
+		float fromSRGB[256];
+		float fromUnorm[256];
+		uint8_t toSRGB[LINEAR_TABLE_SIZE];
+		uint8_t toUnorm[LINEAR_TABLE_SIZE];
+	};
+
+	// the channels of one level as the filters see them, with
+	// the tables that convert every channel
+	struct LEVEL_LAYOUT
+	{
+		int channels;
+		const float* decodeTables[4];
+		const uint8_t* encodeTables[4];
+	};
+
+	/***********************************************************
+	 *  BuildColorTables()
+	 *
+	 *  Returns the tables of the sRGB transfer function and its
+	 *  inverse, and of the plain conversion to and from floats.
+	 ***********************************************************/
+	COLOR_TABLES BuildColorTables()
+	{
+		COLOR_TABLES tables;
+
+		for (int i = 0; i < 256; i++)
+		{
+			double value = i / 255.0;
+			tables.fromUnorm[i] = (float)value;
+			value = (value <= 0.04045) ? (value / 12.92) : std::pow((value + 0.055) / 1.055, 2.4);
+			tables.fromSRGB[i] = (float)value;
+		}
+		for (int i = 0; i < LINEAR_TABLE_SIZE; i++)
+		{
+			double value = i / (double)(LINEAR_TABLE_SIZE - 1);
+			tables.toUnorm[i] = (uint8_t)(value * 255.0 + 0.5);
+			value = (value <= 0.0031308) ? (value * 12.92) : (1.055 * std::pow(value, 1.0 / 2.4) - 0.055);
+			tables.toSRGB[i] = (uint8_t)(value * 255.0 + 0.5);
+		}
+
+		return(tables);
+	}
+
+	/***********************************************************
+	 *  GetColorTables()
+	 *
+	 *  Returns the sRGB tables, which are built on first use.
+	 ***********************************************************/
+	const COLOR_TABLES& GetColorTables()
+	{
+		static const COLOR_TABLES tables = BuildColorTables();
+		return(tables);
+	}
+
+	/***********************************************************
+	 *  BesselI0()
+	 *
+	 *  Returns the modified Bessel function of the first kind
+	 *  of order 0, which shapes the Kaiser window.
+	 ***********************************************************/
+	double BesselI0(double x)
+	{
+		double sum = 1.0;
+		double term = 1.0;
+		for (int k = 1; k < 64; k++)
+		{
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+			if (term < sum * 1e-12)
+			{
+				break;
+			}
+		}
+		return(sum);
+	}
+
+	/***********************************************************
+	 *  EvaluateKaiser()
+	 *
+	 *  Returns the Kaiser windowed sinc at a distance in texels
+	 *  of the next level.
+	 ***********************************************************/
+	double EvaluateKaiser(double distance)
+	{
+		double ratio = distance / KAISER_WIDTH;
+		if (std::fabs(ratio) >= 1.0)
+		{
+			return(0.0);
+		}
+
+		double sinc = (std::fabs(distance) < 1e-9) ? 1.0 : (std::sin(PI * distance) / (PI * distance));
+		return(sinc * BesselI0(KAISER_ALPHA * std::sqrt(1.0 - ratio * ratio)) / BesselI0(KAISER_ALPHA));
+	}
+
+	/***********************************************************
+	 *  BuildTaps()
+	 *
+	 *  Builds the taps that reduce one axis of a level to the
+	 *  passed in size.  Every target texel covers the same
+	 *  share of the source, so odd sizes are filtered without
+	 *  dropping the last row or column.  The weights of every
+	 *  target texel add up to 1.
+	 ***********************************************************/
+	FILTER_TAPS BuildTaps(int sourceSize, int targetSize, MipmapGenerator::FILTER filter)
+	{
+		const double scale = (double)sourceSize / targetSize;
+		const double radius = (filter == MipmapGenerator::FILTER_BOX) ? (scale / 2.0) : (KAISER_WIDTH * scale);
+
+		FILTER_TAPS taps;
+		taps.tapCount = 1;
+		for (int x = 0; x < targetSize; x++)
+		{
+			double center = (x + 0.5) * scale;
+			int first = (int)std::floor(center - radius);
+			int last = (int)std::ceil(center + radius) - 1;
+			taps.tapCount = std::max(last - first + 1, taps.tapCount);
+		}
+
+		taps.sources.resize((size_t)targetSize * taps.tapCount);
+		taps.weights.resize((size_t)targetSize * taps.tapCount);
+		for (int x = 0; x < targetSize; x++)
+		{
+			double center = (x + 0.5) * scale;
+			int first = (int)std::floor(center - radius);
+			std::vector<double> weights(taps.tapCount);
+			double sum = 0.0;
+
+			for (int t = 0; t < taps.tapCount; t++)
+			{
+				int source = first + t;
+				if (filter == MipmapGenerator::FILTER_BOX)
+				{
+					double covered = std::min(source + 1.0, center + radius) - std::max((double)source, center - radius);
+					weights[t] = std::max(covered, 0.0);
+				}
+				else
+				{
+					weights[t] = EvaluateKaiser((source + 0.5 - center) / scale);
+				}
+				sum += weights[t];
+
+				taps.sources[(size_t)x * taps.tapCount + t] = std::min(std::max(source, 0), sourceSize - 1);
+			}
+
+			for (int t = 0; t < taps.tapCount; t++)
+			{
+				taps.weights[(size_t)x * taps.tapCount + t] = (float)((sum != 0.0) ? (weights[t] / sum) : 0.0);
+			}
+		}
+
+		return(taps);
+	}
+
+	/***********************************************************
+	 *  DecodeRow()
+	 *
+	 *  Converts a row of 8-bit texels into linear RGBA floats,
+	 *  four per texel whatever the number of channels.
+	 ***********************************************************/
+	void DecodeRow(const uint8_t* source, int width, const LEVEL_LAYOUT& layout, float* target)
+	{
+		const int channels = layout.channels;
+		for (int x = 0; x < width; x++)
+		{
+			const uint8_t* texel = source + (size_t)x * channels;
+			float* decoded = target + (size_t)x * 4;
+			decoded[3] = 0.0f;
+			for (int c = 0; c < channels; c++)
+			{
+				decoded[c] = layout.decodeTables[c][texel[c]];
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  EncodeRow()
+	 *
+	 *  Converts a row of linear RGBA floats back into 8-bit
+	 *  texels of the number of channels of the level.
+	 ***********************************************************/
+	void EncodeRow(const float* source, int width, const LEVEL_LAYOUT& layout, bool bUseSIMD, uint8_t* target)
+	{
+		const int channels = layout.channels;
+		const float tableScale = (float)(LINEAR_TABLE_SIZE - 1);
+		for (int x = 0; x < width; x++)
+		{
+			// the index into the tables of every channel
+			alignas(16) int indices[4];
+			if (bUseSIMD == true)
+			{
+				__m128 texel = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(source + (size_t)x * 4), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+				_mm_store_si128((__m128i*)indices, _mm_cvttps_epi32(
+					_mm_add_ps(_mm_mul_ps(texel, _mm_set1_ps(tableScale)), _mm_set1_ps(0.5f))));
+			}
+			else
+			{
+				for (int c = 0; c < 4; c++)
+				{
+					float value = std::min(std::max(source[(size_t)x * 4 + c], 0.0f), 1.0f);
+					indices[c] = (int)(value * tableScale + 0.5f);
+				}
+			}
+
+			uint8_t* texel = target + (size_t)x * channels;
+			for (int c = 0; c < channels; c++)
+			{
+				texel[c] = layout.encodeTables[c][indices[c]];
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  FilterRow()
+	 *
+	 *  Reduces a row of linear RGBA floats along its length,
+	 *  one texel of four channels per SSE register.
+	 ***********************************************************/
+	void FilterRow(const float* source, const FILTER_TAPS& taps, int targetWidth, bool bUseSIMD, float* target)
+	{
+		for (int x = 0; x < targetWidth; x++)
+		{
+			const int* sources = &taps.sources[(size_t)x * taps.tapCount];
+			const float* weights = &taps.weights[(size_t)x * taps.tapCount];
+			if (bUseSIMD == true)
+			{
+				__m128 sum = _mm_setzero_ps();
+				for (int t = 0; t < taps.tapCount; t++)
+				{
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(source + (size_t)sources[t] * 4)));
+				}
+				_mm_storeu_ps(target + (size_t)x * 4, sum);
+			}
+			else
+			{
+				for (int c = 0; c < 4; c++)
+				{
+					float sum = 0.0f;
+					for (int t = 0; t < taps.tapCount; t++)
+					{
+						sum += weights[t] * source[(size_t)sources[t] * 4 + c];
+					}
+					target[(size_t)x * 4 + c] = sum;
+				}
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  FilterColumnsAVX2()
+	 *
+	 *  Combines the filtered rows eight floats at a time, and
+	 *  returns the number of floats that were done.  The sums
+	 *  are built in the same order as with SSE, so both give
+	 *  the same result.
+	 ***********************************************************/
+	AVX2_FUNCTION int FilterColumnsAVX2(const float* const* rows, const float* weights, int tapCount, int count, float* target)
+	{
+		int i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 sum = _mm256_setzero_ps();
+			for (int t = 0; t < tapCount; t++)
+			{
+				sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[t]), _mm256_loadu_ps(rows[t] + i)));
+			}
+			_mm256_storeu_ps(target + i, sum);
+		}
+		_mm256_zeroupper();
+
+		return(i);
+	}
+
+	/***********************************************************
+	 *  FilterColumns()
+	 *
+	 *  Combines the filtered rows that one row of the next
+	 *  level covers, eight floats at a time with AVX2 and four
+	 *  at a time with SSE.
+	 ***********************************************************/
+	void FilterColumns(const float* const* rows, const float* weights, int tapCount, int count, bool bUseSIMD, bool bUseAVX2, float* target)
+	{
+		int i = 0;
+		if (bUseAVX2 == true)
+		{
+			i = FilterColumnsAVX2(rows, weights, tapCount, count, target);
+		}
+		if (bUseSIMD == true)
+		{
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128 sum = _mm_setzero_ps();
+				for (int t = 0; t < tapCount; t++)
+				{
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(rows[t] + i)));
+				}
+				_mm_storeu_ps(target + i, sum);
+			}
+		}
+
+		for (; i < count; i++)
+		{
+			float sum = 0.0f;
+			for (int t = 0; t < tapCount; t++)
+			{
+				sum += weights[t] * rows[t][i];
+			}
+			target[i] = sum;
+		}
+	}
+
+	/***********************************************************
+	 *  ReduceRows()
+	 *
+	 *  Filters a run of rows of the next level out of a level.
+	 *  Every source row is decoded and filtered along its
+	 *  length once into a ring of rows, which holds every row
+	 *  that one target row covers.
+	 ***********************************************************/
+	void ReduceRows(
+		const uint8_t* source,
+		int sourceWidth,
+		uint8_t* target,
+		int targetWidth,
+		const LEVEL_LAYOUT& layout,
+		const FILTER_TAPS& horizontal,
+		const FILTER_TAPS& vertical,
+		bool bUseSIMD,
+		bool bUseAVX2,
+		int firstRow,
+		int endRow)
+	{
+		const size_t rowFloats = (size_t)targetWidth * 4;
+		const int ringSize = vertical.tapCount;
+
+		std::vector<float> decoded((size_t)sourceWidth * 4);
+		std::vector<float> ring(ringSize * rowFloats);
+		std::vector<int> ringRows(ringSize, -1);
+		std::vector<const float*> rows(vertical.tapCount);
+		std::vector<float> filtered(rowFloats);
+
+		for (int y = firstRow; y < endRow; y++)
+		{
+			for (int t = 0; t < vertical.tapCount; t++)
+			{
+				int sourceRow = vertical.sources[(size_t)y * vertical.tapCount + t];
+				int slot = sourceRow % ringSize;
+				if (ringRows[slot] != sourceRow)
+				{
+					DecodeRow(source + (size_t)sourceRow * sourceWidth * layout.channels, sourceWidth, layout, decoded.data());
+					FilterRow(decoded.data(), horizontal, targetWidth, bUseSIMD, &ring[slot * rowFloats]);
+					ringRows[slot] = sourceRow;
+				}
+				rows[t] = &ring[slot * rowFloats];
+			}
+
+			FilterColumns(rows.data(), &vertical.weights[(size_t)y * vertical.tapCount], vertical.tapCount,
+				(int)rowFloats, bUseSIMD, bUseAVX2, filtered.data());
+			EncodeRow(filtered.data(), targetWidth, layout, bUseSIMD, target + (size_t)y * targetWidth * layout.channels);
+		}
+	}
+
+	/***********************************************************
+	 *  MeasureCoverage()
+	 *
+	 *  Returns the share of the texels of a level whose alpha,
+	 *  scaled, is above the reference.
+	 ***********************************************************/
+	double MeasureCoverage(const uint8_t* level, size_t texels, int channels, float scale, float reference)
+	{
+		size_t covered = 0;
+		for (size_t i = 0; i < texels; i++)
+		{
+			if (level[i * channels + channels - 1] * scale > reference * 255.0f)
+			{
+				covered++;
+			}
+		}
+		return((double)covered / (double)texels);
+	}
+
+	/***********************************************************
+	 *  PreserveCoverage()
+	 *
+	 *  Scales the alpha of a level so that the share of its
+	 *  texels above the reference comes nearest to the passed
+	 *  in share, found by bisecting the scale.
+	 ***********************************************************/
+	void PreserveCoverage(std::vector<uint8_t>& level, int channels, float reference, double coverage)
+	{
+		float low = 0.0f;
+		float high = 4.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			float middle = (low + high) / 2.0f;
+			if (MeasureCoverage(level.data(), level.size() / channels, channels, middle, reference) < coverage)
+			{
+				low = middle;
+			}
+			else
+			{
+				high = middle;
+			}
+		}
+
+		// the share only changes in steps, so the side of the last
+		// step that is nearer to it is taken
+		const double lowCoverage = MeasureCoverage(level.data(), level.size() / channels, channels, low, reference);
+		const double highCoverage = MeasureCoverage(level.data(), level.size() / channels, channels, high, reference);
+		const float scale = (std::fabs(lowCoverage - coverage) < std::fabs(highCoverage - coverage)) ? low : high;
+		for (size_t i = channels - 1; i < level.size(); i += channels)
+		{
+			level[i] = (uint8_t)std::min(level[i] * scale + 0.5f, 255.0f);
+		}
+	}
+}
+
+/***********************************************************
+ *  GenerateMipmaps()
+ *
+ *  Builds the levels below an image, every one filtered out
+ *  of the level above it.  The rows of a level are split
+ *  into one run per worker, and the calling thread filters
+ *  the first run.
+ ***********************************************************/
+void MipmapGenerator::GenerateMipmaps(
+	const uint8_t* pixels,
+	int width,
+	int height,
+	int channels,
+	const MIPMAP_OPTIONS& options,
+	std::vector<std::vector<uint8_t>>& levels)
+{
+	levels.clear();
+	if ((NULL == pixels) || (channels < 1) || (channels > 4))
+	{
+		return;
+	}
+
+	// the alpha of 2 and 4 channel images is never sRGB encoded
+	const COLOR_TABLES& tables = GetColorTables();
+	const int colorChannels = ((channels == 2) || (channels == 4)) ? (channels - 1) : channels;
+	const bool bCoverage = (options.bPreserveCoverage == true) && (colorChannels < channels);
+
+	LEVEL_LAYOUT layout = {};
+	layout.channels = channels;
+	for (int c = 0; c < channels; c++)
+	{
+		bool bEncoded = (options.bSRGB == true) && (c < colorChannels);
+		layout.decodeTables[c] = (bEncoded == true) ? tables.fromSRGB : tables.fromUnorm;
+		layout.encodeTables[c] = (bEncoded == true) ? tables.toSRGB : tables.toUnorm;
+	}
+
+	const bool bUseAVX2 = (options.bUseSIMD == true) && (options.bUseAVX2 == true) && (IsAVX2Supported() == true);
+	int threadCount = options.threadCount;
+	if (threadCount <= 0)
+	{
+		threadCount = std::max((int)std::thread::hardware_concurrency(), 1);
+	}
+
+	double coverage = 0.0;
+	if (bCoverage == true)
+	{
+		coverage = MeasureCoverage(pixels, (size_t)width * height, channels, 1.0f, options.coverageReference);
+	}
+
+	// the levels are filtered out of each other, so they must
+	// not move while the chain is built
+	int levelCount = 0;
+	for (int size = std::max(width, height); size > 1; size /= 2)
+	{
+		levelCount++;
+	}
+	levels.reserve(levelCount);
+
+	const uint8_t* source = pixels;
+	int sourceWidth = width;
+	int sourceHeight = height;
+	while ((sourceWidth > 1) || (sourceHeight > 1))
+	{
+		const int targetWidth = (sourceWidth > 1) ? (sourceWidth / 2) : 1;
+		const int targetHeight = (sourceHeight > 1) ? (sourceHeight / 2) : 1;
+		const FILTER_TAPS horizontal = BuildTaps(sourceWidth, targetWidth, options.filter);
+		const FILTER_TAPS vertical = BuildTaps(sourceHeight, targetHeight, options.filter);
+
+		levels.emplace_back((size_t)targetWidth * targetHeight * channels);
+		uint8_t* target = levels.back().data();
+
+		const int workers = std::max(std::min(threadCount, targetHeight / MIN_ROWS_PER_THREAD), 1);
+		std::vector<std::thread> threads;
+		for (int i = 1; i < workers; i++)
+		{
+			threads.emplace_back(ReduceRows, source, sourceWidth, target, targetWidth, std::cref(layout),
+				std::cref(horizontal), std::cref(vertical), options.bUseSIMD, bUseAVX2,
+				targetHeight * i / workers, targetHeight * (i + 1) / workers);
+		}
+		ReduceRows(source, sourceWidth, target, targetWidth, layout, horizontal, vertical, options.bUseSIMD, bUseAVX2,
+			0, targetHeight / workers);
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		if (bCoverage == true)
+		{
+			PreserveCoverage(levels.back(), channels, options.coverageReference, coverage);
+		}
+
+		source = levels.back().data();
+		sourceWidth = targetWidth;
+		sourceHeight = targetHeight;
+	}
+}
+
+/***********************************************************
+ *  IsAVX2Supported()
+ *
+ *  Checks once whether the CPU has AVX2 and the operating
+ *  system saves the AVX registers on a thread switch.
+ ***********************************************************/
+bool MipmapGenerator::IsAVX2Supported()
+{
+	static const bool bSupported = []()
+	{
+#if defined(_MSC_VER)
+		int info[4] = {};
+		__cpuid(info, 0);
+		if (info[0] < 7)
+		{
+			return(false);
+		}
+		// the AVX registers must be enabled by the system
+		__cpuid(info, 1);
+		const int OSXSAVE_BIT = 1 << 27;
+		const int AVX_BIT = 1 << 28;
+		if (((info[2] & OSXSAVE_BIT) == 0) || ((info[2] & AVX_BIT) == 0) || ((_xgetbv(0) & 6) != 6))
+		{
+			return(false);
+		}
+		__cpuidex(info, 7, 0);
+		const int AVX2_BIT = 1 << 5;
+		return((info[1] & AVX2_BIT) != 0);
+#else
+		return(__builtin_cpu_supports("avx2") != 0);
+#endif
+	}();
+
+	return(bSupported);
+}
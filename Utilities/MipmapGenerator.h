@@ -0,0 +1,63 @@
+///////////////////////////////////////////////////////////////////////////////
+// mipmapgenerator.h
+// ============
+// build the mipmap chain of an image on the CPU
+//
+// Every level is filtered from the one above it with a separable filter,
+// either a 2x2 box or a Kaiser windowed sinc that keeps the smaller levels
+// sharper.  The color channels are filtered in linear light and written
+// back sRGB encoded, so bright and dark texels average to the brightness
+// the eye sees instead of darkening as the driver's mipmaps do.  The alpha
+// of RGBA images can be rescaled per level to keep the share of texels that
+// pass an alpha test.  The filters run four channels at a time with SSE,
+// the vertical pass eight at a time on CPUs that have AVX2, and the rows of
+// a level are spread over worker threads.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace MipmapGenerator
+{
+	// filter that every level is reduced with
+	enum FILTER
+	{
+		FILTER_BOX = 0,			// average of the covered texels
+		FILTER_KAISER = 1		// Kaiser windowed sinc, sharper
+	};
+
+	struct MIPMAP_OPTIONS
+	{
+		FILTER filter;
+		// the color channels are sRGB encoded, and are filtered
+		// in linear light
+		bool bSRGB;
+		// rescale the alpha of every level so that the same share
+		// of texels has an alpha above the reference as in the
+		// image - only used for images with alpha
+		bool bPreserveCoverage;
+		float coverageReference;
+		// worker threads, 0 for one per core
+		int threadCount;
+		// filter with SSE, or one channel at a time, and with
+		// AVX2 where it helps when the CPU has it
+		bool bUseSIMD;
+		bool bUseAVX2;
+	};
+
+	// build the levels below an image down to 1x1, each half the
+	// size of the one above it rounded down - the image has 1 to
+	// 4 channels of 8 bits with tightly packed rows, and 2 or 4
+	// channels have the alpha last
+	void GenerateMipmaps(
+		const uint8_t* pixels,
+		int width,
+		int height,
+		int channels,
+		const MIPMAP_OPTIONS& options,
+		std::vector<std::vector<uint8_t>>& levels);
+	// whether the CPU and the system support AVX2
+	bool IsAVX2Supported();
+}
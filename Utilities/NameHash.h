@@ -0,0 +1,42 @@
+///////////////////////////////////////////////////////////////////////////////
+// namehash.h
+// ============
+// compile-time hashing of names used to look up shader uniforms, textures
+// and materials without building or comparing strings at runtime
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// 32-bit FNV-1a hash of a name - usable in constant expressions
+constexpr uint32_t HashName(std::string_view name)
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < name.length(); i++)
+	{
+		hash ^= (uint8_t)name[i];
+		hash *= 16777619u;
+	}
+	return(hash);
+}
+
+/***********************************************************
+ *  NameID
+ *
+ *  A name together with its precomputed hash.  Declaring a
+ *  NameID as constexpr from a string literal computes the
+ *  hash at compile time, so looking it up costs no string
+ *  construction and no hashing while rendering.
+ ***********************************************************/
+struct NameID
+{
+	uint32_t hash;
+	std::string_view name;
+
+	explicit constexpr NameID(std::string_view text)
+		: hash(HashName(text)), name(text)
+	{
+	}
+};
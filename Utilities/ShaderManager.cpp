@@ -14,6 +14,28 @@ using namespace std;
 
 #include "ShaderManager.h"
 
+/***********************************************************
+ *  ~ShaderManager()
+ *
+ *  The destructor for the class - the buffers behind the
+ *  shared uniform blocks and the material storage block are
+ *  deleted here.
+ ***********************************************************/
+ShaderManager::~ShaderManager()
+{
+	GLuint buffers[] = { m_frameDataBuffer, m_lightBlockBuffer, m_materialBuffer };
+	if ((m_frameDataBuffer != 0) || (m_lightBlockBuffer != 0) || (m_materialBuffer != 0))
+	{
+		// OpenGL silently ignores the buffers that were never
+		// created
+		glDeleteBuffers(3, buffers);
+	}
+
+	m_frameDataBuffer = 0;
+	m_lightBlockBuffer = 0;
+	m_materialBuffer = 0;
+}
+
 /***********************************************************
  *  LoadShaders()
  *
@@ -113,7 +135,311 @@ GLuint ShaderManager::LoadShaders(const char * vertex_file_path,const char * fra
 	glDeleteShader(VertexShaderID);
 	glDeleteShader(FragmentShaderID);
 
+	// build the uniform table once so that no driver string
+	// lookups are needed while rendering
+	ReflectUniforms();
+
+	// the uniform block buffers are shared by all programs
+	if (m_frameDataBuffer == 0)
+	{
+		CreateUniformBlocks();
+	}
+
+	return ProgramID;
+}
+
+/***********************************************************
+ *  LoadComputeShader()
+ *
+ *  This method is called to load a compute shader from an
+ *  external GLSL file and to link it into its own program.
+ *  The uniform table and the uniform functions of the
+ *  manager stay with the program loaded by LoadShaders().
+ *  Returns 0 when the program could not be built.
+ ***********************************************************/
+GLuint ShaderManager::LoadComputeShader(const char* compute_file_path)
+{
+	std::ifstream computeShaderStream(compute_file_path, std::ios::in);
+	if (computeShaderStream.is_open() == false)
+	{
+		printf("Impossible to open %s.\n", compute_file_path);
+		return 0;
+	}
+
+	std::stringstream sstr;
+	sstr << computeShaderStream.rdbuf();
+	std::string computeShaderCode = sstr.str();
+	computeShaderStream.close();
+
+	GLint Result = GL_FALSE;
+	int InfoLogLength = 0;
+
+	// Compile Compute Shader
+	printf("Compiling shader : %s...", compute_file_path);
+	GLuint ComputeShaderID = glCreateShader(GL_COMPUTE_SHADER);
+	char const * ComputeSourcePointer = computeShaderCode.c_str();
+	glShaderSource(ComputeShaderID, 1, &ComputeSourcePointer, NULL);
+	glCompileShader(ComputeShaderID);
+
+	// Check Compute Shader
+	glGetShaderiv(ComputeShaderID, GL_COMPILE_STATUS, &Result);
+	glGetShaderiv(ComputeShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	if ( InfoLogLength > 0 ){
+		std::vector<char> ComputeShaderErrorMessage(InfoLogLength+1);
+		glGetShaderInfoLog(ComputeShaderID, InfoLogLength, NULL, &ComputeShaderErrorMessage[0]);
+		printf("\n%s\n", &ComputeShaderErrorMessage[0]);
+	}
+	if (Result == GL_FALSE)
+	{
+		printf("failed\n");
+		glDeleteShader(ComputeShaderID);
+		return 0;
+	}
+
+	printf("success\n");
+
+	// Link the program
+	printf("Linking compute program...");
+	GLuint ProgramID = glCreateProgram();
+	glAttachShader(ProgramID, ComputeShaderID);
+	glLinkProgram(ProgramID);
+
+	// Check the program
+	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
+	glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	if ( InfoLogLength > 1 ){
+		std::vector<char> ProgramErrorMessage(InfoLogLength+1);
+		glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
+		printf("\n%s\n", &ProgramErrorMessage[0]);
+	}
+
+	glDetachShader(ProgramID, ComputeShaderID);
+	glDeleteShader(ComputeShaderID);
+
+	if (Result == GL_FALSE)
+	{
+		printf("failed\n");
+		GLStateCache::ForgetProgram(ProgramID);
+		glDeleteProgram(ProgramID);
+		return 0;
+	}
+
+	printf("success\n");
+
 	return ProgramID;
 }
 
+/***********************************************************
+ *  GetUniformHandle()
+ *
+ *  This method is called to resolve a hashed uniform name
+ *  into a handle using the reflected uniform table.  Every
+ *  call is counted as a lookup for the current frame.
+ ***********************************************************/
+UniformHandle ShaderManager::GetUniformHandle(UniformID id) const
+{
+	UniformHandle handle;
+
+	m_frameLookups++;
+
+	if (m_uniformTable.empty())
+	{
+		return(handle);
+	}
+
+	const size_t mask = m_uniformTable.size() - 1;
+	size_t index = id.hash & mask;
 
+	// probe until the name is found or an empty slot is reached
+	while (m_uniformTable[index].name.empty() == false)
+	{
+		if ((m_uniformTable[index].hash == id.hash) &&
+			(m_uniformTable[index].name.compare(id.name) == 0))
+		{
+			handle.location = m_uniformTable[index].location;
+			break;
+		}
+		index = (index + 1) & mask;
+	}
+
+	return(handle);
+}
+
+/***********************************************************
+ *  ReflectUniforms()
+ *
+ *  This method is called after linking to query every active
+ *  uniform of the program and store its location in a flat
+ *  open-addressed hash table.
+ ***********************************************************/
+void ShaderManager::ReflectUniforms()
+{
+	GLint uniformCount = 0;
+	GLint maxNameLength = 0;
+
+	glGetProgramiv(m_programID, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(m_programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	std::vector<char> nameBuffer(maxNameLength + 1);
+	std::vector<std::string> names(uniformCount);
+	std::vector<GLint> arraySizes(uniformCount);
+
+	// count every name that is inserted - an array uniform adds
+	// its bare name and one name for every element
+	size_t nameCount = 0;
+	for (GLint i = 0; i < uniformCount; i++)
+	{
+		GLsizei nameLength = 0;
+		GLenum type = 0;
+		glGetActiveUniform(m_programID, (GLuint)i, maxNameLength, &nameLength, &arraySizes[i], &type, &nameBuffer[0]);
+		names[i].assign(&nameBuffer[0], nameLength);
+
+		nameCount++;
+		size_t suffix = names[i].rfind("[0]");
+		if ((suffix != std::string::npos) && (suffix + 3 == names[i].length()))
+		{
+			nameCount += 1 + (size_t)arraySizes[i];
+		}
+	}
+
+	// keep the table at most half full so probe chains stay
+	// short and always end at an empty slot
+	size_t tableSize = 16;
+	while (tableSize < nameCount * 2)
+	{
+		tableSize *= 2;
+	}
+	m_uniformTable.clear();
+	m_uniformTable.resize(tableSize);
+
+	for (GLint i = 0; i < uniformCount; i++)
+	{
+		const std::string& name = names[i];
+		const GLint arraySize = arraySizes[i];
+		GLint location = glGetUniformLocation(m_programID, name.c_str());
+
+		// members of uniform blocks do not have a location
+		if (location < 0)
+		{
+			continue;
+		}
+
+		InsertUniform(name, location);
+
+		// arrays are reported as "name[0]" - also register the
+		// bare name and every element so either form resolves
+		size_t suffix = name.rfind("[0]");
+		if ((suffix != std::string::npos) && (suffix + 3 == name.length()))
+		{
+			std::string baseName = name.substr(0, suffix);
+			InsertUniform(baseName, location);
+			for (GLint element = 1; element < arraySize; element++)
+			{
+				std::string elementName = baseName + "[" + std::to_string(element) + "]";
+				InsertUniform(elementName, glGetUniformLocation(m_programID, elementName.c_str()));
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  InsertUniform()
+ *
+ *  This method is called to add a uniform name and location
+ *  into the reflected uniform table.
+ ***********************************************************/
+void ShaderManager::InsertUniform(const std::string& name, GLint location)
+{
+	const size_t mask = m_uniformTable.size() - 1;
+	const uint32_t hash = HashName(name);
+	size_t index = hash & mask;
+
+	while (m_uniformTable[index].name.empty() == false)
+	{
+		if (m_uniformTable[index].name.compare(name) == 0)
+		{
+			return;
+		}
+		index = (index + 1) & mask;
+	}
+
+	m_uniformTable[index].hash = hash;
+	m_uniformTable[index].location = location;
+	m_uniformTable[index].name = name;
+}
+
+/***********************************************************
+ *  CreateUniformBlocks()
+ *
+ *  This method is called to create the buffers behind the
+ *  shared uniform blocks and attach them to their binding
+ *  points, which are fixed in the shader code.
+ ***********************************************************/
+void ShaderManager::CreateUniformBlocks()
+{
+	glGenBuffers(1, &m_frameDataBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_frameDataBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, m_frameDataBuffer);
+
+	glGenBuffers(1, &m_lightBlockBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_lightBlockBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(LightBlock), NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, LIGHT_BLOCK_BINDING, m_lightBlockBuffer);
+
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+/***********************************************************
+ *  UpdateFrameData()
+ *
+ *  This method is called once per frame to write the camera
+ *  data into the frame data block with a single upload.
+ ***********************************************************/
+void ShaderManager::UpdateFrameData(const FrameData& frameData)
+{
+	m_frameData = frameData;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_frameDataBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &m_frameData);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+/***********************************************************
+ *  UpdateLightBlock()
+ *
+ *  This method is called to write all of the scene lights
+ *  into the light block with a single upload.
+ ***********************************************************/
+void ShaderManager::UpdateLightBlock(const LightBlock& lightBlock)
+{
+	glBindBuffer(GL_UNIFORM_BUFFER, m_lightBlockBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(LightBlock), &lightBlock);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+/***********************************************************
+ *  UpdateMaterialTable()
+ *
+ *  This method is called to write every material of the
+ *  scene into the material storage block with a single
+ *  upload, so that draws only need to select a material
+ *  by its index.
+ ***********************************************************/
+void ShaderManager::UpdateMaterialTable(const MaterialData* materials, size_t count)
+{
+	if ((NULL == materials) || (count == 0))
+	{
+		return;
+	}
+
+	if (m_materialBuffer == 0)
+	{
+		glGenBuffers(1, &m_materialBuffer);
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_materialBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, count * sizeof(MaterialData), materials, GL_STATIC_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_BLOCK_BINDING, m_materialBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
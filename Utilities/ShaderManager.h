@@ -7,97 +7,277 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <string>
+#include <string_view>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
+#include "GLStateCache.h"
+#include "NameHash.h"
+#include "UniformBlocks.h"
+
+// handle to a uniform location that was reflected from the
+// linked shader program - resolve once, then set every frame
+struct UniformHandle
+{
+	GLint location = -1;
+};
+
+// uniform name hashed at compile time, for example:
+//     constexpr UniformID g_ModelID("model");
+typedef NameID UniformID;
+
 class ShaderManager
 {
 public:
 	unsigned int m_programID;
+
+	// destructor - deletes the shared block buffers, so the
+	// OpenGL context must still be current
+	~ShaderManager();
 	
 	GLuint LoadShaders(
 		const char* vertex_file_path, 
 		const char* fragment_file_path);
+	// compile and link a compute program - it is returned to
+	// the caller, and does not replace the program in use
+	GLuint LoadComputeShader(const char* compute_file_path);
 
 	// activate the shader
 	// ------------------------------------------------------------------------
 	inline void use()
 	{
-		glUseProgram(m_programID);
+		GLStateCache::UseProgram(m_programID);
+	}
+
+	// resolve a uniform name to a handle using the reflected
+	// uniform table - no driver string lookup is performed
+	// and no memory is allocated
+	// ------------------------------------------------------------------------
+	UniformHandle GetUniformHandle(UniformID id) const;
+	inline UniformHandle GetUniformHandle(std::string_view name) const
+	{
+		return(GetUniformHandle(UniformID(name)));
+	}
+
+	// shared uniform blocks - every program loaded by this
+	// manager reads them from the same fixed binding points
+	// ------------------------------------------------------------------------
+	void UpdateFrameData(const FrameData& frameData);
+	void UpdateLightBlock(const LightBlock& lightBlock);
+	void UpdateMaterialTable(const MaterialData* materials, size_t count);
+	inline const FrameData& GetFrameData() const
+	{
+		return(m_frameData);
+	}
+
+	// per-frame count of uniform name lookups, which should
+	// be zero once all of the handles have been resolved
+	// ------------------------------------------------------------------------
+	inline void ResetFrameCounters()
+	{
+		m_frameLookups = 0;
+	}
+	inline unsigned int GetFrameLookupCount() const
+	{
+		return(m_frameLookups);
 	}
 
 	// utility uniform functions
 	// ------------------------------------------------------------------------
-	inline void setBoolValue(const std::string &name, bool value) const
+	inline void setBoolValue(UniformHandle handle, bool value) const
+	{
+		GLStateCache::SetUniform1i(handle.location, (int)value);
+	}
+	inline void setBoolValue(std::string_view name, bool value) const
+	{
+		setBoolValue(GetUniformHandle(name), value);
+	}
+	inline void setBoolValue(UniformID id, bool value) const
 	{
-		glUniform1i(glGetUniformLocation(m_programID, name.c_str()), (int)value);
+		setBoolValue(GetUniformHandle(id), value);
 	}
 
 	// ------------------------------------------------------------------------
-	inline void setIntValue(const std::string &name, int value) const
+	inline void setIntValue(UniformHandle handle, int value) const
+	{
+		GLStateCache::SetUniform1i(handle.location, value);
+	}
+	inline void setIntValue(std::string_view name, int value) const
+	{
+		setIntValue(GetUniformHandle(name), value);
+	}
+	inline void setIntValue(UniformID id, int value) const
 	{
-		glUniform1i(glGetUniformLocation(m_programID, name.c_str()), value);
+		setIntValue(GetUniformHandle(id), value);
 	}
 
 	// ------------------------------------------------------------------------
-	inline void setFloatValue(const std::string &name, float value) const
+	inline void setFloatValue(UniformHandle handle, float value) const
 	{
-		glUniform1f(glGetUniformLocation(m_programID, name.c_str()), value);
+		GLStateCache::SetUniform1f(handle.location, value);
+	}
+	inline void setFloatValue(std::string_view name, float value) const
+	{
+		setFloatValue(GetUniformHandle(name), value);
+	}
+	inline void setFloatValue(UniformID id, float value) const
+	{
+		setFloatValue(GetUniformHandle(id), value);
 	}
 
 	// ------------------------------------------------------------------------
-	inline void setVec2Value(const std::string &name, const glm::vec2 &value) const
+	inline void setVec2Value(UniformHandle handle, const glm::vec2 &value) const
 	{
-		glUniform2fv(glGetUniformLocation(m_programID, name.c_str()), 1, &value[0]);
+		GLStateCache::SetUniform2fv(handle.location, &value[0]);
+	}
+	inline void setVec2Value(std::string_view name, const glm::vec2 &value) const
+	{
+		setVec2Value(GetUniformHandle(name), value);
+	}
+	inline void setVec2Value(UniformID id, const glm::vec2 &value) const
+	{
+		setVec2Value(GetUniformHandle(id), value);
 	}
 
-	inline void setVec2Value(const std::string &name, float x, float y) const
+	inline void setVec2Value(std::string_view name, float x, float y) const
 	{
-		glUniform2f(glGetUniformLocation(m_programID, name.c_str()), x, y);
+		setVec2Value(name, glm::vec2(x, y));
+	}
+	inline void setVec2Value(UniformID id, float x, float y) const
+	{
+		setVec2Value(id, glm::vec2(x, y));
 	}
 
 	// ------------------------------------------------------------------------
-	inline void setVec3Value(const std::string &name, const glm::vec3 &value) const
+	inline void setVec3Value(UniformHandle handle, const glm::vec3 &value) const
+	{
+		GLStateCache::SetUniform3fv(handle.location, &value[0]);
+	}
+	inline void setVec3Value(std::string_view name, const glm::vec3 &value) const
+	{
+		setVec3Value(GetUniformHandle(name), value);
+	}
+	inline void setVec3Value(UniformID id, const glm::vec3 &value) const
 	{
-		glUniform3fv(glGetUniformLocation(m_programID, name.c_str()), 1, &value[0]);
+		setVec3Value(GetUniformHandle(id), value);
 	}
-	inline void setVec3Value(const std::string &name, float x, float y, float z) const
+	inline void setVec3Value(std::string_view name, float x, float y, float z) const
 	{
-		glUniform3f(glGetUniformLocation(m_programID, name.c_str()), x, y, z);
+		setVec3Value(name, glm::vec3(x, y, z));
+	}
+	inline void setVec3Value(UniformID id, float x, float y, float z) const
+	{
+		setVec3Value(id, glm::vec3(x, y, z));
 	}
 
 	// ------------------------------------------------------------------------
-	inline void setVec4Value(const std::string &name, const glm::vec4 &value) const
+	inline void setVec4Value(UniformHandle handle, const glm::vec4 &value) const
+	{
+		GLStateCache::SetUniform4fv(handle.location, &value[0]);
+	}
+	inline void setVec4Value(std::string_view name, const glm::vec4 &value) const
 	{
-		glUniform4fv(glGetUniformLocation(m_programID, name.c_str()), 1, &value[0]);
+		setVec4Value(GetUniformHandle(name), value);
 	}
-	inline void setVec4Value(const std::string &name, float x, float y, float z, float w)
+	inline void setVec4Value(UniformID id, const glm::vec4 &value) const
 	{
-		glUniform4f(glGetUniformLocation(m_programID, name.c_str()), x, y, z, w);
+		setVec4Value(GetUniformHandle(id), value);
+	}
+	inline void setVec4Value(std::string_view name, float x, float y, float z, float w)
+	{
+		setVec4Value(name, glm::vec4(x, y, z, w));
+	}
+	inline void setVec4Value(UniformID id, float x, float y, float z, float w)
+	{
+		setVec4Value(id, glm::vec4(x, y, z, w));
 	}
 
 	// ------------------------------------------------------------------------
-	inline void setMat2Value(const std::string &name, const glm::mat2 &mat) const
+	inline void setMat2Value(UniformHandle handle, const glm::mat2 &mat) const
 	{
-		glUniformMatrix2fv(glGetUniformLocation(m_programID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		GLStateCache::SetUniformMatrix2fv(handle.location, &mat[0][0]);
+	}
+	inline void setMat2Value(std::string_view name, const glm::mat2 &mat) const
+	{
+		setMat2Value(GetUniformHandle(name), mat);
+	}
+	inline void setMat2Value(UniformID id, const glm::mat2 &mat) const
+	{
+		setMat2Value(GetUniformHandle(id), mat);
 	}
 
 	// ------------------------------------------------------------------------
-	inline void setMat3Value(const std::string &name, const glm::mat3 &mat) const
+	inline void setMat3Value(UniformHandle handle, const glm::mat3 &mat) const
 	{
-		glUniformMatrix3fv(glGetUniformLocation(m_programID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		GLStateCache::SetUniformMatrix3fv(handle.location, &mat[0][0]);
+	}
+	inline void setMat3Value(std::string_view name, const glm::mat3 &mat) const
+	{
+		setMat3Value(GetUniformHandle(name), mat);
+	}
+	inline void setMat3Value(UniformID id, const glm::mat3 &mat) const
+	{
+		setMat3Value(GetUniformHandle(id), mat);
 	}
 
 	// ------------------------------------------------------------------------
-	inline void setMat4Value(const std::string &name, const glm::mat4 &mat) const
+	inline void setMat4Value(UniformHandle handle, const glm::mat4 &mat) const
+	{
+		GLStateCache::SetUniformMatrix4fv(handle.location, glm::value_ptr(mat));
+	}
+	inline void setMat4Value(std::string_view name, const glm::mat4 &mat) const
 	{
-		glUniformMatrix4fv(glGetUniformLocation(m_programID, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
+		setMat4Value(GetUniformHandle(name), mat);
+	}
+	inline void setMat4Value(UniformID id, const glm::mat4 &mat) const
+	{
+		setMat4Value(GetUniformHandle(id), mat);
 	}
 
 	// ------------------------------------------------------------------------
-	inline void setSampler2DValue(const std::string& name, const int &value) const
+	inline void setSampler2DValue(UniformHandle handle, const int &value) const
+	{
+		GLStateCache::SetUniform1i(handle.location, value);
+	}
+	inline void setSampler2DValue(std::string_view name, const int &value) const
 	{
-		glUniform1i(glGetUniformLocation(m_programID, name.c_str()), value);
+		setSampler2DValue(GetUniformHandle(name), value);
 	}
+	inline void setSampler2DValue(UniformID id, const int &value) const
+	{
+		setSampler2DValue(GetUniformHandle(id), value);
+	}
+
+private:
+	// one entry of the flat, open-addressed uniform table
+	struct UNIFORM_SLOT
+	{
+		uint32_t hash;
+		GLint location;
+		std::string name;
+	};
+
+	// reflected uniforms of the linked program - the table size
+	// is always a power of two and empty slots have an empty name
+	std::vector<UNIFORM_SLOT> m_uniformTable;
+	// number of name lookups performed since the last reset
+	mutable unsigned int m_frameLookups = 0;
+
+	// buffers backing the shared uniform blocks
+	GLuint m_frameDataBuffer = 0;
+	GLuint m_lightBlockBuffer = 0;
+	// buffer backing the material storage block
+	GLuint m_materialBuffer = 0;
+	// last frame data written into the frame data block
+	FrameData m_frameData = {};
+
+	// create the buffers for the shared uniform blocks
+	void CreateUniformBlocks();
+
+	// query all active uniforms of the linked program once
+	void ReflectUniforms();
+	// add a uniform name and location into the table
+	void InsertUniform(const std::string& name, GLint location);
 };
\ No newline at end of file
@@ -0,0 +1,338 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecontainer.cpp
+// ============
+// cooked texture files that hold every mipmap level ready for upload
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureContainer.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <fstream>
+
+namespace
+{
+	/***********************************************************
+	 *  AlignOffset()
+	 *
+	 *  Returns the passed in file offset rounded up to the
+	 *  alignment of the level data.
+	 ***********************************************************/
+	uint64_t AlignOffset(uint64_t offset)
+	{
+		const uint64_t alignment = TextureContainer::LEVEL_ALIGNMENT;
+		return((offset + alignment - 1) / alignment * alignment);
+	}
+}
+
+/***********************************************************
+ *  TextureContainer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureContainer::TextureContainer()
+{
+	m_data = NULL;
+	m_size = 0;
+}
+
+/***********************************************************
+ *  ~TextureContainer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureContainer::~TextureContainer()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping a cooked texture file
+ *  into memory, read only.  The file is only read by the
+ *  pages that the levels are copied from.
+ ***********************************************************/
+bool TextureContainer::Open(const char* filename)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(
+		filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return(false);
+	}
+
+	LARGE_INTEGER fileSize = {};
+	HANDLE mapping = NULL;
+	if ((GetFileSizeEx(file, &fileSize) != FALSE) && (fileSize.QuadPart > 0))
+	{
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	}
+	if (NULL != mapping)
+	{
+		m_data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		m_size = (size_t)fileSize.QuadPart;
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+#else
+	int file = open(filename, O_RDONLY);
+	if (file < 0)
+	{
+		return(false);
+	}
+
+	struct stat fileStat = {};
+	if ((fstat(file, &fileStat) == 0) && (fileStat.st_size > 0))
+	{
+		void* view = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (view != MAP_FAILED)
+		{
+			m_data = (const unsigned char*)view;
+			m_size = (size_t)fileStat.st_size;
+		}
+	}
+	close(file);
+#endif
+
+	if ((NULL != m_data) && (Validate() == false))
+	{
+		Close();
+	}
+
+	return(NULL != m_data);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for unmapping the cooked file.  The
+ *  level data must not be used afterwards.
+ ***********************************************************/
+void TextureContainer::Close()
+{
+	if (NULL == m_data)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_data);
+#else
+	munmap((void*)m_data, m_size);
+#endif
+	m_data = NULL;
+	m_size = 0;
+}
+
+/***********************************************************
+ *  Validate()
+ *
+ *  This method is used for checking that the mapped file is
+ *  a cooked texture of a known format, that it has no more
+ *  levels than its size allows, and that every level of its
+ *  table has the size of its place in the mipmap chain and
+ *  lies within the file.
+ ***********************************************************/
+bool TextureContainer::Validate() const
+{
+	if (m_size < sizeof(TEXTURE_FILE_HEADER))
+	{
+		return(false);
+	}
+
+	const TEXTURE_FILE_HEADER& header = GetHeader();
+	if ((header.magic != FILE_MAGIC) ||
+		(header.version != FILE_VERSION) ||
+		(header.width == 0) ||
+		(header.height == 0) ||
+		(header.levelCount == 0) ||
+		(header.levelCount > 32) ||
+		(GetLevelSize((TEXTURE_FORMAT)header.format, 1, 1) == 0))
+	{
+		return(false);
+	}
+	if (m_size < sizeof(TEXTURE_FILE_HEADER) + header.levelCount * sizeof(TEXTURE_FILE_LEVEL))
+	{
+		return(false);
+	}
+
+	// the chain ends at 1x1, OpenGL cannot allocate more levels
+	// than floor(log2(max(width, height))) + 1
+	uint32_t maxLevelCount = 1;
+	for (uint32_t size = std::max(header.width, header.height); size > 1; size /= 2)
+	{
+		maxLevelCount++;
+	}
+	if (header.levelCount > maxLevelCount)
+	{
+		return(false);
+	}
+
+	uint32_t width = header.width;
+	uint32_t height = header.height;
+	for (int i = 0; i < (int)header.levelCount; i++)
+	{
+		const TEXTURE_FILE_LEVEL& level = GetLevel(i);
+		if ((level.width != width) ||
+			(level.height != height) ||
+			(level.size != GetLevelSize((TEXTURE_FORMAT)header.format, width, height)) ||
+			(level.offset > m_size) ||
+			(level.size > m_size - level.offset))
+		{
+			return(false);
+		}
+
+		width = (width > 1) ? (width / 2) : 1;
+		height = (height > 1) ? (height / 2) : 1;
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Write()
+ *
+ *  This method is used for writing the levels of an image
+ *  into a cooked texture file.  Every level must already be
+ *  in the passed in format, with the size that its place in
+ *  the mipmap chain gives it.
+ ***********************************************************/
+bool TextureContainer::Write(
+	const char* filename,
+	TEXTURE_FORMAT format,
+	int width,
+	int height,
+	const std::vector<std::vector<unsigned char>>& levels)
+{
+	TEXTURE_FILE_HEADER header = {};
+	header.magic = FILE_MAGIC;
+	header.version = FILE_VERSION;
+	header.format = format;
+	header.width = (uint32_t)width;
+	header.height = (uint32_t)height;
+	header.levelCount = (uint32_t)levels.size();
+
+	// the level data follows the table, each level aligned
+	std::vector<TEXTURE_FILE_LEVEL> table(levels.size());
+	uint64_t offset = AlignOffset(sizeof(TEXTURE_FILE_HEADER) + table.size() * sizeof(TEXTURE_FILE_LEVEL));
+	for (int i = 0; i < (int)levels.size(); i++)
+	{
+		table[i].width = (uint32_t)width;
+		table[i].height = (uint32_t)height;
+		table[i].offset = offset;
+		table[i].size = levels[i].size();
+		if (levels[i].size() != GetLevelSize(format, width, height))
+		{
+			return(false);
+		}
+
+		offset = AlignOffset(offset + table[i].size);
+		width = (width > 1) ? (width / 2) : 1;
+		height = (height > 1) ? (height / 2) : 1;
+	}
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if (file.is_open() == false)
+	{
+		return(false);
+	}
+
+	const char padding[LEVEL_ALIGNMENT] = {};
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)table.data(), table.size() * sizeof(TEXTURE_FILE_LEVEL));
+	for (int i = 0; i < (int)levels.size(); i++)
+	{
+		uint64_t position = (uint64_t)file.tellp();
+		file.write(padding, (std::streamsize)(table[i].offset - position));
+		file.write((const char*)levels[i].data(), (std::streamsize)levels[i].size());
+	}
+
+	return(file.good());
+}
+
+/***********************************************************
+ *  GetLevelSize()
+ *
+ *  This method is used for getting the size of one level of
+ *  a format.  The block compressed formats store every
+ *  started 4x4 block in full.  Unknown formats have no size.
+ ***********************************************************/
+size_t TextureContainer::GetLevelSize(TEXTURE_FORMAT format, int width, int height)
+{
+	size_t blocks = (size_t)((width + 3) / 4) * (size_t)((height + 3) / 4);
+
+	switch (format)
+	{
+	case TEXTURE_FORMAT_RGB8:
+		return((size_t)width * (size_t)height * 3);
+	case TEXTURE_FORMAT_RGBA8:
+		return((size_t)width * (size_t)height * 4);
+	case TEXTURE_FORMAT_BC1:
+	case TEXTURE_FORMAT_BC4:
+		return(blocks * 8);
+	case TEXTURE_FORMAT_BC3:
+	case TEXTURE_FORMAT_BC5:
+	case TEXTURE_FORMAT_BC7:
+		return(blocks * 16);
+	default:
+		return(0);
+	}
+}
+
+/***********************************************************
+ *  IsBlockCompressed()
+ *
+ *  This method is used for telling whether the levels of a
+ *  format are stored in 4x4 blocks.
+ ***********************************************************/
+bool TextureContainer::IsBlockCompressed(TEXTURE_FORMAT format)
+{
+	return((format == TEXTURE_FORMAT_BC1) ||
+		(format == TEXTURE_FORMAT_BC3) ||
+		(format == TEXTURE_FORMAT_BC4) ||
+		(format == TEXTURE_FORMAT_BC5) ||
+		(format == TEXTURE_FORMAT_BC7));
+}
+
+/***********************************************************
+ *  GetFormatName()
+ *
+ *  This method is used for getting the name of a format as
+ *  it is written to the console.
+ ***********************************************************/
+const char* TextureContainer::GetFormatName(TEXTURE_FORMAT format)
+{
+	switch (format)
+	{
+	case TEXTURE_FORMAT_RGB8:
+		return("RGB8");
+	case TEXTURE_FORMAT_RGBA8:
+		return("RGBA8");
+	case TEXTURE_FORMAT_BC1:
+		return("BC1");
+	case TEXTURE_FORMAT_BC3:
+		return("BC3");
+	case TEXTURE_FORMAT_BC4:
+		return("BC4");
+	case TEXTURE_FORMAT_BC5:
+		return("BC5");
+	case TEXTURE_FORMAT_BC7:
+		return("BC7");
+	default:
+		return("unknown");
+	}
+}
@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecontainer.h
+// ============
+// cooked texture files that hold every mipmap level ready for upload
+//
+// The texture cooker converts the scene images into these files offline,
+// with the full mipmap chain precomputed and the levels optionally block
+// compressed.  A file is a small header, a table of the levels and then the
+// data of every level, each aligned to 16 bytes.  At run time the file is
+// mapped into memory and the levels are handed to OpenGL straight from the
+// mapping, so loading a cooked texture does no work per pixel on the CPU.
+// The container does not depend on OpenGL, so the cooker can be built
+// without it.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// pixel layout of the levels of a cooked texture
+enum TEXTURE_FORMAT : uint32_t
+{
+	TEXTURE_FORMAT_RGB8 = 1,		// 3 bytes per texel, rows tightly packed
+	TEXTURE_FORMAT_RGBA8 = 2,		// 4 bytes per texel
+	TEXTURE_FORMAT_BC1 = 3,			// 8 bytes per 4x4 block, opaque color
+	TEXTURE_FORMAT_BC3 = 4,			// 16 bytes per 4x4 block, color and alpha
+	TEXTURE_FORMAT_BC4 = 5,			// 8 bytes per 4x4 block, red only
+	TEXTURE_FORMAT_BC5 = 6,			// 16 bytes per 4x4 block, red and green
+	TEXTURE_FORMAT_BC7 = 7			// 16 bytes per 4x4 block, color and alpha
+};
+
+// start of every cooked file
+struct TEXTURE_FILE_HEADER
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t levelCount;
+	uint32_t reserved[2];
+};
+
+// one entry of the level table that follows the header
+struct TEXTURE_FILE_LEVEL
+{
+	uint32_t width;
+	uint32_t height;
+	uint64_t offset;
+	uint64_t size;
+};
+
+static_assert(sizeof(TEXTURE_FILE_HEADER) == 32, "TEXTURE_FILE_HEADER must match the file layout");
+static_assert(sizeof(TEXTURE_FILE_LEVEL) == 24, "TEXTURE_FILE_LEVEL must match the file layout");
+
+/***********************************************************
+ *  TextureContainer
+ *
+ *  This class maps a cooked texture file into memory and
+ *  gives access to its levels, and writes cooked files.
+ ***********************************************************/
+class TextureContainer
+{
+public:
+	// "CTEX" read as a little endian integer
+	static constexpr uint32_t FILE_MAGIC = 0x58455443;
+	static constexpr uint32_t FILE_VERSION = 1;
+	// alignment of the data of every level in the file
+	static constexpr size_t LEVEL_ALIGNMENT = 16;
+
+	// constructor
+	TextureContainer();
+	// destructor
+	~TextureContainer();
+
+	// map a cooked file into memory - returns false when the
+	// file is missing or its header or level table is broken
+	bool Open(const char* filename);
+	// unmap the file
+	void Close();
+
+	inline bool IsOpen() const
+	{
+		return(NULL != m_data);
+	}
+	inline TEXTURE_FORMAT GetFormat() const
+	{
+		return((TEXTURE_FORMAT)GetHeader().format);
+	}
+	inline int GetWidth() const
+	{
+		return((int)GetHeader().width);
+	}
+	inline int GetHeight() const
+	{
+		return((int)GetHeader().height);
+	}
+	inline int GetLevelCount() const
+	{
+		return((int)GetHeader().levelCount);
+	}
+	inline const TEXTURE_FILE_LEVEL& GetLevel(int level) const
+	{
+		return(((const TEXTURE_FILE_LEVEL*)(m_data + sizeof(TEXTURE_FILE_HEADER)))[level]);
+	}
+	// data of a level, pointing into the mapped file
+	inline const unsigned char* GetLevelData(int level) const
+	{
+		return(m_data + GetLevel(level).offset);
+	}
+
+	// write the levels of an image into a cooked file, the
+	// first level is the full image and every next one is
+	// half of the one before it
+	static bool Write(
+		const char* filename,
+		TEXTURE_FORMAT format,
+		int width,
+		int height,
+		const std::vector<std::vector<unsigned char>>& levels);
+	// size in bytes of one level of a format
+	static size_t GetLevelSize(TEXTURE_FORMAT format, int width, int height);
+	static bool IsBlockCompressed(TEXTURE_FORMAT format);
+	static const char* GetFormatName(TEXTURE_FORMAT format);
+
+private:
+	// the mapped file - the view keeps the file open, so no
+	// other handles are kept
+	const unsigned char* m_data;
+	size_t m_size;
+
+	inline const TEXTURE_FILE_HEADER& GetHeader() const
+	{
+		return(*(const TEXTURE_FILE_HEADER*)m_data);
+	}
+	// check the header and the level table of the mapped file
+	bool Validate() const;
+};
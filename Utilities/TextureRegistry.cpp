@@ -0,0 +1,502 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureregistry.cpp
+// ============
+// keep track of the loaded OpenGL textures and hand out compact handles
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureRegistry.h"
+#include "GLStateCache.h"
+#include "NameHash.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+	/***********************************************************
+	 *  GetBytesPerTexel()
+	 *
+	 *  Returns the size of one texel of the passed in internal
+	 *  format, as it was requested from the driver.
+	 ***********************************************************/
+	size_t GetBytesPerTexel(GLenum internalFormat)
+	{
+		switch (internalFormat)
+		{
+		case GL_R8:
+			return(1);
+		case GL_RG8:
+			return(2);
+		case GL_RGB8:
+		case GL_SRGB8:
+			return(3);
+		case GL_RGBA8:
+		case GL_SRGB8_ALPHA8:
+			return(4);
+		default:
+			return(4);
+		}
+	}
+
+	/***********************************************************
+	 *  GetBytesPerBlock()
+	 *
+	 *  Returns the size of one 4x4 block of the passed in block
+	 *  compressed format, or 0 when the format is not block
+	 *  compressed.
+	 ***********************************************************/
+	size_t GetBytesPerBlock(GLenum internalFormat)
+	{
+		switch (internalFormat)
+		{
+		case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_RED_RGTC1:
+			return(8);
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+		case GL_COMPRESSED_RG_RGTC2:
+		case GL_COMPRESSED_RGBA_BPTC_UNORM:
+			return(16);
+		default:
+			return(0);
+		}
+	}
+
+	/***********************************************************
+	 *  CalculateLevelMemory()
+	 *
+	 *  Returns the size of one level of a 2D texture, where a
+	 *  block compressed level stores every started block.
+	 ***********************************************************/
+	size_t CalculateLevelMemory(int width, int height, GLenum internalFormat)
+	{
+		size_t blockBytes = GetBytesPerBlock(internalFormat);
+		if (blockBytes != 0)
+		{
+			return((size_t)((width + 3) / 4) * (size_t)((height + 3) / 4) * blockBytes);
+		}
+
+		return((size_t)width * (size_t)height * GetBytesPerTexel(internalFormat));
+	}
+
+	/***********************************************************
+	 *  CalculateTextureMemory()
+	 *
+	 *  Returns the size of a 2D texture including its full
+	 *  mipmap chain when it has one.
+	 ***********************************************************/
+	size_t CalculateTextureMemory(int width, int height, GLenum internalFormat, bool bMipmapped)
+	{
+		size_t totalBytes = CalculateLevelMemory(width, height, internalFormat);
+
+		while ((bMipmapped == true) && ((width > 1) || (height > 1)))
+		{
+			width = (width > 1) ? (width / 2) : 1;
+			height = (height > 1) ? (height / 2) : 1;
+			totalBytes += CalculateLevelMemory(width, height, internalFormat);
+		}
+
+		return(totalBytes);
+	}
+
+	/***********************************************************
+	 *  GetSizeClass()
+	 *
+	 *  Returns the power of two that is nearest to the larger
+	 *  side of a texture, clamped to the passed in limits.
+	 ***********************************************************/
+	int GetSizeClass(int width, int height, int minSize, int maxSize)
+	{
+		int larger = (width > height) ? width : height;
+		int size = 1;
+
+		while (size < larger)
+		{
+			size *= 2;
+		}
+		if ((size - larger) > (larger - (size / 2)))
+		{
+			size /= 2;
+		}
+
+		if (size < minSize)
+		{
+			size = minSize;
+		}
+		if (size > maxSize)
+		{
+			size = maxSize;
+		}
+
+		return(size);
+	}
+
+	/***********************************************************
+	 *  CountMipLevels()
+	 *
+	 *  Returns the number of levels in the full mipmap chain
+	 *  of a square texture.
+	 ***********************************************************/
+	int CountMipLevels(int size)
+	{
+		int levels = 1;
+
+		while (size > 1)
+		{
+			size /= 2;
+			levels++;
+		}
+
+		return(levels);
+	}
+
+	/***********************************************************
+	 *  GetSourceLevel()
+	 *
+	 *  Returns the smallest mipmap level of a texture that is
+	 *  still at least as large as the passed in size, so that
+	 *  a linear blit never skips over texels when it shrinks.
+	 ***********************************************************/
+	int GetSourceLevel(int width, int height, int size)
+	{
+		int level = 0;
+
+		while (((width / 2) >= size) && ((height / 2) >= size))
+		{
+			width /= 2;
+			height /= 2;
+			level++;
+		}
+
+		return(level);
+	}
+}
+
+/***********************************************************
+ *  TextureRegistry()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureRegistry::TextureRegistry()
+{
+	m_totalBytes = 0;
+}
+
+/***********************************************************
+ *  ~TextureRegistry()
+ *
+ *  The destructor for the class - the textures must be
+ *  destroyed with DestroyAll() while the OpenGL context is
+ *  still current.
+ ***********************************************************/
+TextureRegistry::~TextureRegistry()
+{
+	m_textures.clear();
+	m_handles.clear();
+}
+
+/***********************************************************
+ *  Register()
+ *
+ *  This method is used for taking ownership of a created
+ *  OpenGL texture and associating it with the passed in tag.
+ *  The returned handle stays valid until DestroyAll().
+ ***********************************************************/
+TextureHandle TextureRegistry::Register(
+	std::string_view tag,
+	GLuint textureID,
+	int width,
+	int height,
+	GLenum internalFormat,
+	bool bMipmapped)
+{
+	TextureHandle handle = (TextureHandle)m_textures.size();
+	uint32_t hash = HashName(tag);
+
+	auto result = m_handles.emplace(hash, handle);
+	if (result.second == false)
+	{
+		// keep the first texture registered with a tag, the
+		// same as the tag lookup always did
+		if (m_textures[result.first->second].tag != tag)
+		{
+			std::cout << "Texture tag hash collision: " << tag << std::endl;
+		}
+	}
+
+	TEXTURE_ENTRY entry;
+	entry.ID = textureID;
+	entry.width = width;
+	entry.height = height;
+	entry.internalFormat = internalFormat;
+	entry.bMipmapped = bMipmapped;
+	entry.gpuBytes = CalculateTextureMemory(width, height, internalFormat, bMipmapped);
+	entry.tag = std::string(tag);
+	entry.array = -1;
+	entry.layer = -1;
+	entry.bindlessHandle = 0;
+
+	m_textures.push_back(entry);
+	m_totalBytes += entry.gpuBytes;
+
+	return(handle);
+}
+
+/***********************************************************
+ *  Find()
+ *
+ *  This method is used for getting the handle of the
+ *  registered texture associated with the passed in tag,
+ *  or INVALID_TEXTURE if there is none.
+ ***********************************************************/
+TextureHandle TextureRegistry::Find(std::string_view tag) const
+{
+	auto found = m_handles.find(HashName(tag));
+	if (found == m_handles.end())
+	{
+		return(INVALID_TEXTURE);
+	}
+
+	return(found->second);
+}
+
+/***********************************************************
+ *  BuildTextureArrays()
+ *
+ *  This method is used for packing the registered textures
+ *  into 2D texture arrays.  Every texture is resampled on
+ *  the GPU to its size class by blitting each of its levels
+ *  into the same level of its layer, so the layers keep the
+ *  mipmaps that were built on the CPU, and the texture of
+ *  its own is deleted afterwards.  The
+ *  textures keep their handles, their entries point at the
+ *  array and layer that they were packed into.
+ ***********************************************************/
+int TextureRegistry::BuildTextureArrays(int minSize, int maxSize)
+{
+	GLint maxLayers = 0;
+	GLint maxTextureSize = 0;
+	const int firstArray = (int)m_arrays.size();
+
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+	if (maxSize > maxTextureSize)
+	{
+		maxSize = maxTextureSize;
+	}
+
+	// find the layer of every texture, adding an array for
+	// every new size class and format
+	for (TEXTURE_ENTRY& entry : m_textures)
+	{
+		// block compressed textures cannot be blitted, they
+		// stay textures of their own
+		if ((entry.array >= 0) || (entry.ID == 0) || (GetBytesPerBlock(entry.internalFormat) != 0))
+		{
+			continue;
+		}
+
+		int size = GetSizeClass(entry.width, entry.height, minSize, maxSize);
+		int array = firstArray;
+		while ((array < (int)m_arrays.size()) &&
+			((m_arrays[array].size != size) ||
+			(m_arrays[array].internalFormat != entry.internalFormat) ||
+			(m_arrays[array].layers >= maxLayers)))
+		{
+			array++;
+		}
+		if (array == (int)m_arrays.size())
+		{
+			TEXTURE_ARRAY textureArray = {};
+			textureArray.size = size;
+			textureArray.internalFormat = entry.internalFormat;
+			m_arrays.push_back(textureArray);
+		}
+
+		entry.array = array;
+		entry.layer = m_arrays[array].layers;
+		m_arrays[array].layers++;
+	}
+
+	for (int array = firstArray; array < (int)m_arrays.size(); array++)
+	{
+		TEXTURE_ARRAY& textureArray = m_arrays[array];
+
+		glGenTextures(1, &textureArray.ID);
+		GLStateCache::BindTexture(GL_TEXTURE_2D_ARRAY, textureArray.ID);
+		glTexStorage3D(
+			GL_TEXTURE_2D_ARRAY,
+			CountMipLevels(textureArray.size),
+			textureArray.internalFormat,
+			textureArray.size,
+			textureArray.size,
+			textureArray.layers);
+
+		// the same mapping parameters as the separate textures,
+		// sampling the mipmaps that every layer is filled with
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, CountMipLevels(textureArray.size) - 1);
+
+		textureArray.gpuBytes = CalculateTextureMemory(
+			textureArray.size, textureArray.size, textureArray.internalFormat, true) * textureArray.layers;
+		m_totalBytes += textureArray.gpuBytes;
+	}
+
+	// resample every level of every texture into the same
+	// level of its layer with a linear blit
+	GLuint framebuffers[2] = {};
+	glGenFramebuffers(2, framebuffers);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffers[0]);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffers[1]);
+
+	for (TEXTURE_ENTRY& entry : m_textures)
+	{
+		if ((entry.array < firstArray) || (entry.ID == 0))
+		{
+			continue;
+		}
+
+		const TEXTURE_ARRAY& textureArray = m_arrays[entry.array];
+		const int levelCount = CountMipLevels(textureArray.size);
+
+		// the last level that was uploaded to the texture
+		GLint maxSourceLevel = 0;
+		GLStateCache::BindTexture(GL_TEXTURE_2D, entry.ID);
+		glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxSourceLevel);
+		GLStateCache::BindTexture(GL_TEXTURE_2D, 0);
+		if (entry.bMipmapped == false)
+		{
+			maxSourceLevel = 0;
+		}
+
+		bool bPacked = true;
+		for (int level = 0; (level < levelCount) && (bPacked == true); level++)
+		{
+			// the levels of the texture hold the mipmaps that were
+			// filtered in linear light - past its last level the
+			// layer is reduced from its own level above
+			int levelSize = std::max(textureArray.size >> level, 1);
+			int sourceLevel = GetSourceLevel(entry.width, entry.height, levelSize);
+			if ((level == 0) && (sourceLevel > maxSourceLevel))
+			{
+				sourceLevel = maxSourceLevel;
+			}
+			int sourceWidth = 0;
+			int sourceHeight = 0;
+			if (sourceLevel <= maxSourceLevel)
+			{
+				sourceWidth = std::max(entry.width >> sourceLevel, 1);
+				sourceHeight = std::max(entry.height >> sourceLevel, 1);
+				glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, entry.ID, sourceLevel);
+			}
+			else
+			{
+				sourceWidth = std::max(textureArray.size >> (level - 1), 1);
+				sourceHeight = sourceWidth;
+				glFramebufferTextureLayer(
+					GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textureArray.ID, level - 1, entry.layer);
+			}
+			glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textureArray.ID, level, entry.layer);
+
+			if ((glCheckFramebufferStatus(GL_READ_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) ||
+				(glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE))
+			{
+				bPacked = false;
+				break;
+			}
+
+			glBlitFramebuffer(
+				0, 0, sourceWidth, sourceHeight,
+				0, 0, levelSize, levelSize,
+				GL_COLOR_BUFFER_BIT,
+				GL_LINEAR);
+		}
+
+		if (bPacked == false)
+		{
+			// the texture stays a texture of its own, and its
+			// layer is left unused
+			std::cout << "Could not pack texture into array: " << entry.tag << std::endl;
+			entry.array = -1;
+			entry.layer = -1;
+			continue;
+		}
+
+		// the texture is only sampled from its layer from now on
+		GLStateCache::DeleteTextures(1, &entry.ID);
+		entry.ID = 0;
+		m_totalBytes -= entry.gpuBytes;
+		entry.gpuBytes = 0;
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(2, framebuffers);
+	GLStateCache::BindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	return((int)m_arrays.size());
+}
+
+/***********************************************************
+ *  MakeTexturesResident()
+ *
+ *  This method is used for getting the bindless handle of
+ *  every texture of its own and making it resident, so the
+ *  shaders can sample it without it being bound.  The
+ *  sampling state of a texture cannot change afterwards.
+ *  The handle changes between the instances of one draw,
+ *  which the shaders may only sample with NV_gpu_shader5,
+ *  so both extensions are needed.
+ ***********************************************************/
+bool TextureRegistry::MakeTexturesResident()
+{
+	if ((GLEW_ARB_bindless_texture == GL_FALSE) || (GLEW_NV_gpu_shader5 == GL_FALSE))
+	{
+		return(false);
+	}
+
+	for (TEXTURE_ENTRY& entry : m_textures)
+	{
+		if ((entry.ID == 0) || (entry.bindlessHandle != 0))
+		{
+			continue;
+		}
+
+		entry.bindlessHandle = glGetTextureHandleARB(entry.ID);
+		glMakeTextureHandleResidentARB(entry.bindlessHandle);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyAll()
+ *
+ *  This method is used for freeing the GPU memory of all
+ *  the registered textures and texture arrays.
+ ***********************************************************/
+void TextureRegistry::DestroyAll()
+{
+	for (int i = 0; i < (int)m_textures.size(); i++)
+	{
+		if (m_textures[i].bindlessHandle != 0)
+		{
+			glMakeTextureHandleNonResidentARB(m_textures[i].bindlessHandle);
+		}
+		if (m_textures[i].ID != 0)
+		{
+			GLStateCache::DeleteTextures(1, &m_textures[i].ID);
+		}
+	}
+	for (int i = 0; i < (int)m_arrays.size(); i++)
+	{
+		GLStateCache::DeleteTextures(1, &m_arrays[i].ID);
+	}
+
+	m_textures.clear();
+	m_arrays.clear();
+	m_handles.clear();
+	m_totalBytes = 0;
+}
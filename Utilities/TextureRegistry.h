@@ -0,0 +1,141 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureregistry.h
+// ============
+// keep track of the loaded OpenGL textures and hand out compact handles
+//
+// Tags are only resolved to handles while the scene is being built, the
+// handle itself indexes straight into the registry so rendering never has
+// to search for a texture.  The registered textures can be resampled to
+// square power of two size classes and packed into 2D texture arrays, one
+// for every size class, after which a texture is selected by its layer.
+// Where the driver supports bindless textures they can instead be made
+// resident, and the shaders then read them through their 64-bit handles.
+// Block compressed textures are never packed, they are already small and
+// cannot be resampled by a blit.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// compact handle of a registered texture
+typedef int TextureHandle;
+const TextureHandle INVALID_TEXTURE = -1;
+
+/***********************************************************
+ *  TextureRegistry
+ *
+ *  This class owns the OpenGL texture objects of the scene
+ *  and tracks the GPU memory that each of them uses.
+ ***********************************************************/
+class TextureRegistry
+{
+public:
+	// constructor
+	TextureRegistry();
+	// destructor
+	~TextureRegistry();
+
+	struct TEXTURE_ENTRY
+	{
+		GLuint ID;
+		int width;
+		int height;
+		GLenum internalFormat;
+		bool bMipmapped;
+		size_t gpuBytes;
+		std::string tag;
+		// array and layer that the texture was packed into,
+		// both are -1 while it is a texture of its own
+		int array;
+		int layer;
+		// handle of the texture while it is resident, or 0
+		GLuint64 bindlessHandle;
+	};
+
+	struct TEXTURE_ARRAY
+	{
+		GLuint ID;
+		int size;
+		int layers;
+		GLenum internalFormat;
+		size_t gpuBytes;
+	};
+
+	// take ownership of a created texture and return its handle
+	TextureHandle Register(
+		std::string_view tag,
+		GLuint textureID,
+		int width,
+		int height,
+		GLenum internalFormat,
+		bool bMipmapped);
+	// resolve a tag to a handle - meant for scene build time
+	TextureHandle Find(std::string_view tag) const;
+	// resample the registered textures to the power of two
+	// size class nearest to them within the passed in limits,
+	// and pack the textures of every size class and format
+	// into one texture array - returns the number of arrays
+	int BuildTextureArrays(int minSize, int maxSize);
+	// make every texture of its own resident and get its
+	// bindless handle - returns false when the driver does
+	// not support bindless textures, or cannot index them
+	// per instance
+	bool MakeTexturesResident();
+	// delete all of the registered textures
+	void DestroyAll();
+
+	inline bool IsValid(TextureHandle handle) const
+	{
+		return((handle >= 0) && (handle < (int)m_textures.size()));
+	}
+	inline GLuint GetTextureID(TextureHandle handle) const
+	{
+		return(m_textures[handle].ID);
+	}
+	inline const TEXTURE_ENTRY& GetEntry(TextureHandle handle) const
+	{
+		return(m_textures[handle]);
+	}
+	inline GLuint64 GetBindlessHandle(TextureHandle handle) const
+	{
+		return(m_textures[handle].bindlessHandle);
+	}
+	inline int GetCount() const
+	{
+		return((int)m_textures.size());
+	}
+	inline int GetArrayCount() const
+	{
+		return((int)m_arrays.size());
+	}
+	inline GLuint GetArrayID(int array) const
+	{
+		return(m_arrays[array].ID);
+	}
+	inline const TEXTURE_ARRAY& GetArray(int array) const
+	{
+		return(m_arrays[array]);
+	}
+	inline size_t GetTotalMemory() const
+	{
+		return(m_totalBytes);
+	}
+
+private:
+	// registered textures, indexed by handle
+	std::vector<TEXTURE_ENTRY> m_textures;
+	// texture arrays that the textures were packed into
+	std::vector<TEXTURE_ARRAY> m_arrays;
+	// handle of every tag, keyed by the hash of the tag
+	std::unordered_map<uint32_t, TextureHandle> m_handles;
+	// GPU memory used by all of the registered textures and
+	// texture arrays
+	size_t m_totalBytes;
+};
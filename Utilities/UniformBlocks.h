@@ -0,0 +1,136 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformblocks.h
+// ============
+// C++ mirrors of the std140 uniform blocks and std430 storage blocks
+// declared in the GLSL shaders
+//
+// The layout of every struct in this file must match the block of the same
+// name in vertexShader.glsl, fragmentShader.glsl or cullingShader.glsl byte
+// for byte, which the static_asserts below check offset by offset.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+// binding points shared by every shader program
+enum UNIFORM_BLOCK_BINDING
+{
+	FRAME_DATA_BINDING = 0,
+	LIGHT_BLOCK_BINDING = 1
+};
+
+// binding points of the shader storage blocks
+enum STORAGE_BLOCK_BINDING
+{
+	MATERIAL_BLOCK_BINDING = 0,
+	INSTANCE_BLOCK_BINDING = 1,
+	CULL_OBJECT_BLOCK_BINDING = 2,
+	CULL_COMMAND_BLOCK_BINDING = 3,
+	CULL_COUNT_BLOCK_BINDING = 4,
+	TEXTURE_HANDLE_BLOCK_BINDING = 5
+};
+
+// must match TOTAL_LIGHTS in fragmentShader.glsl
+const int TOTAL_LIGHTS = 4;
+
+// per-frame camera data - written once per frame
+struct FrameData
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec4 viewPosition;		// xyz = camera position
+};
+
+// one light source - vec3 members are followed by a float
+// so that each one fills a whole 16 byte std140 slot
+struct LightSource
+{
+	glm::vec3 position;
+	float focalStrength;
+	glm::vec3 ambientColor;
+	float specularIntensity;
+	glm::vec3 diffuseColor;
+	float padding0;
+	glm::vec3 specularColor;
+	float padding1;
+};
+
+// all of the scene lights - written when the lights change
+struct LightBlock
+{
+	LightSource lightSources[TOTAL_LIGHTS];
+};
+
+// one entry of the std430 material table, indexed in the
+// shader by the materialIndex uniform
+struct MaterialData
+{
+	glm::vec3 ambientColor;
+	float ambientStrength;
+	glm::vec3 diffuseColor;
+	float shininess;
+	glm::vec3 specularColor;
+	float padding;
+};
+
+// one entry of the std430 instance table, the values of one
+// object of an instanced draw
+struct InstanceData
+{
+	glm::mat4 model;
+	glm::vec4 objectColor;
+	glm::vec2 UVscale;
+	int materialIndex;
+	int textureIndex;			// array layer or bindless handle index, or -1
+};
+
+// one object tested by the culling compute shader - its world
+// bounds, and the indices that its draw command is built from
+struct CullObjectData
+{
+	glm::vec4 centerRadius;		// xyz = bounds center, w = sphere radius
+	glm::vec3 extents;			// half size of the world box
+	unsigned int group;			// draw count that the command is added to
+	unsigned int indexCount;
+	unsigned int firstIndex;
+	int baseVertex;
+	unsigned int firstCommand;	// first command slot of the group
+};
+
+static_assert(offsetof(FrameData, view) == 0, "FrameData.view must be at offset 0");
+static_assert(offsetof(FrameData, projection) == 64, "FrameData.projection must be at offset 64");
+static_assert(offsetof(FrameData, viewPosition) == 128, "FrameData.viewPosition must be at offset 128");
+static_assert(sizeof(FrameData) == 144, "FrameData does not match the std140 layout");
+
+static_assert(offsetof(LightSource, position) == 0, "LightSource.position must be at offset 0");
+static_assert(offsetof(LightSource, focalStrength) == 12, "LightSource.focalStrength must be at offset 12");
+static_assert(offsetof(LightSource, ambientColor) == 16, "LightSource.ambientColor must be at offset 16");
+static_assert(offsetof(LightSource, specularIntensity) == 28, "LightSource.specularIntensity must be at offset 28");
+static_assert(offsetof(LightSource, diffuseColor) == 32, "LightSource.diffuseColor must be at offset 32");
+static_assert(offsetof(LightSource, specularColor) == 48, "LightSource.specularColor must be at offset 48");
+static_assert(sizeof(LightSource) == 64, "LightSource does not match the std140 array stride");
+static_assert(sizeof(LightBlock) == 64 * TOTAL_LIGHTS, "LightBlock does not match the std140 layout");
+
+static_assert(offsetof(MaterialData, ambientColor) == 0, "MaterialData.ambientColor must be at offset 0");
+static_assert(offsetof(MaterialData, ambientStrength) == 12, "MaterialData.ambientStrength must be at offset 12");
+static_assert(offsetof(MaterialData, diffuseColor) == 16, "MaterialData.diffuseColor must be at offset 16");
+static_assert(offsetof(MaterialData, shininess) == 28, "MaterialData.shininess must be at offset 28");
+static_assert(offsetof(MaterialData, specularColor) == 32, "MaterialData.specularColor must be at offset 32");
+static_assert(sizeof(MaterialData) == 48, "MaterialData does not match the std430 array stride");
+
+static_assert(offsetof(InstanceData, model) == 0, "InstanceData.model must be at offset 0");
+static_assert(offsetof(InstanceData, objectColor) == 64, "InstanceData.objectColor must be at offset 64");
+static_assert(offsetof(InstanceData, UVscale) == 80, "InstanceData.UVscale must be at offset 80");
+static_assert(offsetof(InstanceData, materialIndex) == 88, "InstanceData.materialIndex must be at offset 88");
+static_assert(offsetof(InstanceData, textureIndex) == 92, "InstanceData.textureIndex must be at offset 92");
+static_assert(sizeof(InstanceData) == 96, "InstanceData does not match the std430 array stride");
+
+static_assert(offsetof(CullObjectData, centerRadius) == 0, "CullObjectData.centerRadius must be at offset 0");
+static_assert(offsetof(CullObjectData, extents) == 16, "CullObjectData.extents must be at offset 16");
+static_assert(offsetof(CullObjectData, group) == 28, "CullObjectData.group must be at offset 28");
+static_assert(offsetof(CullObjectData, indexCount) == 32, "CullObjectData.indexCount must be at offset 32");
+static_assert(offsetof(CullObjectData, firstCommand) == 44, "CullObjectData.firstCommand must be at offset 44");
+static_assert(sizeof(CullObjectData) == 48, "CullObjectData does not match the std430 array stride");
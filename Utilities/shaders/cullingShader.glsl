@@ -0,0 +1,78 @@
+#version 440 core
+layout (local_size_x = 64) in;
+
+// one indirect draw command - must match DRAW_COMMAND in ShapeMeshes.h
+struct DrawCommand
+{
+   uint count;
+   uint instanceCount;
+   uint firstIndex;
+   int baseVertex;
+   uint baseInstance;
+};
+
+// one object to test - must match CullObjectData in UniformBlocks.h
+struct CullObject
+{
+   vec4 centerRadius;
+   vec3 extents;
+   uint group;
+   uint indexCount;
+   uint firstIndex;
+   int baseVertex;
+   uint firstCommand;
+};
+
+layout (std430, binding = 2) readonly buffer CullObjectBlock
+{
+   CullObject objects[];
+};
+
+// the commands of every group, written from the first slot of the group
+layout (std430, binding = 3) writeonly buffer CullCommandBlock
+{
+   DrawCommand commands[];
+};
+
+// number of commands written for every group, cleared before each pass
+layout (std430, binding = 4) buffer CullCountBlock
+{
+   uint drawCounts[];
+};
+
+// frustum planes with the normals pointing inside, normalized
+uniform vec4 frustumPlanes[6];
+uniform uint objectCount;
+
+void main()
+{
+   uint objectIndex = gl_GlobalInvocationID.x;
+   if(objectIndex >= objectCount)
+   {
+      return;
+   }
+
+   CullObject object = objects[objectIndex];
+
+   // the box reaches as far towards a plane as its extents projected
+   // onto the normal, and the smaller of the box and the sphere decides
+   for(int i = 0; i < 6; i++)
+   {
+      float distance = dot(frustumPlanes[i].xyz, object.centerRadius.xyz) + frustumPlanes[i].w;
+      float boxRadius = dot(abs(frustumPlanes[i].xyz), object.extents);
+      if(distance < -min(boxRadius, object.centerRadius.w))
+      {
+         return;
+      }
+   }
+
+   // the base instance finds the object in the instance block
+   uint slot = atomicAdd(drawCounts[object.group], 1u);
+   DrawCommand command;
+   command.count = object.indexCount;
+   command.instanceCount = 1u;
+   command.firstIndex = object.firstIndex;
+   command.baseVertex = object.baseVertex;
+   command.baseInstance = objectIndex;
+   commands[object.firstCommand + slot] = command;
+}
@@ -1,43 +1,87 @@
 #version 440 core
-
+// only used when the driver supports it, see SampleObjectTexture() - the
+// handle differs between the instances of one draw, which needs the
+// non-uniform sampler indexing of NV_gpu_shader5
+#if defined(GL_ARB_bindless_texture) && defined(GL_NV_gpu_shader5)
+#extension GL_ARB_bindless_texture : require
+#extension GL_NV_gpu_shader5 : require
+#define BINDLESS_TEXTURES
+#endif
+
+// must match MaterialData in UniformBlocks.h
 struct Material 
 {
     vec3 ambientColor;
     float ambientStrength;
     vec3 diffuseColor;
-    vec3 specularColor;
     float shininess;
+    vec3 specularColor;
 }; 
 
+// must match LightSource in UniformBlocks.h
 struct LightSource 
 {
-    vec3 position;	
+    vec3 position;
+    float focalStrength;
     vec3 ambientColor;
+    float specularIntensity;
     vec3 diffuseColor;
     vec3 specularColor;
-    float focalStrength;
-    float specularIntensity;
 };
 
 #define TOTAL_LIGHTS 4
 
+// per-frame camera data - must match FrameData in UniformBlocks.h
+layout (std140, binding = 0) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    vec4 viewPosition;
+};
+
+// scene lights - must match LightBlock in UniformBlocks.h
+layout (std140, binding = 1) uniform LightBlock
+{
+    LightSource lightSources[TOTAL_LIGHTS];
+};
+
+// every material of the scene, selected per object by materialIndex
+layout (std430, binding = 0) readonly buffer MaterialBlock
+{
+    Material materials[];
+};
+
 in vec3 fragmentPosition;
 in vec3 fragmentVertexNormal;
 in vec2 fragmentTextureCoordinate;
+// per-object values, from the uniforms or the instance of the object
+flat in vec4 fragmentObjectColor;
+flat in vec2 fragmentUVscale;
+flat in int fragmentMaterialIndex;
+flat in int fragmentTextureIndex;
 
 out vec4 outFragmentColor;
 
 uniform bool bUseTexture=false;
 uniform bool bUseLighting=false;
-uniform vec4 objectColor = vec4(1.0f);
 uniform sampler2D objectTexture;
-uniform vec3 viewPosition;
-uniform vec2 UVscale = vec2(1.0f, 1.0f);
-uniform LightSource lightSources[TOTAL_LIGHTS];
-uniform Material material;
+// the scene textures packed into layers, sampled instead of
+// objectTexture when the object has a texture layer
+uniform sampler2DArray objectTextureArray;
+// set when the textures are read through their bindless handles
+uniform bool bUseBindlessTextures = false;
+
+#ifdef BINDLESS_TEXTURES
+// resident handle of every texture, indexed by the texture index
+layout (std430, binding = 5) readonly buffer TextureHandleBlock
+{
+    uvec2 textureHandles[];
+};
+#endif
 
 // function prototypes
-vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection);
+vec4 SampleObjectTexture(vec2 textureCoordinate);
+vec3 CalcLightSource(LightSource light, Material material, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection);
 
 void main()
 {
@@ -45,39 +89,59 @@ void main()
    {
       // properties
       vec3 lightNormal = normalize(fragmentVertexNormal);
-      vec3 viewDirection = normalize(viewPosition - fragmentPosition);
+      vec3 viewDirection = normalize(viewPosition.xyz - fragmentPosition);
       vec3 phongResult = vec3(0.0f);
+      Material material = materials[fragmentMaterialIndex];
 
       for(int i = 0; i < TOTAL_LIGHTS; i++)
       {
-         phongResult += CalcLightSource(lightSources[i], lightNormal, fragmentPosition, viewDirection); 
+         phongResult += CalcLightSource(lightSources[i], material, lightNormal, fragmentPosition, viewDirection); 
       }   
     
       if(bUseTexture == true)
       {
-         vec4 textureColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
+         vec4 textureColor = SampleObjectTexture(fragmentTextureCoordinate * fragmentUVscale);
          outFragmentColor = vec4(phongResult * textureColor.xyz, 1.0);
       }
       else
       {
-         outFragmentColor = vec4(phongResult * objectColor.xyz, objectColor.w);
+         outFragmentColor = vec4(phongResult * fragmentObjectColor.xyz, fragmentObjectColor.w);
       }
    }
    else 
    {
       if(bUseTexture == true)
       {
-         outFragmentColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
+         outFragmentColor = SampleObjectTexture(fragmentTextureCoordinate * fragmentUVscale);
       }
       else
       {
-         outFragmentColor = objectColor;
+         outFragmentColor = fragmentObjectColor;
       }
    }
 }
 
+// samples the texture of the object through its bindless handle, or
+// from its array layer when it has one.
+vec4 SampleObjectTexture(vec2 textureCoordinate)
+{
+#ifdef BINDLESS_TEXTURES
+   if(bUseBindlessTextures == true)
+   {
+      return(texture(sampler2D(textureHandles[fragmentTextureIndex]), textureCoordinate));
+   }
+#endif
+
+   if(fragmentTextureIndex >= 0)
+   {
+      return(texture(objectTextureArray, vec3(textureCoordinate, float(fragmentTextureIndex))));
+   }
+
+   return(texture(objectTexture, textureCoordinate));
+}
+
 // calculates the color when using a directional light.
-vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
+vec3 CalcLightSource(LightSource light, Material material, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
 {
    vec3 ambient;
    vec3 diffuse;
@@ -1,20 +1,77 @@
-#version 330 core
+#version 440 core
 layout (location = 0) in vec3 inVertexPosition;
 layout (location = 1) in vec3 inVertexNormal;
 layout (location = 2) in vec2 inTextureCoordinate;
+// index of the object in the instance block, advanced once per
+// instance and starting at the base instance of the draw
+layout (location = 3) in uint inInstanceIndex;
 
 out vec3 fragmentPosition;
 out vec3 fragmentVertexNormal;
 out vec2 fragmentTextureCoordinate;
+flat out vec4 fragmentObjectColor;
+flat out vec2 fragmentUVscale;
+flat out int fragmentMaterialIndex;
+flat out int fragmentTextureIndex;
+
+// per-frame camera data - must match FrameData in UniformBlocks.h
+layout (std140, binding = 0) uniform FrameData
+{
+   mat4 view;
+   mat4 projection;
+   vec4 viewPosition;
+};
+
+// one object of an instanced draw - must match InstanceData in UniformBlocks.h
+struct Instance
+{
+   mat4 model;
+   vec4 objectColor;
+   vec2 UVscale;
+   int materialIndex;
+   int textureIndex;
+};
+
+// the objects of the instanced draws of a frame
+layout (std430, binding = 1) readonly buffer InstanceBlock
+{
+   Instance instances[];
+};
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform vec4 objectColor = vec4(1.0f);
+uniform vec2 UVscale = vec2(1.0f, 1.0f);
+uniform int materialIndex = 0;
+// layer of the texture in the texture array, or the index of its
+// bindless handle - -1 when the texture is bound by itself
+uniform int textureIndex = -1;
+// added to the instance index to find the entry of InstanceBlock, the
+// uniforms above are used instead when it is negative
+uniform int firstInstance = -1;
 
 void main()
 {
-   fragmentPosition = vec3(model * vec4(inVertexPosition, 1.0));
-   gl_Position = projection * view * model * vec4(inVertexPosition, 1.0f);
+   mat4 objectModel = model;
+
+   if(firstInstance >= 0)
+   {
+      Instance instance = instances[firstInstance + int(inInstanceIndex)];
+      objectModel = instance.model;
+      fragmentObjectColor = instance.objectColor;
+      fragmentUVscale = instance.UVscale;
+      fragmentMaterialIndex = instance.materialIndex;
+      fragmentTextureIndex = instance.textureIndex;
+   }
+   else
+   {
+      fragmentObjectColor = objectColor;
+      fragmentUVscale = UVscale;
+      fragmentMaterialIndex = materialIndex;
+      fragmentTextureIndex = textureIndex;
+   }
+
+   fragmentPosition = vec3(objectModel * vec4(inVertexPosition, 1.0));
+   gl_Position = projection * view * objectModel * vec4(inVertexPosition, 1.0f);
    fragmentVertexNormal = inVertexNormal;
    fragmentTextureCoordinate = inTextureCoordinate;
 }
\ No newline at end of file